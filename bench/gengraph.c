@@ -0,0 +1,133 @@
+// Synthetic graphs for the benchmarks: writes a directed graph with the
+// given number of edges as DOT to stdout. The output only depends on the
+// model, the edge count and the seed.
+//
+//   gengraph rmat|ba|er EDGES [SEED]
+//
+// rmat: R-MAT (Kronecker) graph with the Graph500 parameters a = 0.57,
+//       b = c = 0.19, edge factor 16 and scrambled node numbers
+// ba:   Barabasi-Albert preferential attachment: every new node links to 8
+//       older nodes picked by in-degree + 8, i.e. by total degree as in the
+//       undirected model
+// er:   Erdos-Renyi G(n, m) with an average out-degree of 8
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#define RMAT_EDGE_FACTOR 16
+#define BA_OUT_DEGREE 8
+#define ER_OUT_DEGREE 8
+
+static uint64_t rng_state;
+
+// splitmix64
+static uint64_t next_random(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, n), up to a bias of n / 2^64
+static uint64_t random_below(uint64_t n) {
+    return next_random() % n;
+}
+
+static double random_unit(void) {
+    return (next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void write_edge(uint64_t source, uint64_t target) {
+    printf("n%llu -> n%llu;\n", (unsigned long long)source, (unsigned long long)target);
+}
+
+static void generate_rmat(uint64_t edges) {
+    int scale = 1;
+    while (((uint64_t)RMAT_EDGE_FACTOR << scale) < edges) scale++;
+    const uint64_t mask = ((uint64_t)1 << scale) - 1;
+    // An odd multiplier permutes [0, 2^scale), which spreads the hubs that
+    // R-MAT puts at the low node numbers
+    const uint64_t scramble = next_random() | 1, offset = next_random();
+    for (uint64_t e = 0; e < edges; e++) {
+        uint64_t source = 0, target = 0;
+        for (int level = 0; level < scale; level++) {
+            // Quadrant of the adjacency matrix: bit 1 source half, bit 0 target half
+            double r = random_unit();
+            int quadrant = r < 0.57 ? 0 : r < 0.76 ? 1 : r < 0.95 ? 2 : 3;
+            source = source << 1 | (uint64_t)(quadrant >> 1);
+            target = target << 1 | (uint64_t)(quadrant & 1);
+        }
+        write_edge((source * scramble + offset) & mask, (target * scramble + offset) & mask);
+    }
+}
+
+static void generate_ba(uint64_t edges) {
+    // Every node BA_OUT_DEGREE times plus the target of every edge, so that
+    // a uniform entry is a node with probability ~ in-degree + BA_OUT_DEGREE
+    uint64_t *pool = malloc((2 * edges + 2 * BA_OUT_DEGREE) * sizeof(uint64_t));
+    if (!pool) {
+        perror("Failed to allocate memory for the node pool");
+        exit(1);
+    }
+    uint64_t pool_size = 0, written = 0;
+    for (int k = 0; k < BA_OUT_DEGREE; k++) {
+        pool[pool_size++] = 0;
+    }
+    for (uint64_t node = 1; written < edges; node++) {
+        uint64_t count = pool_size;     // only link to older nodes
+        for (int k = 0; k < BA_OUT_DEGREE && written < edges; k++) {
+            uint64_t target = pool[random_below(count)];
+            write_edge(node, target);
+            pool[pool_size++] = target;
+            written++;
+        }
+        for (int k = 0; k < BA_OUT_DEGREE; k++) {
+            pool[pool_size++] = node;
+        }
+    }
+    free(pool);
+}
+
+static void generate_er(uint64_t edges) {
+    uint64_t nodes = edges / ER_OUT_DEGREE > 2 ? edges / ER_OUT_DEGREE : 2;
+    for (uint64_t e = 0; e < edges; e++) {
+        uint64_t source = random_below(nodes);
+        uint64_t target = random_below(nodes - 1);
+        write_edge(source, target >= source ? target + 1 : target);
+    }
+}
+
+int main(int argc, char** argv) {
+    char *end = NULL;
+    unsigned long long edges = argc >= 3 ? strtoull(argv[2], &end, 10) : 0;
+    if (argc < 3 || argc > 4 || edges == 0 || *end != '\0') {
+        fprintf(stderr, "Usage: %s rmat|ba|er EDGES [SEED]\n", argv[0]);
+        exit(1);
+    }
+    rng_state = argc == 4 ? strtoull(argv[3], NULL, 10) : 1;
+
+    static const struct {
+        const char *name;
+        void (*generate)(uint64_t edges);
+    } models[] = { { "rmat", generate_rmat }, { "ba", generate_ba }, { "er", generate_er } };
+    int model = 0;
+    while (model < 3 && strcmp(argv[1], models[model].name) != 0) model++;
+    if (model == 3) {
+        fprintf(stderr, "Error: Unknown model '%s'. Use rmat, ba or er.\n", argv[1]);
+        exit(1);
+    }
+
+    static char buffer[1 << 20];
+    setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+    printf("digraph %s {\n", argv[1]);
+    models[model].generate(edges);
+    printf("}\n");
+    if (fflush(stdout) != 0) {
+        perror("Error writing graph");
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+# vim: tabstop=8 expandtab shiftwidth=4 softtabstop=4
+
+# Benchmark driver: generates synthetic graphs with gengraph, times the
+# phases of a pagerank binary over repeated runs and prints the results as
+# JSON. Phase times are the ones the binary reports with -v, so process
+# start-up and result output are not included; the surfer timer has a
+# resolution of 1 ms.
+
+import argparse
+import json
+import math
+import os
+import platform
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+MODELS = ['rmat', 'ba', 'er']
+PHASES = ['parse', 'load', 'stats', 'surfer', 'markov', 'blocked']
+# blocked (the markov phase with --solver blocked) only on request
+DEFAULT_PHASES = PHASES[:-1]
+
+
+class BenchError(Exception):
+    pass
+
+
+def edge_count(text):
+    # Accept 1e6 as well as 1000000
+    try:
+        value = float(text)
+    except ValueError:
+        value = 0
+    if value < 1 or value != int(value):
+        raise argparse.ArgumentTypeError('invalid edge count: {}'.format(text))
+    return int(value)
+
+
+def run_measured(args):
+    """Run args; return stdout, stderr, wall seconds and peak RSS in KiB."""
+    with tempfile.TemporaryFile('w+') as out, tempfile.TemporaryFile('w+') as err:
+        start = time.perf_counter()
+        proc = subprocess.Popen(args, stdout=out, stderr=err)
+        # wait4() instead of wait() for the rusage of this child alone
+        _, status, usage = os.wait4(proc.pid, 0)
+        seconds = time.perf_counter() - start
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        out.seek(0)
+        err.seek(0)
+        stdout, stderr = out.read(), err.read()
+    if proc.returncode != 0:
+        raise BenchError('{} failed ({}):\n{}'.format(' '.join(args), proc.returncode, stderr))
+    return stdout, stderr, seconds, usage.ru_maxrss
+
+
+def search(pattern, text, args):
+    match = re.search(pattern, text)
+    if not match:
+        raise BenchError('unexpected output of {}:\n{}'.format(' '.join(args), text))
+    return match
+
+
+def prepare_graph(args, model, edges):
+    """Generate the DOT file and the snapshot of a graph unless cached;
+    return their paths and the node count."""
+    base = os.path.join(args.graph_dir, '{}-{}-{}'.format(model, edges, args.seed))
+    dot, snapshot = base + '.dot', base + '.prg'
+    if not os.path.exists(dot):
+        print('Generating {}'.format(dot), file=sys.stderr)
+        with open(dot + '.tmp', 'w') as out:
+            subprocess.run([args.gengraph, model, str(edges), str(args.seed)],
+                           stdout=out, check=True)
+        os.replace(dot + '.tmp', dot)
+    if not os.path.exists(snapshot):
+        run_measured([args.sut, '-s', '--save-binary', snapshot + '.tmp', dot])
+        os.replace(snapshot + '.tmp', snapshot)
+    stats, _, _, _ = run_measured([args.sut, '-s', snapshot])
+    nodes = int(search(r'num nodes: (\d+)', stats, [args.sut, '-s', snapshot]).group(1))
+    return dot, snapshot, nodes
+
+
+def measure_phase(args, phase, dot, snapshot, edges):
+    """Run one phase once; return its seconds and the edges (or surfer
+    steps) it processed."""
+    threads = ['-j', str(args.threads)]
+    if phase == 'parse':
+        cmd = [args.sut, '-v', '-s'] + threads + [dot]
+        _, err, _, rss = run_measured(cmd)
+        return float(search(r'Parsed .* in ([0-9.]+) s', err, cmd).group(1)), edges, rss
+    if phase == 'load':
+        cmd = [args.sut, '-v', '-s', snapshot]
+        _, err, _, rss = run_measured(cmd)
+        return float(search(r'Loaded .* in ([0-9.]+) s', err, cmd).group(1)), edges, rss
+    if phase == 'stats':
+        # -s has no timer of its own: the run minus the snapshot load
+        cmd = [args.sut, '-v', '-s', snapshot]
+        _, err, seconds, rss = run_measured(cmd)
+        load = float(search(r'Loaded .* in ([0-9.]+) s', err, cmd).group(1))
+        return max(seconds - load, 0.0), edges, rss
+    if phase == 'surfer':
+        steps = max(edges, args.min_steps)
+        cmd = [args.sut, '-v', '-r', str(steps), '--seed', str(args.seed), '--top', '1'] + threads + [snapshot]
+        _, err, _, rss = run_measured(cmd)
+        match = search(r'Random surfer: (\d+) steps in ([0-9.]+) s', err, cmd)
+        return float(match.group(2)), int(match.group(1)), rss
+    solver = ['--solver', 'blocked'] if phase == 'blocked' else []
+    cmd = [args.sut, '-v', '-m', str(args.iterations), '--top', '1'] + threads + args.markov_args + solver + [snapshot]
+    _, err, _, rss = run_measured(cmd)
+    match = search(r'(\d+) iterations \(([0-9.]+) edge sweeps\).* \(([0-9.e+-]+) ms/iteration', err, cmd)
+    # The time per iteration has more significant digits than the total
+    seconds = int(match.group(1)) * float(match.group(3)) / 1e3
+    return seconds, float(match.group(2)) * edges, rss
+
+
+def percentile(values, p):
+    # Nearest rank
+    ordered = sorted(values)
+    return ordered[max(0, math.ceil(p / 100.0 * len(ordered)) - 1)]
+
+
+def run_benchmarks(args):
+    results = []
+    for model in args.models:
+        for edges in args.edges:
+            dot, snapshot, nodes = prepare_graph(args, model, edges)
+            medians = {}
+            for phase in args.phases:
+                seconds, rss, work = [], 0, 0
+                for _ in range(args.repeat):
+                    s, work, r = measure_phase(args, phase, dot, snapshot, edges)
+                    seconds.append(s)
+                    rss = max(rss, r)
+                median = percentile(seconds, 50)
+                medians[phase] = median
+                result = {
+                    'model': model,
+                    'edges': edges,
+                    'nodes': nodes,
+                    'phase': phase,
+                    'runs': args.repeat,
+                    'median_s': median,
+                    'p95_s': percentile(seconds, 95),
+                    'min_s': min(seconds),
+                    'edges_per_s': work / median if median > 0 else None,
+                    'peak_rss_kib': rss,
+                }
+                # Where propagation blocking starts to pay off: the rank
+                # vector outgrows the last-level cache
+                speedup = ''
+                if phase == 'blocked' and medians.get('markov') and median > 0:
+                    result['speedup_vs_markov'] = medians['markov'] / median
+                    speedup = '  {:5.2f}x markov'.format(result['speedup_vs_markov'])
+                results.append(result)
+                print('{:5} {:>10} edges {:7} median {:9.4f} s  p95 {:9.4f} s  {:8.1f} M edges/s  {:8.1f} MiB{}'.format(
+                      model, edges, phase, median, result['p95_s'],
+                      (result['edges_per_s'] or 0) / 1e6, rss / 1024.0, speedup), file=sys.stderr)
+    return results
+
+
+if (__name__ == '__main__'):
+    cwd = os.path.dirname(os.path.abspath(__file__))
+
+    parser = argparse.ArgumentParser(description='Time the phases of pagerank on synthetic graphs.')
+    parser.add_argument('-e', '--edges', type=lambda s: [edge_count(e) for e in s.split(',')],
+                        default=[1000, 10000, 100000, 1000000], metavar='N[,N...]',
+                        help='graph sizes in edges, e.g. 1e3,1e6,1e8 (default: 1e3,1e4,1e5,1e6)')
+    parser.add_argument('-m', '--models', type=lambda s: s.split(','), default=MODELS,
+                        metavar='M[,M...]', help='graph models: rmat, ba, er (default: all)')
+    parser.add_argument('-p', '--phases', type=lambda s: s.split(','), default=DEFAULT_PHASES,
+                        metavar='P[,P...]', help='phases to time: parse, load, stats, surfer, '
+                                                 'markov, blocked (markov with --solver blocked, '
+                                                 'compared to markov if that comes first) '
+                                                 '(default: all but blocked)')
+    parser.add_argument('-r', '--repeat', type=int, default=5,
+                        help='runs per phase (default: 5)')
+    parser.add_argument('-i', '--iterations', type=int, default=20,
+                        help='Markov chain iterations per run (default: 20)')
+    parser.add_argument('--min-steps', type=int, default=1000000,
+                        help='minimum random surfer steps per run; otherwise one '
+                             'step per edge (default: 1000000)')
+    parser.add_argument('-j', '--threads', type=int, default=1,
+                        help='threads for pagerank -j (default: 1)')
+    parser.add_argument('--markov-args', type=str, default='',
+                        help='extra pagerank options for the markov phase, '
+                             'e.g. "--solver blocked"')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed of the generators and the surfer (default: 1)')
+    parser.add_argument('--graph-dir', type=str, default=os.path.join(cwd, 'graphs'),
+                        help='where generated graphs are cached (default: bench/graphs)')
+    parser.add_argument('--gengraph', type=str, default=os.path.join(cwd, 'gengraph'),
+                        help='graph generator binary (default: bench/gengraph)')
+    parser.add_argument('-o', '--output', type=str, metavar='FILE',
+                        help='write the JSON report to FILE instead of stdout')
+    parser.add_argument('sut', type=str, metavar='<sut>', help='pagerank binary to time')
+
+    args = parser.parse_args()
+    args.sut = os.path.abspath(args.sut)
+    args.markov_args = args.markov_args.split()
+    for model in args.models:
+        if model not in MODELS:
+            parser.error('unknown model: {}'.format(model))
+    for phase in args.phases:
+        if phase not in PHASES:
+            parser.error('unknown phase: {}'.format(phase))
+    if args.repeat < 1:
+        parser.error('--repeat must be at least 1')
+    os.makedirs(args.graph_dir, exist_ok=True)
+
+    try:
+        results = run_benchmarks(args)
+    except (BenchError, subprocess.CalledProcessError) as e:
+        print('Error: {}'.format(e), file=sys.stderr)
+        exit(1)
+
+    report = {
+        'sut': args.sut,
+        'host': {
+            'machine': platform.machine(),
+            'system': platform.system(),
+            'cpus': os.cpu_count(),
+        },
+        'settings': {
+            'repeat': args.repeat,
+            'iterations': args.iterations,
+            'threads': args.threads,
+            'markov_args': args.markov_args,
+            'seed': args.seed,
+        },
+        'results': results,
+    }
+    if args.output:
+        with open(args.output, 'w') as out:
+            json.dump(report, out, indent=2)
+            out.write('\n')
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        sys.stdout.write('\n')
@@ -0,0 +1,378 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "delta.h"
+#include "graph.h"
+#include "markov.h"
+#include "utils.h"
+#include "error.h"
+
+
+static FILE* open_input(const char* filename, const char* what) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not open %s '%s'", what, filename);
+    }
+    return file;
+}
+
+void read_ranks(const Graph* graph, const char* filename, double* ranks) {
+    for (int i = 0; i < graph->num_nodes; i++) {
+        ranks[i] = -1.0;
+    }
+    FILE *file = open_input(filename, "rank file");
+    char *line = NULL;
+    size_t capacity = 0;
+    int line_number = 0;
+    Guard guards[2];
+    guard_push(&guards[0], release_file, file);
+    guard_push(&guards[1], release_line, &line);
+    while (getline(&line, &capacity, file) != -1) {
+        line_number++;
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') {
+            continue;
+        }
+        char *id = p;
+        while (*p && !isspace((unsigned char)*p)) p++;
+        size_t len = p - id;
+        char *end;
+        double rank = strtod(p, &end);
+        if (end == p || !(rank >= 0.0) || (*end && !isspace((unsigned char)*end))) {
+            fail(PAGERANK_ERROR_FORMAT, "line %d of rank file '%s': expected '<id> <rank>'.", line_number, filename);
+        }
+        int node = idtable_find(&graph->ids, id, len);
+        if (node < 0) {
+            fail(PAGERANK_ERROR_FORMAT, "line %d of rank file '%s': unknown node '%.*s'.", line_number, filename, (int)len, id);
+        }
+        ranks[node] = rank;
+    }
+    guard_pop(&guards[1]);
+    guard_pop(&guards[0]);
+    free(line);
+    fclose(file);
+}
+
+// Growable list of edges given by node index
+typedef struct {
+    int *sources;
+    int *targets;
+    int *lines;         // line of the diff file each edge came from (deletions)
+    size_t num_edges;
+    size_t capacity;
+} EdgeList;
+
+static void edge_list_add(EdgeList* list, int source, int target, int line) {
+    if (list->num_edges == list->capacity) {
+        size_t capacity = list->capacity ? 2 * list->capacity : 256;
+        int *sources = realloc(list->sources, capacity * sizeof(int));
+        if (sources) list->sources = sources;
+        int *targets = realloc(list->targets, capacity * sizeof(int));
+        if (targets) list->targets = targets;
+        int *lines = realloc(list->lines, capacity * sizeof(int));
+        if (lines) list->lines = lines;
+        if (!sources || !targets || !lines) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for edges");
+        }
+        list->capacity = capacity;
+    }
+    list->sources[list->num_edges] = source;
+    list->targets[list->num_edges] = target;
+    list->lines[list->num_edges++] = line;
+}
+
+// Also a Guard release
+static void edge_list_free(void* data) {
+    EdgeList *list = data;
+    free(list->sources);
+    free(list->targets);
+    free(list->lines);
+}
+
+static int is_id_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+static const char* skip_blanks(const char* p) {
+    while (*p && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// Parse "<id> -> <id> [;]" up to the end of the line; returns 0 if malformed
+static int parse_diff_edge(const char* p, const char** ids, size_t* lens) {
+    for (int k = 0; k < 2; k++) {
+        p = skip_blanks(p);
+        ids[k] = p;
+        while (is_id_char(*p)) p++;
+        lens[k] = p - ids[k];
+        if (lens[k] == 0) {
+            return 0;
+        }
+        p = skip_blanks(p);
+        if (k == 0) {
+            if (p[0] != '-' || p[1] != '>') return 0;
+            p += 2;
+        }
+    }
+    if (*p == ';') p = skip_blanks(p + 1);
+    return *p == '\0';
+}
+
+// Append an ID, NUL-terminated, to the pending IDs of inserted edges
+static void append_id(char** buffer, size_t* length, size_t* capacity, const char* id, size_t len) {
+    if (*length + len + 1 > *capacity) {
+        size_t grown = 2 * (*length + len + 1) > 4096 ? 2 * (*length + len + 1) : 4096;
+        char *ids = realloc(*buffer, grown);
+        if (!ids) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for edges");
+        }
+        *buffer = ids;
+        *capacity = grown;
+    }
+    memcpy(*buffer + *length, id, len);
+    (*buffer)[*length + len] = '\0';
+    *length += len + 1;
+}
+
+void free_edge_diff(EdgeDiff* diff) {
+    free(diff->inserted_ids);
+    free(diff->deleted_sources);
+    free(diff->deleted_targets);
+    free(diff->removed);
+    memset(diff, 0, sizeof(*diff));
+}
+
+static void release_diff(void* diff) {
+    free_edge_diff(diff);
+}
+
+// Read the next edge of a diff; returns '+', '-' or 0 at the end of the file
+static int read_diff_edge(FILE* file, const char* filename, char** line, size_t* capacity, int* line_number,
+                          const char** ids, size_t* lens) {
+    while (getline(line, capacity, file) != -1) {
+        (*line_number)++;
+        const char *p = skip_blanks(*line);
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+        if ((*p != '+' && *p != '-') || !parse_diff_edge(p + 1, ids, lens)) {
+            fail(PAGERANK_ERROR_FORMAT, "line %d of edge diff '%s': expected '+<id> -> <id>;' or '-<id> -> <id>;'.",
+                    *line_number, filename);
+        }
+        return *p;
+    }
+    return 0;
+}
+
+void read_edge_diff(const Graph* graph, const char* filename, EdgeDiff* diff) {
+    double start = wall_time();
+    memset(diff, 0, sizeof(*diff));
+    EdgeList deleted = { 0 };
+    FILE *file = open_input(filename, "edge diff");
+    char *line = NULL;
+    size_t capacity = 0, ids_capacity = 0;
+    int line_number = 0, op;
+    const char *ids[2];
+    size_t lens[2];
+    Guard guards[4];
+    guard_push(&guards[0], release_diff, diff);
+    guard_push(&guards[1], edge_list_free, &deleted);
+    guard_push(&guards[2], release_file, file);
+    guard_push(&guards[3], release_line, &line);
+
+    // Deleted edges must exist before the diff, so their nodes are known
+    // already; the IDs of inserted edges are kept for apply_edge_diff()
+    while ((op = read_diff_edge(file, filename, &line, &capacity, &line_number, ids, lens))) {
+        if (op == '+') {
+            append_id(&diff->inserted_ids, &diff->inserted_length, &ids_capacity, ids[0], lens[0]);
+            append_id(&diff->inserted_ids, &diff->inserted_length, &ids_capacity, ids[1], lens[1]);
+            continue;
+        }
+        int source = idtable_find(&graph->ids, ids[0], lens[0]);
+        int target = idtable_find(&graph->ids, ids[1], lens[1]);
+        if (source < 0 || target < 0) {
+            fail(PAGERANK_ERROR_FORMAT, "line %d of edge diff '%s': edge %.*s -> %.*s does not exist.",
+                    line_number, filename, (int)lens[0], ids[0], (int)lens[1], ids[1]);
+        }
+        edge_list_add(&deleted, source, target, line_number);
+    }
+    guard_pop(&guards[3]);
+    guard_pop(&guards[2]);
+    free(line);
+    fclose(file);
+
+    diff->removed = calloc(graph->num_edges ? graph->num_edges : 1, 1);
+    if (!diff->removed) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for edges");
+    }
+    EdgeChunk delete_chunk = { deleted.sources, deleted.targets, deleted.num_edges };
+    long missing = find_deleted_edges(graph, &delete_chunk, diff->removed);
+    if (missing >= 0) {
+        fail(PAGERANK_ERROR_FORMAT, "line %d of edge diff '%s': edge %s -> %s does not exist.",
+                deleted.lines[missing], filename, node_id(graph, deleted.sources[missing]),
+                node_id(graph, deleted.targets[missing]));
+    }
+    guard_pop(&guards[1]);
+    guard_pop(&guards[0]);
+    free(deleted.lines);
+    diff->deleted_sources = deleted.sources;
+    diff->deleted_targets = deleted.targets;
+    diff->num_deleted = deleted.num_edges;
+    diff->seconds = wall_time() - start;
+}
+
+void apply_edge_diff(Graph* graph, EdgeDiff* diff, int** active, size_t* num_active, DeltaStats* stats) {
+    double start = wall_time();
+    const int built_nodes = graph->num_nodes;
+    EdgeList inserted = { 0 };
+    EdgeList deleted = { diff->deleted_sources, diff->deleted_targets, NULL, diff->num_deleted, diff->num_deleted };
+    Guard guards[2];
+    guard_push(&guards[0], release_diff, diff);
+    guard_push(&guards[1], edge_list_free, &inserted);
+
+    // New nodes are interned into the ID table, so it must not be mapped
+    detach_graph(graph);
+    for (size_t position = 0; position < diff->inserted_length;) {
+        const char *source_id = diff->inserted_ids + position;
+        const char *target_id = source_id + strlen(source_id) + 1;
+        position = target_id + strlen(target_id) + 1 - diff->inserted_ids;
+        int source = add_node(graph, source_id);
+        int target = add_node(graph, target_id);
+        edge_list_add(&inserted, source, target, 0);
+    }
+    EdgeChunk insert_chunk = { inserted.sources, inserted.targets, inserted.num_edges };
+    update_graph_edges(graph, built_nodes, &insert_chunk, diff->removed, diff->num_deleted);
+
+    unsigned char *marked = calloc(graph->num_nodes ? graph->num_nodes : 1, 1);
+    int *nodes = malloc((graph->num_nodes ? graph->num_nodes : 1) * sizeof(int));
+    if (!marked || !nodes) {
+        free(marked);
+        free(nodes);
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for edges");
+    }
+
+    // New nodes and nodes that gain their first or lose their last out-edge
+    // change the uniform share, and so the rank, of every node. The
+    // out-degree change of each source is counted in nodes first.
+    const EdgeList *lists[2] = { &inserted, &deleted };
+    int global = graph->num_nodes > built_nodes;
+    if (!global) {
+        memset(nodes, 0, graph->num_nodes * sizeof(int));
+        for (size_t e = 0; e < inserted.num_edges; e++) {
+            nodes[inserted.sources[e]]++;
+        }
+        for (size_t e = 0; e < deleted.num_edges; e++) {
+            nodes[deleted.sources[e]]--;
+        }
+        for (int l = 0; l < 2 && !global; l++) {
+            for (size_t e = 0; e < lists[l]->num_edges && !global; e++) {
+                int source = lists[l]->sources[e];
+                int degree = out_degree(graph, source);
+                global = (degree == 0) != (degree - nodes[source] == 0);
+            }
+        }
+    }
+
+    // Otherwise directly affected: both ends of every changed edge, and all
+    // successors of its source, whose share of the source's rank changed
+    size_t count = 0;
+    if (global) {
+        for (int i = 0; i < graph->num_nodes; i++) {
+            nodes[count++] = i;
+        }
+    }
+    for (int l = 0; l < 2 && !global; l++) {
+        for (size_t e = 0; e < lists[l]->num_edges; e++) {
+            int source = lists[l]->sources[e], target = lists[l]->targets[e];
+            if (!marked[target]) {
+                marked[target] = 1;
+                nodes[count++] = target;
+            }
+            if (marked[source] == 2) {
+                continue;
+            }
+            if (!marked[source]) {
+                nodes[count++] = source;
+            }
+            marked[source] = 2;
+            for (size_t o = graph->out_offsets[source]; o < graph->out_offsets[source + 1]; o++) {
+                int w = graph->out_targets[o];
+                if (!marked[w]) {
+                    marked[w] = 1;
+                    nodes[count++] = w;
+                }
+            }
+        }
+    }
+    free(marked);
+
+    *active = nodes;
+    *num_active = count;
+    stats->inserted = inserted.num_edges;
+    stats->deleted = deleted.num_edges;
+    stats->new_nodes = graph->num_nodes - built_nodes;
+    stats->active_nodes = count;
+    stats->seconds = diff->seconds + (wall_time() - start);
+    guard_pop(&guards[1]);
+    guard_pop(&guards[0]);
+    edge_list_free(&inserted);
+    free_edge_diff(diff);
+}
+
+double* simulate_delta(Graph* graph, const MarkovOptions* options, const char* rank_file,
+                       const int* active, size_t num_active, MarkovStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    const int n = graph->num_nodes;
+    if (n == 0) {
+        return NULL;
+    }
+    double *ranks = malloc(n * sizeof(double));
+    int *start_nodes = malloc(n * sizeof(int));
+    unsigned char *listed = calloc(n, 1);
+    Guard guards[3];
+    guard_memory(guards, (void *[]){ ranks, start_nodes, listed }, 3);
+    if (!ranks || !start_nodes || !listed) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+    read_ranks(graph, rank_file, ranks);
+
+    // Without a diff the ranks are only a start vector; they may belong to
+    // another graph, so nothing is known to have converged
+    if (!active) {
+        for (int i = 0; i < n; i++) {
+            if (ranks[i] < 0.0) ranks[i] = 0.0;
+        }
+        markov_iterate(graph, options, ranks, stats);
+        guard_pop_memory(guards, 3);
+        free(start_nodes);
+        free(listed);
+        return ranks;
+    }
+
+    // Nodes without a previous rank (e.g. added by the diff) start from
+    // zero and join the directly affected ones
+    size_t count = 0;
+    for (size_t a = 0; a < num_active; a++) {
+        listed[active[a]] = 1;
+        start_nodes[count++] = active[a];
+    }
+    for (int i = 0; i < n; i++) {
+        if (ranks[i] < 0.0) {
+            ranks[i] = 0.0;
+            if (!listed[i]) {
+                start_nodes[count++] = i;
+            }
+        }
+    }
+
+    markov_iterate_local(graph, options, start_nodes, count, ranks, stats);
+
+    guard_pop_memory(guards, 3);
+    free(start_nodes);
+    free(listed);
+    return ranks;
+}
@@ -0,0 +1,59 @@
+#ifndef _INC_DELTA_H
+#define _INC_DELTA_H
+
+#include <stddef.h>
+#include "graph.h"
+#include "markov.h"
+
+// Incremental updates: apply an edge diff to a loaded graph and re-rank it
+// starting from the ranks of the graph before the change.
+
+typedef struct {
+    size_t inserted;
+    size_t deleted;
+    int new_nodes;
+    size_t active_nodes;    // nodes whose inputs the diff changed
+    double seconds;         // reading and applying the diff
+} DeltaStats;
+
+// Read ranks as printed by -m/-r ("<id>\t<rank>" per line, further columns
+// ignored) into ranks (num_nodes entries). Nodes without a line get -1.
+// Fails (see fail()) on unknown nodes or malformed lines.
+void read_ranks(const Graph* graph, const char* filename, double* ranks);
+
+// An edge diff file checked against a graph by read_edge_diff(). Every
+// non-empty line that is not a # comment is "+<id> -> <id>;" (insert) or
+// "-<id> -> <id>;" (delete one occurrence); inserted edges may introduce
+// new nodes.
+typedef struct {
+    char *inserted_ids;         // source and target ID of every inserted edge, NUL-terminated
+    size_t inserted_length;     // bytes of inserted_ids
+    int *deleted_sources;       // deleted edges by node index
+    int *deleted_targets;
+    size_t num_deleted;
+    unsigned char *removed;     // the occurrences they delete, one flag per edge of the graph
+    double seconds;             // reading and checking
+} EdgeDiff;
+
+// Read an edge diff file and check it against the graph, which is not
+// modified. Fails (see fail()) on malformed lines or deletions of missing
+// edges, so a bad diff leaves the graph as it was.
+void read_edge_diff(const Graph* graph, const char* filename, EdgeDiff* diff);
+
+// Apply a diff read for this graph (unchanged since) and release it. On
+// return *active (malloc'ed, *num_active entries) lists the nodes whose
+// rank the diff affects directly: all of them if it adds nodes or changes
+// which nodes are dangling, as that moves the uniform share.
+void apply_edge_diff(Graph* graph, EdgeDiff* diff, int** active, size_t* num_active, DeltaStats* stats);
+
+void free_edge_diff(EdgeDiff* diff);
+
+// -m with --ranks: warm-start the Markov chain from the ranks in
+// rank_file. After a diff (active as returned by apply_edge_diff(), not
+// NULL) these are taken as converged on the graph before it, and only the
+// active nodes and nodes missing from the file are re-converged with
+// markov_iterate_local(). Returns the ranks like simulate_markov_chain().
+double* simulate_delta(Graph* graph, const MarkovOptions* options, const char* rank_file,
+                       const int* active, size_t num_active, MarkovStats* stats);
+
+#endif /* !_INC_DELTA_H */
@@ -0,0 +1,366 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dot.h"
+#include "graph.h"
+#include "parallel.h"
+#include "error.h"
+
+
+// Characters allowed in node identifiers: [A-Za-z0-9_]
+static const unsigned char id_char[256] = {
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1,
+    ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+    ['A'] = 2, ['B'] = 2, ['C'] = 2, ['D'] = 2, ['E'] = 2, ['F'] = 2,
+    ['G'] = 2, ['H'] = 2, ['I'] = 2, ['J'] = 2, ['K'] = 2, ['L'] = 2,
+    ['M'] = 2, ['N'] = 2, ['O'] = 2, ['P'] = 2, ['Q'] = 2, ['R'] = 2,
+    ['S'] = 2, ['T'] = 2, ['U'] = 2, ['V'] = 2, ['W'] = 2, ['X'] = 2,
+    ['Y'] = 2, ['Z'] = 2,
+    ['a'] = 2, ['b'] = 2, ['c'] = 2, ['d'] = 2, ['e'] = 2, ['f'] = 2,
+    ['g'] = 2, ['h'] = 2, ['i'] = 2, ['j'] = 2, ['k'] = 2, ['l'] = 2,
+    ['m'] = 2, ['n'] = 2, ['o'] = 2, ['p'] = 2, ['q'] = 2, ['r'] = 2,
+    ['s'] = 2, ['t'] = 2, ['u'] = 2, ['v'] = 2, ['w'] = 2, ['x'] = 2,
+    ['y'] = 2, ['z'] = 2,
+    ['_'] = 1,
+};
+
+#define IS_ID_CHAR(c) (id_char[(unsigned char)(c)] != 0)
+#define IS_ALPHA(c) (id_char[(unsigned char)(c)] == 2)
+// Whitespace that does not end a line
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\v' || (c) == '\f')
+
+static const char* skip_blanks(const char* p, const char* end) {
+    while (p < end && IS_BLANK(*p)) p++;
+    return p;
+}
+
+static const char* line_end(const char* p, const char* end) {
+    const char *nl = memchr(p, '\n', end - p);
+    return nl ? nl : end;
+}
+
+// Outcome of scanning a range of edge statements
+typedef enum {
+    SCAN_END,       // reached the end of the range
+    SCAN_CLOSED,    // stopped at the closing brace
+    SCAN_BAD_EDGE,  // malformed statement
+    SCAN_BAD_NODE,  // node identifier not starting with a letter
+} ScanStatus;
+
+typedef struct {
+    ScanStatus status;
+    const char *line;   // start of the offending line
+    const char *token;  // offending node identifier
+    size_t token_len;
+} ScanResult;
+
+static _Noreturn void report_scan_error(const ScanResult* result, const char* filename, const char* end) {
+    if (result->status == SCAN_BAD_NODE) {
+        fail(PAGERANK_ERROR_FORMAT, "Node identifier '%.*s' in '%s' must start with a letter",
+             (int)result->token_len, result->token, filename);
+    }
+    fail(PAGERANK_ERROR_FORMAT, "Invalid edge format in file '%s': %.*s",
+         filename, (int)(line_end(result->line, end) - result->line), result->line);
+}
+
+// Scan one node identifier at p and intern it. Returns the position after
+// it, or NULL with the error recorded in result.
+static const char* scan_node(Graph* graph, const char* p, const char* end,
+                             ScanResult* result, int* index) {
+    const char *start = p;
+    while (p < end && IS_ID_CHAR(*p)) p++;
+    if (p == start) {
+        result->status = SCAN_BAD_EDGE;
+        return NULL;
+    }
+    if (!IS_ALPHA(*start)) {
+        result->status = SCAN_BAD_NODE;
+        result->token = start;
+        result->token_len = p - start;
+        return NULL;
+    }
+    *index = intern_node(graph, start, p - start);
+    return p;
+}
+
+// Scan the edge statements in [p, end) until the closing brace or the first
+// error. Statements never span lines: "<id> -> <id>", an optional ';', and
+// nothing but blanks up to the newline. Edges go to sink if there is one,
+// otherwise into the graph.
+static ScanResult scan_body(Graph* graph, const char* p, const char* end, EdgeSink sink, void* context) {
+    ScanResult result = { SCAN_END, NULL, NULL, 0 };
+    while (p < end) {
+        result.line = p;
+        p = skip_blanks(p, end);
+        if (p == end) break;
+
+        if (*p == '\n') {
+            p++;
+            continue;
+        }
+        if (*p == '#') {
+            p = line_end(p, end);
+            continue;
+        }
+        if (*p == '}') {
+            result.status = SCAN_CLOSED;
+            return result;
+        }
+
+        int source, target;
+        if (!(p = scan_node(graph, p, end, &result, &source))) {
+            return result;
+        }
+        p = skip_blanks(p, end);
+        if (end - p < 2 || p[0] != '-' || p[1] != '>') {
+            result.status = SCAN_BAD_EDGE;
+            return result;
+        }
+        p = skip_blanks(p + 2, end);
+        if (!(p = scan_node(graph, p, end, &result, &target))) {
+            return result;
+        }
+        p = skip_blanks(p, end);
+        if (p < end && *p == ';') {
+            p = skip_blanks(p + 1, end);
+        }
+        if (p < end && *p != '\n') {
+            result.status = SCAN_BAD_EDGE;
+            return result;
+        }
+
+        if (sink) {
+            sink(context, source, target);
+        } else {
+            add_edge_index(graph, source, target);
+        }
+    }
+    result.status = SCAN_END;
+    return result;
+}
+
+// Validate the "digraph <identifier> {" header line, store the identifier
+// as the graph name and return the start of the body.
+static const char* scan_header(Graph* graph, const char* p, const char* end, const char* filename) {
+    const char *first_line_end = line_end(p, end);
+    static const char keyword[] = "digraph";
+    const size_t keyword_len = sizeof(keyword) - 1;
+
+    p = skip_blanks(p, first_line_end);
+    if ((size_t)(first_line_end - p) <= keyword_len || memcmp(p, keyword, keyword_len) != 0 ||
+        !IS_BLANK(p[keyword_len])) {
+        goto bad_header;
+    }
+    p = skip_blanks(p + keyword_len, first_line_end);
+
+    const char *name = p;
+    while (p < first_line_end && !IS_BLANK(*p) && *p != '{') p++;
+    size_t name_len = p - name;
+    p = skip_blanks(p, first_line_end);
+    if (name_len == 0 || name_len >= MAX_ID_LENGTH || p == first_line_end || *p != '{' ||
+        skip_blanks(p + 1, first_line_end) != first_line_end) {
+        goto bad_header;
+    }
+
+    memcpy(graph->name, name, name_len);
+    graph->name[name_len] = '\0';
+
+    // Validate the graph identifier
+    if (!IS_ALPHA(graph->name[0])) {
+        fail(PAGERANK_ERROR_FORMAT, "Graph identifier '%s' in '%s' must start with a letter", graph->name, filename);
+    }
+    for (size_t i = 1; i < name_len; i++) {
+        if (!IS_ID_CHAR(graph->name[i])) {
+            fail(PAGERANK_ERROR_FORMAT, "Graph identifier '%s' in '%s' must contain only letters, numbers, or underscores", graph->name, filename);
+        }
+    }
+
+    return first_line_end < end ? first_line_end + 1 : end;
+
+bad_header:
+    fail(PAGERANK_ERROR_FORMAT, "File '%s' must start with 'digraph <identifier> {'", filename);
+}
+
+// Per-thread state of the parallel ingestion: a private graph that only
+// collects interned IDs and (local) edges, and the local-to-global index map
+typedef struct {
+    const char *begin;
+    const char *end;
+    Graph local;
+    ScanResult result;
+    int *global_index;
+} Chunk;
+
+typedef struct {
+    Chunk *chunks;
+    Graph *graph;
+    int num_chunks;
+    EdgeChunk *edge_chunks;
+} Ingest;
+
+// Release the chunks and their local graphs, also as a Guard release
+static void free_ingest(void* data) {
+    Ingest *ingest = data;
+    for (int t = 0; ingest->chunks && t < ingest->num_chunks; t++) {
+        free(ingest->chunks[t].global_index);
+        free_graph(&ingest->chunks[t].local);
+    }
+    free(ingest->chunks);
+    free(ingest->edge_chunks);
+}
+
+static void scan_chunk(void* arg, int tid, int num_threads) {
+    Ingest *ingest = arg;
+    Chunk *chunk = &ingest->chunks[tid];
+    chunk->result = scan_body(&chunk->local, chunk->begin, chunk->end, NULL, NULL);
+}
+
+static void remap_chunk(void* arg, int tid, int num_threads) {
+    Ingest *ingest = arg;
+    Graph *local = &ingest->chunks[tid].local;
+    const int *global_index = ingest->chunks[tid].global_index;
+    for (size_t e = 0; e < local->num_edges; e++) {
+        local->edge_sources[e] = global_index[local->edge_sources[e]];
+        local->edge_targets[e] = global_index[local->edge_targets[e]];
+    }
+}
+
+// Split the body at line boundaries and scan the pieces concurrently, each
+// into thread-local ID tables. The local tables are then merged in chunk
+// order, which reproduces the first-seen node order of a sequential parse
+// regardless of the thread count.
+static void scan_body_parallel(Graph* graph, const char* body, const char* end,
+                               const char* filename, int num_threads) {
+    Chunk *chunks = calloc(num_threads, sizeof(Chunk));
+    EdgeChunk *edge_chunks = malloc(num_threads * sizeof(EdgeChunk));
+    Ingest ingest = { chunks, graph, num_threads, edge_chunks };
+    Guard guard;
+    guard_push(&guard, free_ingest, &ingest);
+    if (!chunks || !edge_chunks) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for parser threads");
+    }
+    const char *begin = body;
+    for (int t = 0; t < num_threads; t++) {
+        const char *split = body + range_start(end - body, t + 1, num_threads);
+        if (split < begin) split = begin;
+        split = line_end(split, end);
+        if (split < end) split++;
+        chunks[t].begin = begin;
+        chunks[t].end = split;
+        init_graph(&chunks[t].local);
+        begin = split;
+    }
+
+    run_parallel(num_threads, scan_chunk, &ingest);
+
+    // Everything after the closing brace is ignored, errors included
+    int used = num_threads;
+    for (int t = 0; t < num_threads; t++) {
+        if (chunks[t].result.status == SCAN_BAD_EDGE || chunks[t].result.status == SCAN_BAD_NODE) {
+            report_scan_error(&chunks[t].result, filename, end);
+        }
+        if (chunks[t].result.status == SCAN_CLOSED) {
+            used = t + 1;
+            break;
+        }
+    }
+
+    for (int t = 0; t < used; t++) {
+        Graph *local = &chunks[t].local;
+        chunks[t].global_index = malloc((local->num_nodes ? local->num_nodes : 1) * sizeof(int));
+        if (!chunks[t].global_index) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for parser threads");
+        }
+        for (int i = 0; i < local->num_nodes; i++) {
+            chunks[t].global_index[i] = intern_node(graph, node_id(local, i),
+                                                    idtable_length(&local->ids, i));
+        }
+        idtable_free(&local->ids);
+    }
+    run_parallel(used, remap_chunk, &ingest);
+
+    for (int t = 0; t < used; t++) {
+        edge_chunks[t] = (EdgeChunk){ chunks[t].local.edge_sources, chunks[t].local.edge_targets,
+                                      chunks[t].local.num_edges };
+    }
+    finalize_graph_chunks(graph, edge_chunks, used);
+
+    guard_pop(&guard);
+    free_ingest(&ingest);
+}
+
+typedef struct {
+    const char *data;
+    size_t size;
+} DotMapping;
+
+static void unmap_dot_file(void* data) {
+    DotMapping *mapping = data;
+    munmap((void *)mapping->data, mapping->size);
+}
+
+// Map the whole file read-only for a sequential scan
+static void map_dot_file(const char* filename, DotMapping* mapping) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fail(PAGERANK_ERROR_IO, "Could not open file %s", filename);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    mapping->size = st.st_size;
+
+    mapping->data = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping->data == MAP_FAILED) {
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    madvise((void *)mapping->data, mapping->size, MADV_SEQUENTIAL);
+}
+
+size_t parse_dot_file(Graph* graph, const char* filename, int num_threads) {
+    DotMapping mapping;
+    map_dot_file(filename, &mapping);
+    Guard guard;
+    guard_push(&guard, unmap_dot_file, &mapping);
+    const char *data = mapping.data, *end = data + mapping.size;
+    const char *body = scan_header(graph, data, end, filename);
+    if (num_threads > 1) {
+        scan_body_parallel(graph, body, end, filename, num_threads);
+    } else {
+        ScanResult result = scan_body(graph, body, end, NULL, NULL);
+        if (result.status == SCAN_BAD_EDGE || result.status == SCAN_BAD_NODE) {
+            report_scan_error(&result, filename, end);
+        }
+        finalize_graph(graph);
+    }
+
+    guard_pop(&guard);
+    unmap_dot_file(&mapping);
+    return mapping.size;
+}
+
+size_t stream_dot_file(Graph* graph, const char* filename, EdgeSink sink, void* context) {
+    DotMapping mapping;
+    map_dot_file(filename, &mapping);
+    Guard guard;
+    guard_push(&guard, unmap_dot_file, &mapping);
+    const char *data = mapping.data, *end = data + mapping.size;
+    const char *body = scan_header(graph, data, end, filename);
+    ScanResult result = scan_body(graph, body, end, sink, context);
+    if (result.status == SCAN_BAD_EDGE || result.status == SCAN_BAD_NODE) {
+        report_scan_error(&result, filename, end);
+    }
+    guard_pop(&guard);
+    unmap_dot_file(&mapping);
+    return mapping.size;
+}
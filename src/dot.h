@@ -0,0 +1,30 @@
+#ifndef _INC_DOT_H
+#define _INC_DOT_H
+
+#include <stddef.h>
+#include "graph.h"
+
+// Parse a DOT file of the form
+//
+//   digraph <identifier> {
+//   <id> -> <id>;
+//   # comment
+//   }
+//
+// into the graph and finalize its sparse store. The file is mapped into
+// memory and scanned in a single pass; node IDs are interned straight from
+// the mapping without copying lines. With num_threads > 1 the body is split
+// into that many chunks which are scanned in parallel; the resulting node
+// order and sparse store are identical to the sequential parse. Fails (see
+// fail()) on malformed input. Returns the number of bytes parsed.
+size_t parse_dot_file(Graph* graph, const char* filename, int num_threads);
+
+typedef void (*EdgeSink)(void* context, int source, int target);
+
+// Scan a DOT file like parse_dot_file() on one thread, but hand every edge
+// to sink instead of keeping it: the graph only collects the node IDs and
+// its name, so memory stays proportional to the number of nodes. The
+// graph is not finalized. Returns the number of bytes scanned.
+size_t stream_dot_file(Graph* graph, const char* filename, EdgeSink sink, void* context);
+
+#endif /* !_INC_DOT_H */
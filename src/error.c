@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include "error.h"
+
+
+// Innermost trap of this thread; worker threads get one per task (see
+// run_parallel())
+static _Thread_local ErrorTrap *current_trap;
+
+void trap_init(ErrorTrap* trap, ErrorReport* report) {
+    trap->report = report;
+    trap->outer = current_trap;
+    trap->guards = NULL;
+    report->status = PAGERANK_OK;
+    report->message[0] = '\0';
+}
+
+void trap_enter(ErrorTrap* trap) {
+    current_trap = trap;
+}
+
+void trap_leave(ErrorTrap* trap) {
+    current_trap = trap->outer;
+}
+
+void guard_push(Guard* guard, void (*release)(void* resource), void* resource) {
+    guard->release = release;
+    guard->resource = resource;
+    guard->trap = current_trap;
+    if (current_trap) {
+        guard->next = current_trap->guards;
+        current_trap->guards = guard;
+    }
+}
+
+void guard_pop(Guard* guard) {
+    if (!guard->trap) {
+        return;
+    }
+    for (Guard **link = &guard->trap->guards; *link; link = &(*link)->next) {
+        if (*link == guard) {
+            *link = guard->next;
+            break;
+        }
+    }
+    guard->trap = NULL;
+}
+
+void guard_memory(Guard* guards, void* const* blocks, int count) {
+    for (int i = 0; i < count; i++) {
+        guard_push(&guards[i], free, blocks[i]);
+    }
+}
+
+void guard_pop_memory(Guard* guards, int count) {
+    // Newest first, each is then found at the head of the list
+    for (int i = count - 1; i >= 0; i--) {
+        guard_pop(&guards[i]);
+    }
+}
+
+void release_file(void* file) {
+    fclose(file);
+}
+
+void release_line(void* line) {
+    free(*(char **)line);
+}
+
+// message is printed as it is if it ends with an errno description
+static _Noreturn void raise_error(PagerankStatus status, const char* message, int with_errno) {
+    ErrorTrap *trap = current_trap;
+    if (!trap) {
+        fprintf(stderr, with_errno ? "%s\n" : "Error: %s\n", message);
+        exit(1);
+    }
+    trap->report->status = status;
+    snprintf(trap->report->message, sizeof(trap->report->message), "%s", message);
+    current_trap = trap->outer;
+    // A release must not fail() itself
+    for (Guard *guard = trap->guards; guard; guard = guard->next) {
+        guard->release(guard->resource);
+    }
+    trap->guards = NULL;
+    longjmp(trap->env, 1);
+}
+
+void fail(PagerankStatus status, const char* format, ...) {
+    char message[sizeof(((ErrorReport *)0)->message)];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    raise_error(status, message, 0);
+}
+
+void fail_errno(PagerankStatus status, const char* format, ...) {
+    const char *description = strerror(errno);
+    char message[sizeof(((ErrorReport *)0)->message)];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (length >= 0 && (size_t)length < sizeof(message)) {
+        snprintf(message + length, sizeof(message) - length, ": %s", description);
+    }
+    raise_error(status, message, 1);
+}
@@ -0,0 +1,79 @@
+#ifndef _INC_ERROR_H
+#define _INC_ERROR_H
+
+#include <setjmp.h>
+#include "pagerank.h"
+
+// Fatal errors. Without a trap, fail() prints the message on stderr and
+// exits with status 1, as the command line tool always did. An entry point
+// of the library sets a trap first; fail() on the same thread then records
+// the status and message and unwinds to it:
+//
+//   ErrorTrap trap;
+//   trap_init(&trap, &report);
+//   if (setjmp(trap.env)) return report.status;
+//   trap_enter(&trap);
+//   ...
+//   trap_leave(&trap);
+//
+// The report lives outside the function that calls setjmp(), since its
+// local variables are indeterminate after the jump.
+
+typedef struct {
+    PagerankStatus status;
+    char message[512];
+} ErrorReport;
+
+// A resource a call holds while it may fail: while a trap is set, fail()
+// releases the guarded resources of its thread, newest first, before it
+// unwinds. Without a trap the process exits and they need no release.
+//
+//   FILE *file = fopen(...);
+//   Guard guard;
+//   guard_push(&guard, close_file, file);
+//   ...                            // may fail()
+//   guard_pop(&guard);
+//   fclose(file);
+//
+// A guard lives on the stack of the function holding the resource and must
+// be popped before that function returns.
+typedef struct Guard {
+    void (*release)(void* resource);
+    void *resource;
+    struct Guard *next;
+    struct ErrorTrap *trap;     // the trap it is registered with, or NULL
+} Guard;
+
+typedef struct ErrorTrap {
+    jmp_buf env;
+    ErrorReport *report;
+    struct ErrorTrap *outer;
+    Guard *guards;
+} ErrorTrap;
+
+void trap_init(ErrorTrap* trap, ErrorReport* report);
+void trap_enter(ErrorTrap* trap);
+void trap_leave(ErrorTrap* trap);
+
+void guard_push(Guard* guard, void (*release)(void* resource), void* resource);
+void guard_pop(Guard* guard);
+
+// Guard count malloc'ed blocks, NULL ones included, with free(); popped
+// together by guard_pop_memory()
+void guard_memory(Guard* guards, void* const* blocks, int count);
+void guard_pop_memory(Guard* guards, int count);
+
+// Releases for common resources: a FILE* (fclose()) and a char* line
+// buffer as grown by getline() (free(), given the address of the pointer)
+void release_file(void* file);
+void release_line(void* line);
+
+// Printed as "Error: <message>"
+_Noreturn void fail(PagerankStatus status, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Printed like perror(): "<message>: <description of errno>"
+_Noreturn void fail_errno(PagerankStatus status, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#endif /* !_INC_ERROR_H */
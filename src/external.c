@@ -0,0 +1,599 @@
+#define _GNU_SOURCE     // O_DIRECT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "external.h"
+#include "dot.h"
+#include "utils.h"
+#include "error.h"
+
+
+#define BYTE_ORDER_MARK 0x01020304u
+#define SECTION_ALIGN 8
+
+// Edges buffered by the converter before a write
+#define WRITE_CHUNK (1 << 19)
+
+// Bytes per read of the streaming reader, a multiple of EDGES_ALIGN. Two
+// buffers: the reader fills one while the iteration consumes the other.
+#define STREAM_CHUNK (8 << 20)
+#define STREAM_BUFFERS 2
+
+int is_edge_file(const char* filename) {
+    char magic[sizeof(EDGES_MAGIC)];
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        return 0;
+    }
+    int match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, EDGES_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return match;
+}
+
+static void release_fd(void* fd) {
+    close(*(int *)fd);
+}
+
+// --- Conversion ---
+
+typedef struct {
+    int fd;
+    const char *filename;
+    Graph *graph;
+    EdgeRecord *buffer;
+    size_t buffered;
+    size_t num_edges;
+    uint32_t *out_degrees;
+    size_t degrees_capacity;
+} Converter;
+
+static void release_converter(void* context) {
+    Converter *converter = context;
+    if (converter->fd >= 0) {
+        close(converter->fd);
+    }
+    free(converter->buffer);
+    free(converter->out_degrees);
+}
+
+static void write_or_die(int fd, const void* data, size_t size, const char* filename) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            fail_errno(PAGERANK_ERROR_IO, "Could not write edge file %s", filename);
+        }
+        p += written;
+        size -= written;
+    }
+}
+
+static void flush_edges(Converter* converter) {
+    write_or_die(converter->fd, converter->buffer, converter->buffered * sizeof(EdgeRecord), converter->filename);
+    converter->buffered = 0;
+}
+
+static void convert_edge(void* context, int source, int target) {
+    Converter *converter = context;
+    if ((size_t)converter->graph->num_nodes > converter->degrees_capacity) {
+        size_t capacity = 2 * converter->degrees_capacity;
+        while (capacity < (size_t)converter->graph->num_nodes) capacity *= 2;
+        uint32_t *degrees = realloc(converter->out_degrees, capacity * sizeof(uint32_t));
+        if (!degrees) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for the edge stream");
+        }
+        memset(degrees + converter->degrees_capacity, 0,
+               (capacity - converter->degrees_capacity) * sizeof(uint32_t));
+        converter->out_degrees = degrees;
+        converter->degrees_capacity = capacity;
+    }
+    converter->out_degrees[source]++;
+    converter->buffer[converter->buffered++] = (EdgeRecord){ (uint32_t)source, (uint32_t)target };
+    converter->num_edges++;
+    if (converter->buffered == WRITE_CHUNK) {
+        flush_edges(converter);
+    }
+}
+
+size_t convert_dot_to_edges(const char* dot_filename, const char* edge_filename) {
+    Graph graph;
+    init_graph(&graph);
+    Guard graph_guard;
+    guard_push(&graph_guard, release_graph, &graph);
+    Converter converter = { -1, edge_filename, &graph, NULL, 0, 0, NULL, 1024 };
+    converter.buffer = malloc(WRITE_CHUNK * sizeof(EdgeRecord));
+    converter.out_degrees = calloc(converter.degrees_capacity, sizeof(uint32_t));
+    Guard converter_guard;
+    guard_push(&converter_guard, release_converter, &converter);
+    if (!converter.buffer || !converter.out_degrees) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for the edge stream");
+    }
+    converter.fd = open(edge_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (converter.fd < 0) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not open edge file %s", edge_filename);
+    }
+
+    // The edges go first, behind room for the header, which is written last
+    if (lseek(converter.fd, EDGES_ALIGN, SEEK_SET) < 0) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not write edge file %s", edge_filename);
+    }
+    size_t bytes = stream_dot_file(&graph, dot_filename, convert_edge, &converter);
+    flush_edges(&converter);
+
+    const size_t num_nodes = graph.num_nodes;
+    size_t zero_offset = 0;
+    const void *data[NUM_EDGE_SECTIONS] = {
+        [EDGE_SECTION_OUT_DEGREES] = converter.out_degrees,
+        // An empty ID table has not allocated its offsets yet
+        [EDGE_SECTION_ID_OFFSETS] = graph.ids.offsets ? (const void *)graph.ids.offsets : &zero_offset,
+        [EDGE_SECTION_ID_ARENA] = graph.ids.arena,
+        [EDGE_SECTION_ID_SLOTS] = graph.ids.slots,
+    };
+    const size_t sizes[NUM_EDGE_SECTIONS] = {
+        [EDGE_SECTION_EDGES] = converter.num_edges * sizeof(EdgeRecord),
+        [EDGE_SECTION_OUT_DEGREES] = num_nodes * sizeof(uint32_t),
+        [EDGE_SECTION_ID_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [EDGE_SECTION_ID_ARENA] = graph.ids.arena_len,
+        [EDGE_SECTION_ID_SLOTS] = graph.ids.num_slots * sizeof(int),
+    };
+
+    EdgeFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EDGES_MAGIC, sizeof(EDGES_MAGIC));
+    header.version = EDGES_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.offset_size = sizeof(size_t);
+    header.index_size = sizeof(int);
+    header.num_nodes = num_nodes;
+    header.num_edges = converter.num_edges;
+    header.num_slots = graph.ids.num_slots;
+    memcpy(header.name, graph.name, sizeof(header.name));
+
+    uint64_t position = EDGES_ALIGN;
+    static const char padding[SECTION_ALIGN];
+    for (int s = 0; s < NUM_EDGE_SECTIONS; s++) {
+        uint64_t aligned = (position + SECTION_ALIGN - 1) & ~(uint64_t)(SECTION_ALIGN - 1);
+        if (s != EDGE_SECTION_EDGES) {
+            write_or_die(converter.fd, padding, aligned - position, edge_filename);
+            write_or_die(converter.fd, data[s], sizes[s], edge_filename);
+        }
+        header.sections[s].offset = aligned;
+        header.sections[s].size = sizes[s];
+        position = aligned + sizes[s];
+    }
+    int written = pwrite(converter.fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    // A failed close() has released the descriptor all the same
+    int closed = close(converter.fd) == 0;
+    converter.fd = -1;
+    if (!written || !closed) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not write edge file %s", edge_filename);
+    }
+
+    guard_pop(&converter_guard);
+    guard_pop(&graph_guard);
+    free(converter.buffer);
+    free(converter.out_degrees);
+    free_graph(&graph);
+    return bytes;
+}
+
+// --- Reading ---
+
+static _Noreturn void bad_edge_file(const char* filename, const char* reason) {
+    fail(PAGERANK_ERROR_FORMAT, "Invalid edge file '%s': %s", filename, reason);
+}
+
+// Check the header against the file size; the sections must be in bounds
+static void check_header(const EdgeFileHeader* header, size_t size, const char* filename) {
+    if (size < sizeof(EdgeFileHeader) || memcmp(header->magic, EDGES_MAGIC, sizeof(EDGES_MAGIC)) != 0) {
+        bad_edge_file(filename, "bad magic");
+    }
+    if (header->version != EDGES_VERSION) {
+        bad_edge_file(filename, "unsupported version");
+    }
+    if (header->byte_order != BYTE_ORDER_MARK || header->offset_size != sizeof(size_t) ||
+        header->index_size != sizeof(int)) {
+        bad_edge_file(filename, "written on an incompatible host");
+    }
+    if (header->num_nodes > INT_MAX || header->num_slots > INT_MAX || header->num_edges > size ||
+        memchr(header->name, '\0', sizeof(header->name)) == NULL) {
+        bad_edge_file(filename, "corrupt header");
+    }
+    uint64_t num_nodes = header->num_nodes;
+    const uint64_t expected[NUM_EDGE_SECTIONS] = {
+        [EDGE_SECTION_EDGES] = header->num_edges * sizeof(EdgeRecord),
+        [EDGE_SECTION_OUT_DEGREES] = num_nodes * sizeof(uint32_t),
+        [EDGE_SECTION_ID_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [EDGE_SECTION_ID_ARENA] = header->sections[EDGE_SECTION_ID_ARENA].size,
+        [EDGE_SECTION_ID_SLOTS] = header->num_slots * sizeof(int),
+    };
+    for (int s = 0; s < NUM_EDGE_SECTIONS; s++) {
+        const SnapshotSection *section = &header->sections[s];
+        uint64_t align = s == EDGE_SECTION_EDGES ? EDGES_ALIGN : SECTION_ALIGN;
+        if (section->size != expected[s] || section->offset % align != 0 || section->offset > size ||
+            section->size > size - section->offset) {
+            bad_edge_file(filename, "section out of bounds");
+        }
+    }
+}
+
+size_t open_edge_file(Graph* graph, const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fail(PAGERANK_ERROR_IO, "Could not open file %s", filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    size_t size = st.st_size;
+    if (size < sizeof(EdgeFileHeader)) {
+        close(fd);
+        bad_edge_file(filename, "truncated header");
+    }
+    char *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    // The edges are only ever read by simulate_external()
+    madvise(data, size, MADV_RANDOM);
+    // The graph takes the mapping over once the file has proven valid
+    Graph mapped;
+    init_graph(&mapped);
+    mapped.mapping = data;
+    mapped.mapping_size = size;
+    Guard mapping_guard;
+    guard_push(&mapping_guard, release_graph, &mapped);
+
+    const EdgeFileHeader *header = (const EdgeFileHeader *)data;
+    check_header(header, size, filename);
+    uint64_t num_nodes = header->num_nodes;
+    memcpy(mapped.name, header->name, sizeof(mapped.name));
+    mapped.num_nodes = (int)num_nodes;
+    mapped.num_edges = header->num_edges;
+    mapped.ids.arena = data + header->sections[EDGE_SECTION_ID_ARENA].offset;
+    mapped.ids.arena_len = header->sections[EDGE_SECTION_ID_ARENA].size;
+    mapped.ids.offsets = (size_t *)(data + header->sections[EDGE_SECTION_ID_OFFSETS].offset);
+    mapped.ids.num_ids = (int)num_nodes;
+    mapped.ids.slots = (int *)(data + header->sections[EDGE_SECTION_ID_SLOTS].offset);
+    mapped.ids.num_slots = header->num_slots;
+    // Every ID offset and slot, so a corrupt file cannot make the ID
+    // lookups read out of bounds
+    if (!idtable_valid(&mapped.ids)) {
+        bad_edge_file(filename, "inconsistent sections");
+    }
+
+    guard_pop(&mapping_guard);
+    *graph = mapped;
+    return size;
+}
+
+// --- Streaming ---
+
+// The edge section read over and over by a background thread, pass after
+// pass, into a ring of STREAM_BUFFERS buffers
+typedef struct {
+    int fd;
+    uint64_t begin;             // file offset of the edges
+    uint64_t size;              // bytes of edges per pass
+    unsigned char *buffers[STREAM_BUFFERS];
+    size_t filled[STREAM_BUFFERS];  // bytes of edges in a full buffer, 0 if empty
+    int full[STREAM_BUFFERS];
+    int next;                   // buffer the consumer takes next
+    int error;                  // errno of a failed read
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t thread;
+} EdgeStream;
+
+// Read length bytes at offset, retrying short reads; a read past the end of
+// the file is only an error if it ends before the edges do
+static int read_fully(int fd, unsigned char* buffer, size_t length, uint64_t offset, size_t needed) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t got = pread(fd, buffer + done, length - done, offset + done);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            return errno;
+        }
+        if (got == 0) {
+            return done >= needed ? 0 : EIO;
+        }
+        done += got;
+    }
+    return 0;
+}
+
+static void* stream_main(void* arg) {
+    EdgeStream *stream = arg;
+    uint64_t position = 0;
+    for (int b = 0;; b = (b + 1) % STREAM_BUFFERS) {
+        pthread_mutex_lock(&stream->lock);
+        while (stream->full[b] && !stream->stop) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        int stop = stream->stop;
+        pthread_mutex_unlock(&stream->lock);
+        if (stop) {
+            break;
+        }
+
+        // Whole aligned blocks, even at the end of the section
+        size_t needed = stream->size - position < STREAM_CHUNK ? stream->size - position : STREAM_CHUNK;
+        size_t length = (needed + EDGES_ALIGN - 1) & ~(size_t)(EDGES_ALIGN - 1);
+        int error = read_fully(stream->fd, stream->buffers[b], length, stream->begin + position, needed);
+
+        pthread_mutex_lock(&stream->lock);
+        stream->filled[b] = needed;
+        stream->full[b] = 1;
+        stream->error = error;
+        pthread_cond_broadcast(&stream->changed);
+        pthread_mutex_unlock(&stream->lock);
+        if (error) {
+            break;
+        }
+        position += needed;
+        if (position == stream->size) {
+            position = 0;
+        }
+    }
+    return NULL;
+}
+
+// Take the next chunk of edges; its size is returned in bytes
+static const EdgeRecord* stream_take(EdgeStream* stream, size_t* bytes, double* wait_seconds,
+                                     const char* filename) {
+    int b = stream->next;
+    pthread_mutex_lock(&stream->lock);
+    if (!stream->full[b]) {
+        double start = wall_time();
+        while (!stream->full[b]) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        *wait_seconds += wall_time() - start;
+    }
+    int error = stream->error;
+    pthread_mutex_unlock(&stream->lock);
+    if (error) {
+        errno = error;
+        fail_errno(PAGERANK_ERROR_IO, "Could not read edge file %s", filename);
+    }
+    *bytes = stream->filled[b];
+    return (const EdgeRecord *)stream->buffers[b];
+}
+
+// Hand the chunk taken last back to the reader
+static void stream_release(EdgeStream* stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->full[stream->next] = 0;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    stream->next = (stream->next + 1) % STREAM_BUFFERS;
+}
+
+// The file and buffers of a stream whose reader is not running
+static void release_stream_files(void* context) {
+    EdgeStream *stream = context;
+    if (stream->fd >= 0) {
+        close(stream->fd);
+    }
+    for (int b = 0; b < STREAM_BUFFERS; b++) {
+        free(stream->buffers[b]);
+    }
+}
+
+// Open the edges for streaming; with O_DIRECT if they exceed the physical
+// memory and the file system supports it
+static void stream_open(EdgeStream* stream, const char* filename, uint64_t begin, uint64_t size, int* direct) {
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = -1;
+    stream->begin = begin;
+    stream->size = size;
+    Guard guard;
+    guard_push(&guard, release_stream_files, stream);
+    for (int b = 0; b < STREAM_BUFFERS; b++) {
+        int error = posix_memalign((void **)&stream->buffers[b], EDGES_ALIGN, STREAM_CHUNK);
+        if (error) {
+            stream->buffers[b] = NULL;
+            errno = error;
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for the edge stream");
+        }
+    }
+    long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGE_SIZE);
+    *direct = 0;
+    if (pages > 0 && page_size > 0 && size > (uint64_t)pages * page_size) {
+        stream->fd = open(filename, O_RDONLY | O_DIRECT);
+        // Some file systems (tmpfs) refuse O_DIRECT only when reading
+        if (stream->fd >= 0 && read_fully(stream->fd, stream->buffers[0], EDGES_ALIGN, 0, 0) != 0) {
+            close(stream->fd);
+            stream->fd = -1;
+        }
+        *direct = stream->fd >= 0;
+    }
+    if (stream->fd < 0) {
+        stream->fd = open(filename, O_RDONLY);
+        if (stream->fd < 0) {
+            fail(PAGERANK_ERROR_IO, "Could not open file %s", filename);
+        }
+        posix_fadvise(stream->fd, begin, size, POSIX_FADV_SEQUENTIAL);
+    }
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+    int error = pthread_create(&stream->thread, NULL, stream_main, stream);
+    if (error) {
+        pthread_cond_destroy(&stream->changed);
+        pthread_mutex_destroy(&stream->lock);
+        errno = error;
+        fail_errno(PAGERANK_ERROR_SYSTEM, "Failed to create thread");
+    }
+    guard_pop(&guard);
+}
+
+// Stop the reader and release the stream
+static void stream_close(EdgeStream* stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->stop = 1;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+    pthread_cond_destroy(&stream->changed);
+    pthread_mutex_destroy(&stream->lock);
+    release_stream_files(stream);
+}
+
+static void release_stream(void* stream) {
+    stream_close(stream);
+}
+
+double* simulate_external(const char* filename, const MarkovOptions* options, MarkovStats* stats,
+                          StreamStats* stream_stats) {
+    memset(stats, 0, sizeof(*stats));
+    memset(stream_stats, 0, sizeof(*stream_stats));
+    stats->solver = SOLVER_JACOBI;
+    stats->kernels = "streaming";
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fail(PAGERANK_ERROR_IO, "Could not open file %s", filename);
+    }
+    Guard fd_guard;
+    guard_push(&fd_guard, release_fd, &fd);
+    struct stat st;
+    EdgeFileHeader header;
+    if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    check_header(&header, st.st_size, filename);
+    const int n = (int)header.num_nodes;
+    if (n == 0) {
+        guard_pop(&fd_guard);
+        close(fd);
+        return NULL;
+    }
+
+    // The only per-node state: ranks, the incoming sums and contributions
+    // and the inverse out-degrees
+    double *ranks = malloc(n * sizeof(double));
+    double *sums = calloc(n, sizeof(double));
+    double *contrib = malloc(n * sizeof(double));
+    double *inv_degree = malloc(n * sizeof(double));
+    uint32_t *degrees = malloc(n * sizeof(uint32_t));
+    Guard guards[5];
+    guard_memory(guards, (void *[]){ ranks, sums, contrib, inv_degree, degrees }, 5);
+    if (!ranks || !sums || !contrib || !inv_degree || !degrees) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for the edge stream");
+    }
+    const SnapshotSection *section = &header.sections[EDGE_SECTION_OUT_DEGREES];
+    if (pread(fd, degrees, section->size, section->offset) != (ssize_t)section->size) {
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    guard_pop(&guards[4]);
+    guard_pop(&fd_guard);
+    close(fd);
+    for (int i = 0; i < n; ++i) {
+        inv_degree[i] = degrees[i] ? 1.0 / degrees[i] : 0.0;
+    }
+    free(degrees);
+
+    double start = wall_time();
+    const double damping = 1.0 - options->teleport_prob;
+    double dangle_sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        ranks[i] = 1.0 / n;
+        contrib[i] = ranks[i] * inv_degree[i];
+        if (inv_degree[i] == 0.0) dangle_sum += ranks[i];
+    }
+
+    const uint64_t edge_bytes = header.sections[EDGE_SECTION_EDGES].size;
+    EdgeStream stream;
+    Guard stream_guard;
+    if (edge_bytes > 0) {
+        stream_open(&stream, filename, header.sections[EDGE_SECTION_EDGES].offset, edge_bytes,
+                    &stream_stats->direct);
+        // Stops the reader if a read or the edges fail
+        guard_push(&stream_guard, release_stream, &stream);
+    }
+
+    for (int k = 0; k < options->max_iterations; ++k) {
+        double iteration_start = options->iteration_seconds ? wall_time() : 0.0;
+
+        // Push the contributions along the edges as they arrive from disk
+        for (uint64_t done = 0; done < edge_bytes;) {
+            size_t bytes;
+            const EdgeRecord *edges = stream_take(&stream, &bytes, &stream_stats->wait_seconds, filename);
+            const size_t count = bytes / sizeof(EdgeRecord);
+            int in_range = 1;
+            for (size_t e = 0; e < count; ++e) {
+                uint32_t source = edges[e].source, target = edges[e].target;
+                if (source >= (uint32_t)n || target >= (uint32_t)n) {
+                    in_range = 0;
+                    break;
+                }
+                sums[target] += contrib[source];
+            }
+            stream_release(&stream);
+            if (!in_range) {
+                bad_edge_file(filename, "node index out of range");
+            }
+            done += bytes;
+            stream_stats->bytes_read += bytes;
+        }
+
+        // Teleport probability and the (1-p) share of the dangling
+        // probability are distributed uniformly
+        const double base = (options->teleport_prob + damping * dangle_sum) / n;
+        double residual_l1 = 0.0, residual_linf = 0.0;
+        dangle_sum = 0.0;
+        for (int i = 0; i < n; ++i) {
+            double value = base + damping * sums[i];
+            double diff = fabs(value - ranks[i]);
+            residual_l1 += diff;
+            if (diff > residual_linf) residual_linf = diff;
+            ranks[i] = value;
+            contrib[i] = value * inv_degree[i];
+            if (inv_degree[i] == 0.0) dangle_sum += value;
+            sums[i] = 0.0;
+        }
+        stats->edge_sweeps += 1.0;
+        if (options->iteration_seconds) {
+            options->iteration_seconds[k] = wall_time() - iteration_start;
+        }
+
+        stats->iterations = k + 1;
+        stats->residual_l1 = residual_l1;
+        stats->residual_linf = residual_linf;
+        if (options->tolerance > 0 && residual_l1 < options->tolerance) {
+            stats->converged = 1;
+            break;
+        }
+    }
+
+    if (edge_bytes > 0) {
+        guard_pop(&stream_guard);
+        stream_close(&stream);
+    }
+    guard_pop_memory(guards, 4);
+    stats->seconds = wall_time() - start;
+    free(sums);
+    free(contrib);
+    free(inv_degree);
+    return ranks;
+}
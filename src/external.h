@@ -0,0 +1,80 @@
+#ifndef _INC_EXTERNAL_H
+#define _INC_EXTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "graph.h"
+#include "markov.h"
+#include "snapshot.h"
+
+// Out-of-core edge files (.pre) for graphs whose edges do not fit in memory
+//
+// The edges are stored as (source, target) pairs of uint32 in the order of
+// the DOT file, from an EDGES_ALIGN boundary on, followed by the
+// out-degrees and the ID table laid out as in a snapshot. Ranking such a
+// file keeps only per-node arrays in memory and streams the edges from disk
+// in every iteration. Integers are in host byte order, as in snapshots.
+
+#define EDGES_MAGIC "PREDGES"
+#define EDGES_VERSION 1
+
+// Alignment of the edge section and of every read from it
+#define EDGES_ALIGN 4096
+
+enum {
+    EDGE_SECTION_EDGES,         // EdgeRecord[num_edges]
+    EDGE_SECTION_OUT_DEGREES,   // uint32_t[num_nodes]
+    EDGE_SECTION_ID_OFFSETS,    // size_t[num_nodes + 1], into the ID arena
+    EDGE_SECTION_ID_ARENA,      // NUL-terminated IDs back to back
+    EDGE_SECTION_ID_SLOTS,      // int[num_slots], the ID hash table
+    NUM_EDGE_SECTIONS
+};
+
+typedef struct {
+    uint32_t source;
+    uint32_t target;
+} EdgeRecord;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;    // 0x01020304 as written by the host
+    uint32_t offset_size;   // sizeof(size_t)
+    uint32_t index_size;    // sizeof(int)
+    uint64_t num_nodes;
+    uint64_t num_edges;
+    uint64_t num_slots;
+    char name[MAX_ID_LENGTH];
+    SnapshotSection sections[NUM_EDGE_SECTIONS];
+} EdgeFileHeader;
+
+typedef struct {
+    size_t bytes_read;      // edge data read from disk over all iterations
+    double wait_seconds;    // time the iterations waited for the reader
+    int direct;             // the reads bypassed the page cache (O_DIRECT)
+} StreamStats;
+
+// Check whether the file starts with the edge file magic
+int is_edge_file(const char* filename);
+
+// Convert a DOT file into an edge file in one sequential pass. Only the ID
+// table and the out-degrees are kept in memory; the edges are written out
+// as they are scanned. Fails (see fail()) on malformed input or I/O errors.
+// Returns the number of bytes of DOT scanned.
+size_t convert_dot_to_edges(const char* dot_filename, const char* edge_filename);
+
+// Map the ID table of an edge file into the graph, which then has node IDs
+// and counts but no sparse store (for the output of the ranks). Fails on
+// malformed files. Returns the size of the file.
+size_t open_edge_file(Graph* graph, const char* filename);
+
+// Jacobi power iteration over an edge file, with the teleport probability,
+// iteration cap, tolerance and iteration timing of options. A background
+// thread reads the edges in large aligned chunks into one of two buffers
+// while the other one is propagated, so disk and computation overlap; the
+// page cache is bypassed if the edges are larger than the physical memory.
+// Returns the ranks (malloc'ed; NULL for an empty graph).
+double* simulate_external(const char* filename, const MarkovOptions* options, MarkovStats* stats,
+                          StreamStats* stream_stats);
+
+#endif /* !_INC_EXTERNAL_H */
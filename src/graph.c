@@ -1,378 +1,888 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <sys/mman.h>
 #include "graph.h"
+#include "output.h"
+#include "parallel.h"
+#include "utils.h"
+#include "error.h"
 
 
 void init_graph(Graph* graph) {
-    graph->num_nodes = 0;
-    graph->num_edges = 0;
-    memset(graph->adjacency_matrix, 0, sizeof(graph->adjacency_matrix));
+    memset(graph, 0, sizeof(*graph));
+}
+
+void free_graph(Graph* graph) {
+    if (graph->mapping) {
+        munmap(graph->mapping, graph->mapping_size);
+        init_graph(graph);
+        return;
+    }
+    idtable_free(&graph->ids);
+    free(graph->edge_sources);
+    free(graph->edge_targets);
+    free(graph->out_offsets);
+    free(graph->out_targets);
+    free(graph->in_offsets);
+    free(graph->in_sources);
+    free(graph->packed_index);
+    free(graph->packed_sources);
+    init_graph(graph);
+}
+
+void release_graph(void* graph) {
+    free_graph(graph);
 }
 
 // Function to find a node index by ID
 int find_node_index(Graph* graph, const char* id) {
-    for (int i = 0; i < graph->num_nodes; i++) {
-        if (strcmp(graph->nodes[i].id, id) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return idtable_find(&graph->ids, id, strlen(id));
+}
+
+// Add a node given as an ID that need not be NUL-terminated
+int intern_node(Graph* graph, const char* id, size_t len) {
+    int index = idtable_intern(&graph->ids, id, len);
+    graph->num_nodes = graph->ids.num_ids;
+    return index;
 }
 
 // Function to add a node to the graph
 int add_node(Graph* graph, const char* id) {
-    int index = find_node_index(graph, id);
-    if (index != -1) {
-        return index; // Node already exists
-    }
-    if (graph->num_nodes >= MAX_NODES) {
-        fprintf(stderr, "Error: Maximum number of nodes reached\n");
-        exit(1);
-    }
-    strncpy(graph->nodes[graph->num_nodes].id, id, MAX_ID_LENGTH - 1);
-    graph->nodes[graph->num_nodes].id[MAX_ID_LENGTH - 1] = '\0';
-    graph->nodes[graph->num_nodes].in_degree = 0;
-    graph->nodes[graph->num_nodes].out_degree = 0;
-    return graph->num_nodes++;
+    return intern_node(graph, id, strlen(id));
 }
 
-// Function to add an edge between two nodes
+// Function to add an edge between two nodes. Parallel edges are kept, so a
+// link that appears twice carries twice the weight.
 void add_edge(Graph* graph, const char* source_id, const char* target_id) {
     int source_index = add_node(graph, source_id);
     int target_index = add_node(graph, target_id);
+    add_edge_index(graph, source_index, target_index);
+}
 
-    if (!graph->adjacency_matrix[source_index][target_index]) {
-        graph->adjacency_matrix[source_index][target_index] = 1;
-        graph->nodes[source_index].out_degree++;
-        graph->nodes[target_index].in_degree++;
-        graph->num_edges++;
+// Add an edge between two already interned nodes
+void add_edge_index(Graph* graph, int source_index, int target_index) {
+    if (graph->num_edges == graph->edges_capacity) {
+        size_t capacity = graph->edges_capacity ? 2 * graph->edges_capacity : 256;
+        int *sources = realloc(graph->edge_sources, capacity * sizeof(int));
+        if (sources) graph->edge_sources = sources;
+        int *targets = realloc(graph->edge_targets, capacity * sizeof(int));
+        if (targets) graph->edge_targets = targets;
+        if (!sources || !targets) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for edges");
+        }
+        graph->edges_capacity = capacity;
     }
+    graph->edge_sources[graph->num_edges] = source_index;
+    graph->edge_targets[graph->num_edges] = target_index;
+    graph->num_edges++;
 }
 
-// Function to parse a DOT file and build the graph
-void parse_dot_file(Graph* graph, const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open file %s\n", filename);
-        exit(1); // Or return an error code
-    }
-
-    char line[1024];
-    // Validate the header line
-    if (!fgets(line, sizeof(line), file)) {
-        fprintf(stderr, "Error: File is empty or could not be read: %s\n", filename);
-        fclose(file);
-        exit(1); // Or return an error code
-    }
-
-    char graph_id[MAX_ID_LENGTH];
-    // Use width specifier for safety
-    if (sscanf(line, " digraph %255s {", graph_id) != 1) { // Check for leading whitespace too
-        // Try without space in case format is strict 'digraph G {'
-        if (sscanf(line, "digraph %255s {", graph_id) != 1) {
-             fprintf(stderr, "Error: File '%s' must start with 'digraph <identifier> {'\n", filename);
-             fclose(file);
-             exit(1); // Or return an error code
-        }
+// Bucket the collected edges by one endpoint (counting sort), producing the
+// offsets/neighbors arrays of a compressed sparse row or column.
+static void build_compressed(int num_nodes, size_t num_edges,
+                             const int* keys, const int* values,
+                             size_t** offsets_out, int** neighbors_out) {
+    size_t *offsets = calloc((size_t)num_nodes + 1, sizeof(size_t));
+    int *neighbors = malloc((num_edges ? num_edges : 1) * sizeof(int));
+    if (!offsets || !neighbors) {
+        free(offsets);
+        free(neighbors);
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
     }
 
+    for (size_t e = 0; e < num_edges; e++) {
+        offsets[keys[e] + 1]++;
+    }
+    for (int i = 0; i < num_nodes; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    // Use offsets[i] as the insertion cursor of bucket i, then shift back
+    for (size_t e = 0; e < num_edges; e++) {
+        neighbors[offsets[keys[e]]++] = values[e];
+    }
+    for (int i = num_nodes; i > 0; i--) {
+        offsets[i] = offsets[i - 1];
+    }
+    offsets[0] = 0;
+
+    *offsets_out = offsets;
+    *neighbors_out = neighbors;
+}
+
+// Release the arrays of the sparse store, including a packed CSC. The
+// graph stays freeable if rebuilding the store fails.
+static void free_sparse_store(Graph* graph) {
+    free(graph->out_offsets);
+    free(graph->out_targets);
+    free(graph->in_offsets);
+    free(graph->in_sources);
+    free(graph->packed_index);
+    free(graph->packed_sources);
+    graph->out_offsets = NULL;
+    graph->out_targets = NULL;
+    graph->in_offsets = NULL;
+    graph->in_sources = NULL;
+    graph->packed_index = NULL;
+    graph->packed_sources = NULL;
+}
+
+// Build the CSR and CSC stores from the edges collected by add_edge()
+void finalize_graph(Graph* graph) {
+    free_sparse_store(graph);
+
+    build_compressed(graph->num_nodes, graph->num_edges,
+                     graph->edge_sources, graph->edge_targets,
+                     &graph->out_offsets, &graph->out_targets);
+    build_compressed(graph->num_nodes, graph->num_edges,
+                     graph->edge_targets, graph->edge_sources,
+                     &graph->in_offsets, &graph->in_sources);
+
+    free(graph->edge_sources);
+    free(graph->edge_targets);
+    graph->edge_sources = NULL;
+    graph->edge_targets = NULL;
+    graph->edges_capacity = 0;
+}
+
+// State of a parallel stable counting sort of the edges in several chunks.
+// Nodes are split into one contiguous key range per thread; every edge is
+// first scattered into the bucket of its key range (chunk order preserved),
+// then each thread counting-sorts its own bucket.
+typedef struct {
+    const EdgeChunk *chunks;
+    int num_threads;
+    int num_nodes;
+    int bucket_width;
+    int by_target;          // key edges by target (CSC) instead of source (CSR)
+    size_t *cursors;        // [thread][bucket] scatter positions
+    size_t *bucket_starts;  // num_threads + 1 entries
+    int *bucket_keys;
+    int *bucket_values;
+    size_t *offsets;
+    int *neighbors;
+} ChunkSort;
+
+static void chunk_histogram(void* arg, int tid, int num_threads) {
+    ChunkSort *sort = arg;
+    const EdgeChunk *chunk = &sort->chunks[tid];
+    const int *keys = sort->by_target ? chunk->targets : chunk->sources;
+    size_t *counts = sort->cursors + (size_t)tid * num_threads;
+    for (size_t e = 0; e < chunk->num_edges; e++) {
+        counts[keys[e] / sort->bucket_width]++;
+    }
+}
+
+static void chunk_scatter(void* arg, int tid, int num_threads) {
+    ChunkSort *sort = arg;
+    const EdgeChunk *chunk = &sort->chunks[tid];
+    const int *keys = sort->by_target ? chunk->targets : chunk->sources;
+    const int *values = sort->by_target ? chunk->sources : chunk->targets;
+    size_t *cursors = sort->cursors + (size_t)tid * num_threads;
+    for (size_t e = 0; e < chunk->num_edges; e++) {
+        size_t pos = cursors[keys[e] / sort->bucket_width]++;
+        sort->bucket_keys[pos] = keys[e];
+        sort->bucket_values[pos] = values[e];
+    }
+}
+
+static void bucket_sort(void* arg, int tid, int num_threads) {
+    ChunkSort *sort = arg;
+    size_t lo = (size_t)tid * sort->bucket_width;
+    size_t hi = lo + sort->bucket_width;
+    if (lo > (size_t)sort->num_nodes) lo = sort->num_nodes;
+    if (hi > (size_t)sort->num_nodes) hi = sort->num_nodes;
+    size_t *offsets = sort->offsets;
+    size_t first = sort->bucket_starts[tid], last = sort->bucket_starts[tid + 1];
+
+    // Local exclusive prefix sum over the key range, based at the bucket start
+    for (size_t k = lo; k < hi; k++) {
+        offsets[k] = 0;
+    }
+    for (size_t e = first; e < last; e++) {
+        offsets[sort->bucket_keys[e]]++;
+    }
+    size_t running = first;
+    for (size_t k = lo; k < hi; k++) {
+        size_t count = offsets[k];
+        offsets[k] = running;
+        running += count;
+    }
+    for (size_t e = first; e < last; e++) {
+        sort->neighbors[offsets[sort->bucket_keys[e]]++] = sort->bucket_values[e];
+    }
+    for (size_t k = hi; k > lo + 1; k--) {
+        offsets[k - 1] = offsets[k - 2];
+    }
+    if (lo < hi) {
+        offsets[lo] = first;
+    }
+}
 
-    // Validate the graph identifier (looks okay)
-    if (!isalpha(graph_id[0])) {
-        fprintf(stderr, "Error: Graph identifier '%s' in '%s' must start with a letter\n", graph_id, filename);
-        fclose(file);
-        exit(1);
+static void build_compressed_chunks(ChunkSort* sort, size_t num_edges, int by_target,
+                                    size_t** offsets_out, int** neighbors_out) {
+    int num_threads = sort->num_threads;
+    sort->by_target = by_target;
+    sort->offsets = malloc(((size_t)sort->num_nodes + 1) * sizeof(size_t));
+    sort->neighbors = malloc((num_edges ? num_edges : 1) * sizeof(int));
+    if (!sort->offsets || !sort->neighbors) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
     }
-    for (int i = 1; graph_id[i] != '\0'; i++) {
-        if (!isalnum(graph_id[i]) && graph_id[i] != '_') { // Allow underscore? Common practice. Adjust if needed.
-            fprintf(stderr, "Error: Graph identifier '%s' in '%s' must contain only letters, numbers, or underscores\n", graph_id, filename);
-            fclose(file);
-            exit(1);
+
+    memset(sort->cursors, 0, (size_t)num_threads * num_threads * sizeof(size_t));
+    run_parallel(num_threads, chunk_histogram, sort);
+
+    // Turn the per-thread bucket counts into scatter cursors: bucket-major,
+    // and within a bucket in chunk order so the sort stays stable
+    size_t running = 0;
+    for (int b = 0; b < num_threads; b++) {
+        sort->bucket_starts[b] = running;
+        for (int t = 0; t < num_threads; t++) {
+            size_t count = sort->cursors[(size_t)t * num_threads + b];
+            sort->cursors[(size_t)t * num_threads + b] = running;
+            running += count;
         }
     }
+    sort->bucket_starts[num_threads] = running;
+
+    run_parallel(num_threads, chunk_scatter, sort);
+    run_parallel(num_threads, bucket_sort, sort);
+    sort->offsets[sort->num_nodes] = num_edges;
+
+    *offsets_out = sort->offsets;
+    *neighbors_out = sort->neighbors;
+    sort->offsets = NULL;
+    sort->neighbors = NULL;
+}
+
+// Release the buffers of a sort, also as a Guard release
+static void free_chunk_sort(void* data) {
+    ChunkSort *sort = data;
+    free(sort->cursors);
+    free(sort->bucket_starts);
+    free(sort->bucket_keys);
+    free(sort->bucket_values);
+    free(sort->offsets);
+    free(sort->neighbors);
+}
+
+// Build the CSR and CSC stores from edges that were collected in separate
+// chunks (already mapped to global node indices), using one thread per
+// chunk. Within each row, edges keep chunk order, so the result is the same
+// as adding all edges in order and calling finalize_graph().
+void finalize_graph_chunks(Graph* graph, const EdgeChunk* chunks, int num_chunks) {
+    free_sparse_store(graph);
+
+    size_t num_edges = 0;
+    for (int t = 0; t < num_chunks; t++) {
+        num_edges += chunks[t].num_edges;
+    }
+    graph->num_edges = num_edges;
+
+    if (num_chunks == 1 || num_edges == 0) {
+        // Nothing to split: sort the first chunk directly
+        build_compressed(graph->num_nodes, num_edges, chunks[0].sources, chunks[0].targets,
+                         &graph->out_offsets, &graph->out_targets);
+        build_compressed(graph->num_nodes, num_edges, chunks[0].targets, chunks[0].sources,
+                         &graph->in_offsets, &graph->in_sources);
+        return;
+    }
 
+    ChunkSort sort = {
+        .chunks = chunks,
+        .num_threads = num_chunks,
+        .num_nodes = graph->num_nodes,
+        .bucket_width = (graph->num_nodes + num_chunks - 1) / num_chunks,
+    };
+    sort.cursors = malloc((size_t)num_chunks * num_chunks * sizeof(size_t));
+    sort.bucket_starts = malloc(((size_t)num_chunks + 1) * sizeof(size_t));
+    sort.bucket_keys = malloc((num_edges ? num_edges : 1) * sizeof(int));
+    sort.bucket_values = malloc((num_edges ? num_edges : 1) * sizeof(int));
+    Guard guard;
+    guard_push(&guard, free_chunk_sort, &sort);
+    if (!sort.cursors || !sort.bucket_starts || !sort.bucket_keys || !sort.bucket_values) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
+    }
 
-    // Parse edges
-    while (fgets(line, sizeof(line), file)) {
-        // Trim leading/trailing whitespace (optional but good practice)
-        char* trimmed_line = line;
-        while (isspace((unsigned char)*trimmed_line)) trimmed_line++;
-        char* end = trimmed_line + strlen(trimmed_line) - 1;
-        while(end > trimmed_line && isspace((unsigned char)*end)) end--;
-        *(end + 1) = 0;
+    build_compressed_chunks(&sort, num_edges, 0, &graph->out_offsets, &graph->out_targets);
+    build_compressed_chunks(&sort, num_edges, 1, &graph->in_offsets, &graph->in_sources);
 
+    guard_pop(&guard);
+    free_chunk_sort(&sort);
+}
+
+// Heap copy of a block, NULL if out of memory
+static void* copy_block(const void* data, size_t size) {
+    void *copy = malloc(size ? size : 1);
+    if (copy) {
+        memcpy(copy, data, size);
+    }
+    return copy;
+}
 
-        // Check for the closing brace
-        if (strcmp(trimmed_line, "}") == 0) {
-            break;
+// Replace the arrays of a graph loaded from a snapshot by heap copies, so
+// that it can be modified; no-op for parsed graphs. The graph only changes
+// once all copies are made, so it still uses the mapping if one fails.
+void detach_graph(Graph* graph) {
+    if (!graph->mapping) {
+        return;
+    }
+    const size_t n = graph->num_nodes, m = graph->num_edges;
+    IdTable *ids = &graph->ids;
+    char *arena = copy_block(ids->arena, ids->arena_len);
+    size_t *id_offsets = copy_block(ids->offsets, (n + 1) * sizeof(size_t));
+    int *slots = copy_block(ids->slots, ids->num_slots * sizeof(int));
+    size_t *out_offsets = copy_block(graph->out_offsets, (n + 1) * sizeof(size_t));
+    int *out_targets = copy_block(graph->out_targets, m * sizeof(int));
+    size_t *in_offsets = copy_block(graph->in_offsets, (n + 1) * sizeof(size_t));
+    int *in_sources = NULL;
+    size_t *packed_index = NULL;
+    unsigned char *packed_sources = NULL;
+    if (graph->packed_sources) {
+        size_t length = packed_index_length(n);
+        packed_index = copy_block(graph->packed_index, length * sizeof(size_t));
+        packed_sources = copy_block(graph->packed_sources, graph->packed_index[length - 1] + PACKED_PADDING);
+    } else {
+        in_sources = copy_block(graph->in_sources, m * sizeof(int));
+    }
+    if (!arena || !id_offsets || !slots || !out_offsets || !out_targets || !in_offsets
+        || (graph->packed_sources ? !packed_index || !packed_sources : !in_sources)) {
+        void *copies[] = { arena, id_offsets, slots, out_offsets, out_targets, in_offsets,
+                           in_sources, packed_index, packed_sources };
+        for (size_t b = 0; b < sizeof(copies) / sizeof(copies[0]); b++) {
+            free(copies[b]);
         }
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
+    }
+
+    ids->arena = arena;
+    ids->arena_cap = ids->arena_len;
+    ids->offsets = id_offsets;
+    ids->ids_capacity = (int)n + 1;
+    ids->slots = slots;
+    graph->out_offsets = out_offsets;
+    graph->out_targets = out_targets;
+    graph->in_offsets = in_offsets;
+    graph->in_sources = in_sources;
+    graph->packed_index = packed_index;
+    graph->packed_sources = packed_sources;
+
+    munmap(graph->mapping, graph->mapping_size);
+    graph->mapping = NULL;
+    graph->mapping_size = 0;
+}
+
+typedef struct {
+    int source;
+    int target;
+    size_t index;       // position in the deleted chunk
+} EdgeRef;
+
+static void release_ids(void* ids) {
+    idtable_free(ids);
+}
 
-        // Skip empty or comment lines (optional)
-        if (strlen(trimmed_line) == 0 || trimmed_line[0] == '#') { // Example comment handling
-            continue;
+void permute_graph(Graph* graph, const int* order) {
+    detach_graph(graph);
+    const int n = graph->num_nodes;
+    const size_t m = graph->num_edges;
+    int *new_index = malloc((n ? n : 1) * sizeof(int));
+    int *sources = malloc((m ? m : 1) * sizeof(int));
+    int *targets = malloc((m ? m : 1) * sizeof(int));
+    Guard guards[3];
+    guard_memory(guards, (void *[]){ new_index, sources, targets }, 3);
+    if (!new_index || !sources || !targets) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
+    }
+    for (int i = 0; i < n; i++) {
+        new_index[order[i]] = i;
+    }
+
+    // The out-edges in the new node order, each row in its old order
+    size_t k = 0;
+    for (int i = 0; i < n; i++) {
+        int old = order[i];
+        for (size_t e = graph->out_offsets[old]; e < graph->out_offsets[old + 1]; e++) {
+            sources[k] = i;
+            targets[k++] = new_index[graph->out_targets[e]];
         }
+    }
+    EdgeChunk chunk = { sources, targets, m };
+    finalize_graph_chunks(graph, &chunk, 1);
+
+    IdTable ids;
+    idtable_init(&ids);
+    Guard ids_guard;
+    guard_push(&ids_guard, release_ids, &ids);
+    for (int i = 0; i < n; i++) {
+        idtable_intern(&ids, node_id(graph, order[i]), idtable_length(&graph->ids, order[i]));
+    }
+    guard_pop(&ids_guard);
+    idtable_free(&graph->ids);
+    graph->ids = ids;
+
+    guard_pop_memory(guards, 3);
+    free(new_index);
+    free(sources);
+    free(targets);
+}
+
+static inline int byte_length(uint32_t value) {
+    return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
 
+// Value k of node j's packed list, see Graph
+static inline uint32_t packed_value(const int* list, size_t k, int j) {
+    if (k == 0) {
+        uint32_t distance = (uint32_t)list[0] - (uint32_t)j;
+        return (distance << 1) ^ (0u - (distance >> 31));
+    }
+    return (uint32_t)list[k] - (uint32_t)list[k - 1];
+}
 
-        char source_id[MAX_ID_LENGTH], target_id[MAX_ID_LENGTH];
-        // Use width specifiers for safety. Be flexible with spaces around -> and ;
-        if (sscanf(trimmed_line, "%255s -> %255s ;", source_id, target_id) != 2 &&
-            sscanf(trimmed_line, "%255s->%255s;", source_id, target_id) != 2 ) { // Add variations if needed
-            fprintf(stderr, "Error: Invalid edge format in file '%s': %s\n", filename, line); // Show original line
-            fclose(file);
-            exit(1);
+typedef struct {
+    Graph *graph;
+    int pass;           // 0: sort the lists and size the index strides, 1: encode
+} PackTask;
+
+static void pack_strides(void* arg, int tid, int num_threads) {
+    PackTask *task = arg;
+    Graph *graph = task->graph;
+    const size_t num_strides = packed_index_length(graph->num_nodes) - 1;
+    size_t first = range_start(num_strides, tid, num_threads);
+    size_t last = range_start(num_strides, tid + 1, num_threads);
+    for (size_t c = first; c < last; c++) {
+        int lo = (int)(c * PACKED_INDEX_STRIDE);
+        int hi = lo + PACKED_INDEX_STRIDE < graph->num_nodes ? lo + PACKED_INDEX_STRIDE : graph->num_nodes;
+        size_t size = 0;
+        unsigned char *p = task->pass ? graph->packed_sources + graph->packed_index[c] : NULL;
+        for (int j = lo; j < hi; j++) {
+            int *list = graph->in_sources + graph->in_offsets[j];
+            size_t count = graph->in_offsets[j + 1] - graph->in_offsets[j];
+            if (task->pass == 0) {
+                size_t k = 1;
+                while (k < count && list[k - 1] <= list[k]) k++;
+                if (k < count) qsort(list, count, sizeof(int), compare_ints);
+                size += (count + 3) / 4;
+                for (k = 0; k < count; k++) {
+                    size += byte_length(packed_value(list, k, j));
+                }
+                continue;
+            }
+            for (size_t k = 0; k < count; k += 4) {
+                unsigned char *control = p++;
+                *control = 0;
+                for (size_t i = 0; i < 4 && k + i < count; i++) {
+                    uint32_t value = packed_value(list, k + i, j);
+                    int length = byte_length(value);
+                    *control |= (unsigned char)((length - 1) << (2 * i));
+                    for (int b = 0; b < length; b++) {
+                        *p++ = (unsigned char)(value >> (8 * b));
+                    }
+                }
+            }
         }
+        if (task->pass == 0) {
+            graph->packed_index[c + 1] = size;
+        }
+    }
+}
 
-        // Validate source and target identifiers (looks okay, maybe allow '_')
-         if (!isalpha(source_id[0])) { /* ... error ... */ exit(1); }
-         for (int i = 1; source_id[i] != '\0'; i++) {
-            if (!isalnum(source_id[i]) && source_id[i] != '_') { /* ... error ... */ exit(1); }
-         }
-         if (!isalpha(target_id[0])) { /* ... error ... */ exit(1); }
-         for (int i = 1; target_id[i] != '\0'; i++) {
-            if (!isalnum(target_id[i]) && target_id[i] != '_') { /* ... error ... */ exit(1); }
-         }
+void pack_graph(Graph* graph, int num_threads) {
+    if (graph->packed_sources) {
+        return;
+    }
+    detach_graph(graph);
+    const size_t length = packed_index_length(graph->num_nodes);
+    if (num_threads < 1) num_threads = 1;
+    if ((size_t)num_threads > length - 1) num_threads = length > 1 ? (int)(length - 1) : 1;
+    graph->packed_index = malloc(length * sizeof(size_t));
+    if (!graph->packed_index) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
+    }
+    PackTask task = { graph, 0 };
+    graph->packed_index[0] = 0;
+    run_parallel(num_threads, pack_strides, &task);
+    for (size_t c = 1; c < length; c++) {
+        graph->packed_index[c] += graph->packed_index[c - 1];
+    }
+    graph->packed_sources = calloc(graph->packed_index[length - 1] + PACKED_PADDING, 1);
+    if (!graph->packed_sources) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
+    }
+    task.pass = 1;
+    run_parallel(num_threads, pack_strides, &task);
+    free(graph->in_sources);
+    graph->in_sources = NULL;
+}
 
+const unsigned char* packed_list(const Graph* graph, int j) {
+    int first = j - j % PACKED_INDEX_STRIDE;
+    const unsigned char *p = graph->packed_sources + graph->packed_index[j / PACKED_INDEX_STRIDE];
+    for (int i = first; i < j; i++) {
+        p = skip_list(p, in_degree(graph, i));
+    }
+    return p;
+}
 
-        // Add the edge to the graph
-        add_edge(graph, source_id, target_id);
+void unpack_graph(Graph* graph) {
+    if (!graph->packed_sources) {
+        return;
     }
+    detach_graph(graph);
+    int *sources = malloc((graph->num_edges ? graph->num_edges : 1) * sizeof(int));
+    if (!sources) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for sparse graph");
+    }
+    const unsigned char *p = graph->packed_sources;
+    for (int j = 0; j < graph->num_nodes; j++) {
+        p = read_list(p, j, in_degree(graph, j), sources + graph->in_offsets[j]);
+    }
+    graph->in_sources = sources;
+    free(graph->packed_index);
+    free(graph->packed_sources);
+    graph->packed_index = NULL;
+    graph->packed_sources = NULL;
+}
 
-    // Check if the file ended without a closing brace (optional)
+static int compare_edge_refs(const void *a, const void *b) {
+    const EdgeRef *edgeA = a, *edgeB = b;
+    if (edgeA->source != edgeB->source) return edgeA->source < edgeB->source ? -1 : 1;
+    if (edgeA->target != edgeB->target) return edgeA->target < edgeB->target ? -1 : 1;
+    return (edgeA->index > edgeB->index) - (edgeA->index < edgeB->index);
+}
 
+// Flag one occurrence of every edge of deleted in removed (one flag per
+// edge of the sparse store, zeroed by the caller). Returns the position in
+// deleted of an edge that does not exist, or -1 if all were found. Only
+// reads the graph, so a diff can be checked before anything changes.
+long find_deleted_edges(const Graph* graph, const EdgeChunk* deleted, unsigned char* removed) {
+    EdgeRef *refs = malloc((deleted->num_edges ? deleted->num_edges : 1) * sizeof(EdgeRef));
+    if (!refs) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for edges");
+    }
+    for (size_t e = 0; e < deleted->num_edges; e++) {
+        refs[e] = (EdgeRef){ deleted->sources[e], deleted->targets[e], e };
+    }
+    qsort(refs, deleted->num_edges, sizeof(EdgeRef), compare_edge_refs);
+
+    // Mark the first remaining occurrence of every deleted edge in its row
+    for (size_t d = 0; d < deleted->num_edges; d++) {
+        int source = refs[d].source;
+        size_t e = graph->out_offsets[source];
+        size_t end = graph->out_offsets[source + 1];
+        while (e < end && (removed[e] || graph->out_targets[e] != refs[d].target)) e++;
+        if (e == end) {
+            long missing = (long)refs[d].index;
+            free(refs);
+            return missing;
+        }
+        removed[e] = 1;
+    }
+    free(refs);
+    return -1;
+}
 
-    fclose(file);
+// Rebuild the sparse store without the num_removed edges flagged in removed
+// (see find_deleted_edges()) and with those of inserted appended.
+// built_nodes is the node count the current store was built for; nodes
+// interned since then get their rows. Within each row the remaining edges
+// keep their order and the inserted ones follow.
+void update_graph_edges(Graph* graph, int built_nodes, const EdgeChunk* inserted,
+                        const unsigned char* removed, size_t num_removed) {
+    detach_graph(graph);
+    const size_t m = graph->num_edges;
+    size_t num_edges = m - num_removed + inserted->num_edges;
+    graph->edge_sources = malloc((num_edges ? num_edges : 1) * sizeof(int));
+    graph->edge_targets = malloc((num_edges ? num_edges : 1) * sizeof(int));
+    if (!graph->edge_sources || !graph->edge_targets) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for edges");
+    }
+    size_t count = 0;
+    for (int i = 0; i < built_nodes; i++) {
+        for (size_t e = graph->out_offsets[i]; e < graph->out_offsets[i + 1]; e++) {
+            if (!removed[e]) {
+                graph->edge_sources[count] = i;
+                graph->edge_targets[count++] = graph->out_targets[e];
+            }
+        }
+    }
+    memcpy(graph->edge_sources + count, inserted->sources, inserted->num_edges * sizeof(int));
+    memcpy(graph->edge_targets + count, inserted->targets, inserted->num_edges * sizeof(int));
+    graph->num_edges = num_edges;
+    graph->edges_capacity = num_edges;
+    finalize_graph(graph);
 }
 
 // Function to print graph statistics
-void print_graph_stats(Graph* graph) {
-    printf("Graph Statistics:\n");
-    printf("- Number of nodes: %d\n", graph->num_nodes);
-    printf("- Number of edges: %d\n", graph->num_edges);
+void print_graph_stats(FILE* file, Graph* graph) {
+    fprintf(file, "%s:\n", graph->name);
+    fprintf(file, "- num nodes: %d\n", graph->num_nodes);
+    fprintf(file, "- num edges: %zu\n", graph->num_edges);
 
     if (graph->num_nodes == 0) {
-        printf("- In-degree range: N/A\n");
-        printf("- Out-degree range: N/A\n");
+        fprintf(file, "- indegree: 0-0\n");
+        fprintf(file, "- outdegree: 0-0\n");
     } else {
         // Initialize with the first node's degrees
-        int min_in_degree = graph->nodes[0].in_degree;
-        int max_in_degree = graph->nodes[0].in_degree;
-        int min_out_degree = graph->nodes[0].out_degree;
-        int max_out_degree = graph->nodes[0].out_degree;
+        int min_in_degree = in_degree(graph, 0);
+        int max_in_degree = in_degree(graph, 0);
+        int min_out_degree = out_degree(graph, 0);
+        int max_out_degree = out_degree(graph, 0);
 
         // Iterate from the second node onwards
         for (int i = 1; i < graph->num_nodes; i++) {
-            if (graph->nodes[i].in_degree < min_in_degree) {
-                min_in_degree = graph->nodes[i].in_degree;
+            int in = in_degree(graph, i);
+            int out = out_degree(graph, i);
+            if (in < min_in_degree) {
+                min_in_degree = in;
             }
-            if (graph->nodes[i].in_degree > max_in_degree) {
-                max_in_degree = graph->nodes[i].in_degree;
+            if (in > max_in_degree) {
+                max_in_degree = in;
             }
-            if (graph->nodes[i].out_degree < min_out_degree) {
-                min_out_degree = graph->nodes[i].out_degree;
+            if (out < min_out_degree) {
+                min_out_degree = out;
             }
-            if (graph->nodes[i].out_degree > max_out_degree) {
-                max_out_degree = graph->nodes[i].out_degree;
+            if (out > max_out_degree) {
+                max_out_degree = out;
             }
         }
-        printf("- In-degree range: %d-%d\n", min_in_degree, max_in_degree);
-        printf("- Out-degree range: %d-%d\n", min_out_degree, max_out_degree);
+        fprintf(file, "- indegree: %d-%d\n", min_in_degree, max_in_degree);
+        fprintf(file, "- outdegree: %d-%d\n", min_out_degree, max_out_degree);
     }
 }
 
 
-int compare_node_ranks(const void *a, const void *b) {
-    NodeRank *rankA = (NodeRank *)a;
-    NodeRank *rankB = (NodeRank *)b;
-    return strcmp(rankA->id, rankB->id);
-}
+// Below this many nodes, sort_keys() uses insertion sort
+#define SORT_CUTOFF 32
 
-// --- Random Surfer Simulation ---
-void simulate_random_surfer(Graph* graph, int steps, double teleport_prob) {
-    if (graph->num_nodes == 0) {
-        printf("Random Surfer Results (N=%d, p=%.2f):\n(No nodes in graph)\n", steps, teleport_prob);
-        return;
-    }
-     if (steps <= 0) {
-        printf("Random Surfer Results (N=%d, p=%.2f):\n(No simulation steps performed)\n", steps, teleport_prob);
-        // Optionally print zero ranks for all nodes if N=0
-        return;
-    }
+// A node with 8 bytes of its ID, packed big-endian (zero-padded), so
+// comparing keys compares those bytes in strcmp order
+typedef struct {
+    uint64_t key;
+    int node;
+} IdKey;
 
+static inline uint64_t id_key(const IdTable* ids, int node, size_t depth) {
+    const unsigned char *id = (const unsigned char *)idtable_get(ids, node) + depth;
+    uint64_t key = 0;
+    int k = 0;
+    for (; k < 8 && id[k]; k++) {
+        key = key << 8 | id[k];
+    }
+    return k ? key << (8 * (8 - k)) : 0;
+}
 
-    int *visit_counts = calloc(graph->num_nodes, sizeof(int));
-    if (!visit_counts) {
-        perror("Failed to allocate memory for visit counts");
-        exit(1);
-    }
-
-    // Start at a random node
-    int current_node_index = randu(graph->num_nodes);
-    // Note: The description often implies the *first* visit doesn't count towards rank,
-    // or that N steps means N transitions. We'll count the node landed on *after* each step.
-
-    for (int i = 0; i < steps; ++i) {
-        // Decide whether to teleport or follow a link
-        // randu(100) gives a number from 0 to 99.
-        // teleport if randu(100) < p_percent
-        int p_percent_int = (int)(teleport_prob * 100.0); // Integer percentage
-        int should_teleport = (randu(100) < p_percent_int);
-
-        int out_degree = graph->nodes[current_node_index].out_degree;
-
-        if (should_teleport || out_degree == 0) {
-            // Teleport (or jump from dangling node)
-            current_node_index = randu(graph->num_nodes);
-        } else {
-            // Follow an outgoing link
-            // Find neighbors
-            int *neighbors = malloc(out_degree * sizeof(int));
-            if (!neighbors) {
-                 perror("Failed to allocate memory for neighbors");
-                 free(visit_counts);
-                 exit(1);
-             }
-            int neighbor_count = 0;
-            for (int j = 0; j < graph->num_nodes; ++j) {
-                if (graph->adjacency_matrix[current_node_index][j]) {
-                    neighbors[neighbor_count++] = j;
-                }
+// Sort keys[0, count) whose IDs agree on the first depth bytes and whose
+// keys hold bytes depth .. depth + 7: radix sort by key (insertion sort
+// for few keys), then the same for every run of equal keys that does not
+// end its IDs, with the next 8 bytes. Each ID is read sequentially 8 bytes
+// at a time instead of once per comparison. scratch has room for count keys.
+static void sort_keys(const IdTable* ids, IdKey* keys, IdKey* scratch, size_t count, size_t depth) {
+    if (count <= SORT_CUTOFF) {
+        for (size_t i = 1; i < count; i++) {
+            IdKey item = keys[i];
+            size_t j = i;
+            while (j > 0 && keys[j - 1].key > item.key) {
+                keys[j] = keys[j - 1];
+                j--;
             }
-
-            // Choose a random neighbor
-            if (neighbor_count > 0) { // Should always be true if out_degree > 0
-                 current_node_index = neighbors[randu(neighbor_count)];
-            } else {
-                // Should not happen if out_degree > 0, but as fallback: teleport
-                 fprintf(stderr, "Warning: Node %s has out_degree %d but no neighbors found in matrix?\n",
-                        graph->nodes[current_node_index].id, out_degree);
-                 current_node_index = randu(graph->num_nodes);
+            keys[j] = item;
+        }
+    } else {
+        // LSD radix sort, one byte per pass; passes where all keys share
+        // the byte are skipped
+        IdKey *from = keys, *to = scratch;
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t counts[256] = {0};
+            for (size_t i = 0; i < count; i++) {
+                counts[from[i].key >> shift & 0xff]++;
+            }
+            if (counts[from[0].key >> shift & 0xff] == count) {
+                continue;
+            }
+            size_t pos = 0;
+            for (int b = 0; b < 256; b++) {
+                size_t c = counts[b];
+                counts[b] = pos;
+                pos += c;
             }
-            free(neighbors);
+            for (size_t i = 0; i < count; i++) {
+                to[counts[from[i].key >> shift & 0xff]++] = from[i];
+            }
+            IdKey *tmp = from; from = to; to = tmp;
+        }
+        if (from != keys) {
+            memcpy(keys, from, count * sizeof(IdKey));
         }
-         // Increment visit count for the node *landed on*
-        visit_counts[current_node_index]++;
     }
 
-    // Prepare results for sorting and printing
-    NodeRank *results = malloc(graph->num_nodes * sizeof(NodeRank));
-     if (!results) {
-        perror("Failed to allocate memory for results");
-        free(visit_counts);
-        exit(1);
+    for (size_t i = 0; i < count; ) {
+        size_t j = i + 1;
+        while (j < count && keys[j].key == keys[i].key) j++;
+        // A key whose last byte is not zero may continue past depth + 8
+        if (j - i > 1 && (keys[i].key & 0xff)) {
+            for (size_t k = i; k < j; k++) {
+                keys[k].key = id_key(ids, keys[k].node, depth + 8);
+            }
+            sort_keys(ids, keys + i, scratch, j - i, depth + 8);
+        }
+        i = j;
     }
+}
 
-    printf("\nRandom Surfer Results (N=%d, p=%.2f):\n", steps, teleport_prob);
-    for (int i = 0; i < graph->num_nodes; ++i) {
-        strncpy(results[i].id, graph->nodes[i].id, MAX_ID_LENGTH - 1);
-        results[i].id[MAX_ID_LENGTH - 1] = '\0';
-        results[i].rank = (double)visit_counts[i] / steps;
+// Fill order with the node indices sorted by ID (strcmp order)
+static void sort_nodes_by_id(const IdTable* ids, int* order, int count) {
+    IdKey *keys = malloc(2 * (size_t)(count > 0 ? count : 1) * sizeof(IdKey));
+    if (!keys) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for results");
+    }
+    for (int i = 0; i < count; i++) {
+        keys[i].key = id_key(ids, i, 0);
+        keys[i].node = i;
     }
+    sort_keys(ids, keys, keys + count, count, 0);
+    for (int i = 0; i < count; i++) {
+        order[i] = keys[i].node;
+    }
+    free(keys);
+}
 
-    // Sort results alphabetically by node ID
-    qsort(results, graph->num_nodes, sizeof(NodeRank), compare_node_ranks);
+// Print one "<id>\t<rank>" line per node, sorted alphabetically by node ID
+void print_ranks(Graph* graph, const double* ranks) {
+    print_rank_block(stdout, graph, ranks, 1);
+}
+
+// Write "<id>\t<rank>..." lines for the given nodes in order, each rank
+// with the given decimals (see output_double())
+static void write_rank_lines(FILE* file, Graph* graph, const double* ranks, int num_vectors,
+                             const int* order, size_t count, int decimals) {
+    OutputBuffer out;
+    output_init(&out, file);
+    for (size_t i = 0; i < count; ++i) {
+        // The nodes are visited in ID order, i.e. at random: fetch the
+        // offsets and ranks, then the IDs, of the next lines early
+        if (i + 16 < count) {
+            int ahead = order[i + 16];
+            __builtin_prefetch(graph->ids.offsets + ahead);
+            __builtin_prefetch(ranks + (size_t)ahead * num_vectors);
+        }
+        if (i + 8 < count) {
+            __builtin_prefetch(node_id(graph, order[i + 8]));
+        }
+        int node = order[i];
+        output_bytes(&out, node_id(graph, node), idtable_length(&graph->ids, node));
+        const double *row = ranks + (size_t)node * num_vectors;
+        for (int k = 0; k < num_vectors; ++k) {
+            output_char(&out, '\t');
+            output_double(&out, row[k], decimals);
+        }
+        output_char(&out, '\n');
+    }
+    output_free(&out);
+}
 
-    // Print sorted results
+// Write the rank lines of all nodes sorted by node ID
+static void write_rank_block(FILE* file, Graph* graph, const double* ranks, int num_vectors, int decimals) {
+    int *order = malloc((graph->num_nodes ? graph->num_nodes : 1) * sizeof(int));
+    if (!order) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for results");
+    }
+    Guard guard;
+    guard_push(&guard, free, order);
     for (int i = 0; i < graph->num_nodes; ++i) {
-        printf("- %s: %.6f\n", results[i].id, results[i].rank);
+        order[i] = i;
     }
+    sort_nodes_by_id(&graph->ids, order, graph->num_nodes);
+    write_rank_lines(file, graph, ranks, num_vectors, order, graph->num_nodes, decimals);
+    guard_pop(&guard);
+    free(order);
+}
 
-    free(visit_counts);
-    free(results);
+void print_rank_block(FILE* file, Graph* graph, const double* ranks, int num_vectors) {
+    write_rank_block(file, graph, ranks, num_vectors, 6);
 }
 
+// Whether node a is listed before node b by print_top_ranks(): higher
+// rank in the first vector first, equal ranks by ID
+static inline int ranks_before(const Graph* graph, const double* ranks, int num_vectors, int a, int b) {
+    double rank_a = ranks[(size_t)a * num_vectors], rank_b = ranks[(size_t)b * num_vectors];
+    if (rank_a != rank_b) {
+        return rank_a > rank_b;
+    }
+    return strcmp(node_id(graph, a), node_id(graph, b)) < 0;
+}
 
-// --- Markov Chain Simulation ---
-void simulate_markov_chain(Graph* graph, int steps, double teleport_prob) {
-     if (graph->num_nodes == 0) {
-        printf("Markov Chain Results (N=%d, p=%.2f):\n(No nodes in graph)\n", steps, teleport_prob);
-        return;
+// Restore the heap below position i; the root is the node listed last
+static void sift_down(const Graph* graph, const double* ranks, int num_vectors, int* heap, size_t size, size_t i) {
+    for (;;) {
+        size_t last = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && ranks_before(graph, ranks, num_vectors, heap[last], heap[left])) last = left;
+        if (right < size && ranks_before(graph, ranks, num_vectors, heap[last], heap[right])) last = right;
+        if (last == i) return;
+        int tmp = heap[i]; heap[i] = heap[last]; heap[last] = tmp;
+        i = last;
     }
+}
 
-    // Allocate probability vectors
-    double *current_prob = malloc(graph->num_nodes * sizeof(double));
-    double *next_prob = malloc(graph->num_nodes * sizeof(double));
-    if (!current_prob || !next_prob) {
-         perror("Failed to allocate memory for probability vectors");
-         free(current_prob); // free any that were allocated
-         free(next_prob);
-         exit(1);
+void print_top_ranks(FILE* file, Graph* graph, const double* ranks, int num_vectors, size_t top) {
+    if (top > (size_t)graph->num_nodes) {
+        top = graph->num_nodes;
+    }
+    int *heap = malloc((top ? top : 1) * sizeof(int));
+    if (!heap) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for results");
     }
 
-    // Initialize with uniform probability
-    double initial_prob = 1.0 / graph->num_nodes;
-    for (int i = 0; i < graph->num_nodes; ++i) {
-        current_prob[i] = initial_prob;
-    }
-
-    // --- Run N iterations ---
-    for (int k = 0; k < steps; ++k) {
-        // Reset next_prob for this iteration
-        memset(next_prob, 0, graph->num_nodes * sizeof(double));
-
-        double dangle_sum = 0.0; // Sum of probabilities of being at a dangling node
-
-        // Calculate contribution from links and identify dangling probability
-        for (int i = 0; i < graph->num_nodes; ++i) {
-            int out_degree = graph->nodes[i].out_degree;
-            if (out_degree == 0) {
-                dangle_sum += current_prob[i];
-            } else {
-                // Distribute (1-p) * prob[i] among neighbors
-                double base_contrib = (1.0 - teleport_prob) * current_prob[i];
-                for (int j = 0; j < graph->num_nodes; ++j) {
-                    if (graph->adjacency_matrix[i][j]) {
-                        // Add share of probability from node i
-                        next_prob[j] += base_contrib / out_degree;
-                    }
-                }
+    // Keep the best top nodes seen so far in a heap whose root is the
+    // worst of them, so each further node costs one comparison unless
+    // it displaces the root
+    size_t size = 0;
+    for (int i = 0; i < graph->num_nodes && top > 0; ++i) {
+        if (size < top) {
+            size_t c = size++;
+            heap[c] = i;
+            while (c > 0 && ranks_before(graph, ranks, num_vectors, heap[(c - 1) / 2], heap[c])) {
+                int tmp = heap[c]; heap[c] = heap[(c - 1) / 2]; heap[(c - 1) / 2] = tmp;
+                c = (c - 1) / 2;
             }
+        } else if (ranks_before(graph, ranks, num_vectors, i, heap[0])) {
+            heap[0] = i;
+            sift_down(graph, ranks, num_vectors, heap, size, 0);
         }
-
-        // Distribute dangling probability and teleport probability uniformly
-        double uniform_contrib = (teleport_prob + dangle_sum) / graph->num_nodes;
-        for (int j = 0; j < graph->num_nodes; ++j) {
-             next_prob[j] += uniform_contrib;
-        }
-
-        // Optional: Check for convergence (sum should be close to 1)
-        // double sum_check = 0;
-        // for(int j=0; j<graph->num_nodes; ++j) sum_check += next_prob[j];
-        // if (fabs(sum_check - 1.0) > 1e-5) { // Tolerance
-        //     fprintf(stderr, "Warning: Probability sum after step %d is %f, expected 1.0\n", k + 1, sum_check);
-        // }
-
-        // Update current_prob for the next iteration
-        memcpy(current_prob, next_prob, graph->num_nodes * sizeof(double));
-    } // End of iterations loop
-
-    // Prepare results for sorting and printing
-    NodeRank *results = malloc(graph->num_nodes * sizeof(NodeRank));
-     if (!results) {
-        perror("Failed to allocate memory for results");
-        free(current_prob);
-        free(next_prob);
-        exit(1);
     }
 
-    printf("\nMarkov Chain Results (N=%d, p=%.2f):\n", steps, teleport_prob);
-    for (int i = 0; i < graph->num_nodes; ++i) {
-        strncpy(results[i].id, graph.nodes[i].id, MAX_ID_LENGTH - 1);
-        results[i].id[MAX_ID_LENGTH - 1] = '\0';
-        results[i].rank = current_prob[i]; // Final probability is the rank
+    // Heap sort: move the worst remaining node to the back each time
+    for (size_t end = size; end > 1; --end) {
+        int tmp = heap[0]; heap[0] = heap[end - 1]; heap[end - 1] = tmp;
+        sift_down(graph, ranks, num_vectors, heap, end - 1, 0);
     }
 
-    // Sort results alphabetically by node ID
-    qsort(results, graph->num_nodes, sizeof(NodeRank), compare_node_ranks);
+    Guard guard;
+    guard_push(&guard, free, heap);
+    write_rank_lines(file, graph, ranks, num_vectors, heap, size, 6);
+    guard_pop(&guard);
+    free(heap);
+}
 
-    // Print sorted results
-    for (int i = 0; i < graph->num_nodes; ++i) {
-        printf("- %s: %.6f\n", results[i].id, results[i].rank);
+// Write the ranks in the format of print_rank_block(), but with every
+// digit needed to read them back exactly (see read_ranks())
+void save_rank_block(Graph* graph, const double* ranks, int num_vectors, const char* filename) {
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not open rank output file");
+    }
+    Guard guard;
+    guard_push(&guard, release_file, file);
+    write_rank_block(file, graph, ranks, num_vectors, -1);
+    guard_pop(&guard);
+    if (fclose(file) != 0) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not write rank output file");
     }
-
-    // Cleanup
-    free(current_prob);
-    free(next_prob);
-    free(results);
 }
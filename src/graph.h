@@ -1,199 +1,160 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-
+#ifndef _INC_GRAPH_H
+#define _INC_GRAPH_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "idtable.h"
 
-#define MAX_NODES 1000
 #define MAX_ID_LENGTH 256
 
 typedef struct {
-    char id[MAX_ID_LENGTH];
-    int in_degree;
-    int out_degree;
-} Node;
-
-typedef struct {
-    Node nodes[MAX_NODES];
-    int adjacency_matrix[MAX_NODES][MAX_NODES];
+    char name[MAX_ID_LENGTH];
+    IdTable ids;
     int num_nodes;
-    int num_edges;
+    size_t num_edges;
+
+    // Edges collected while parsing; released by finalize_graph()
+    int *edge_sources;
+    int *edge_targets;
+    size_t edges_capacity;
+
+    // Compressed sparse row: the successors of node i are
+    // out_targets[out_offsets[i] .. out_offsets[i + 1])
+    size_t *out_offsets;
+    int *out_targets;
+
+    // Compressed sparse column: the predecessors of node j are
+    // in_sources[in_offsets[j] .. in_offsets[j + 1])
+    size_t *in_offsets;
+    int *in_sources;
+
+    // Optional compressed form of the CSC, built by pack_graph(). The
+    // sorted predecessors of every node are delta-coded: the first as the
+    // zigzag-coded distance to the node, every other as the gap to the one
+    // before. The values are stored as group varints (see read_group()), a
+    // node's list in groups of four, the lists back to back in node order.
+    // packed_index[k] is the position of node k * PACKED_INDEX_STRIDE's
+    // list; its last entry is the end of the data. in_sources is NULL while
+    // the graph is packed; in_offsets still gives the in-degrees.
+    size_t *packed_index;
+    unsigned char *packed_sources;
+
+    // When loaded from a snapshot, the arrays above and the ID table point
+    // into this read-only mapping instead of owning heap memory
+    void *mapping;
+    size_t mapping_size;
 } Graph;
 
-// Function to initialize a graph
-void init_graph(Graph* graph) {
-    graph->num_nodes = 0;
-    graph->num_edges = 0;
-    memset(graph->adjacency_matrix, 0, sizeof(graph->adjacency_matrix));
-}
+// A run of edges given as parallel source/target index arrays
+typedef struct {
+    const int *sources;
+    const int *targets;
+    size_t num_edges;
+} EdgeChunk;
 
-// Function to find a node index by ID
-int find_node_index(Graph* graph, const char* id) {
-    for (int i = 0; i < graph->num_nodes; i++) {
-        if (strcmp(graph->nodes[i].id, id) == 0) {
-            return i;
-        }
-    }
-    return -1;
+static inline const char* node_id(const Graph* graph, int i) {
+    return idtable_get(&graph->ids, i);
 }
 
-// Function to add a node to the graph
-int add_node(Graph* graph, const char* id) {
-    int index = find_node_index(graph, id);
-    if (index != -1) {
-        return index; // Node already exists
-    }
-    if (graph->num_nodes >= MAX_NODES) {
-        fprintf(stderr, "Error: Maximum number of nodes reached\n");
-        exit(1);
-    }
-    strncpy(graph->nodes[graph->num_nodes].id, id, MAX_ID_LENGTH - 1);
-    graph->nodes[graph->num_nodes].id[MAX_ID_LENGTH - 1] = '\0';
-    graph->nodes[graph->num_nodes].in_degree = 0;
-    graph->nodes[graph->num_nodes].out_degree = 0;
-    return graph->num_nodes++;
+static inline int out_degree(const Graph* graph, int i) {
+    return (int)(graph->out_offsets[i + 1] - graph->out_offsets[i]);
 }
 
-// Function to add an edge between two nodes
-void add_edge(Graph* graph, const char* source_id, const char* target_id) {
-    int source_index = add_node(graph, source_id);
-    int target_index = add_node(graph, target_id);
-
-    if (!graph->adjacency_matrix[source_index][target_index]) {
-        graph->adjacency_matrix[source_index][target_index] = 1;
-        graph->nodes[source_index].out_degree++;
-        graph->nodes[target_index].in_degree++;
-        graph->num_edges++;
-    }
+static inline int in_degree(const Graph* graph, int j) {
+    return (int)(graph->in_offsets[j + 1] - graph->in_offsets[j]);
 }
 
-// Function to parse a DOT file and build the graph
-void parse_dot_file(Graph* graph, const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open file %s\n", filename);
-        exit(1); // Or return an error code
-    }
+// Nodes per packed_index entry
+#define PACKED_INDEX_STRIDE 64
 
-    char line[1024];
-    // Validate the header line
-    if (!fgets(line, sizeof(line), file)) {
-        fprintf(stderr, "Error: File is empty or could not be read: %s\n", filename);
-        fclose(file);
-        exit(1); // Or return an error code
-    }
-
-    char graph_id[MAX_ID_LENGTH];
-    // Use width specifier for safety
-    if (sscanf(line, " digraph %255s {", graph_id) != 1) { // Check for leading whitespace too
-        // Try without space in case format is strict 'digraph G {'
-        if (sscanf(line, "digraph %255s {", graph_id) != 1) {
-             fprintf(stderr, "Error: File '%s' must start with 'digraph <identifier> {'\n", filename);
-             fclose(file);
-             exit(1); // Or return an error code
-        }
-    }
+// Zero bytes after the packed lists, so read_group() may overrun its group
+#define PACKED_PADDING 3
 
+static inline size_t packed_index_length(int num_nodes) {
+    return ((size_t)num_nodes + PACKED_INDEX_STRIDE - 1) / PACKED_INDEX_STRIDE + 1;
+}
 
-    // Validate the graph identifier (looks okay)
-    if (!isalpha(graph_id[0])) {
-        fprintf(stderr, "Error: Graph identifier '%s' in '%s' must start with a letter\n", graph_id, filename);
-        fclose(file);
-        exit(1);
+// Decode count (at most 4) values of a packed group: a control byte with
+// the byte length - 1 of value i in bits 2i and 2i + 1, then the values,
+// little-endian. Returns the position after the group.
+static inline const unsigned char* read_group(const unsigned char* p, int count, uint32_t* values) {
+    static const uint32_t masks[4] = { 0xff, 0xffff, 0xffffff, 0xffffffff };
+    unsigned control = *p++;
+    for (int i = 0; i < count; i++) {
+        uint32_t word = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        unsigned length = (control >> (2 * i)) & 3;
+        values[i] = word & masks[length];
+        p += length + 1;
     }
-    for (int i = 1; graph_id[i] != '\0'; i++) {
-        if (!isalnum(graph_id[i]) && graph_id[i] != '_') { // Allow underscore? Common practice. Adjust if needed.
-            fprintf(stderr, "Error: Graph identifier '%s' in '%s' must contain only letters, numbers, or underscores\n", graph_id, filename);
-            fclose(file);
-            exit(1);
-        }
-    }
-
-
-    // Parse edges
-    while (fgets(line, sizeof(line), file)) {
-        // Trim leading/trailing whitespace (optional but good practice)
-        char* trimmed_line = line;
-        while (isspace((unsigned char)*trimmed_line)) trimmed_line++;
-        char* end = trimmed_line + strlen(trimmed_line) - 1;
-        while(end > trimmed_line && isspace((unsigned char)*end)) end--;
-        *(end + 1) = 0;
-
-
-        // Check for the closing brace
-        if (strcmp(trimmed_line, "}") == 0) {
-            break;
-        }
-
-        // Skip empty or comment lines (optional)
-        if (strlen(trimmed_line) == 0 || trimmed_line[0] == '#') { // Example comment handling
-            continue;
-        }
+    return p;
+}
 
+// Signed distance (two's complement) from its zigzag code
+static inline uint32_t zigzag_decode(uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
 
-        char source_id[MAX_ID_LENGTH], target_id[MAX_ID_LENGTH];
-        // Use width specifiers for safety. Be flexible with spaces around -> and ;
-        if (sscanf(trimmed_line, "%255s -> %255s ;", source_id, target_id) != 2 &&
-            sscanf(trimmed_line, "%255s->%255s;", source_id, target_id) != 2 ) { // Add variations if needed
-            fprintf(stderr, "Error: Invalid edge format in file '%s': %s\n", filename, line); // Show original line
-            fclose(file);
-            exit(1);
+// Decode the packed list at p of node j, which has count predecessors,
+// into sources. Returns the start of the next node's list.
+static inline const unsigned char* read_list(const unsigned char* p, int j, size_t count, int* sources) {
+    uint32_t source = (uint32_t)j, values[4];
+    for (size_t k = 0; k < count; k += 4) {
+        int group = count - k < 4 ? (int)(count - k) : 4;
+        p = read_group(p, group, values);
+        if (k == 0) values[0] = zigzag_decode(values[0]);
+        for (int i = 0; i < group; i++) {
+            source += values[i];
+            sources[k + i] = (int)source;
         }
-
-        // Validate source and target identifiers (looks okay, maybe allow '_')
-         if (!isalpha(source_id[0])) { /* ... error ... */ exit(1); }
-         for (int i = 1; source_id[i] != '\0'; i++) {
-            if (!isalnum(source_id[i]) && source_id[i] != '_') { /* ... error ... */ exit(1); }
-         }
-         if (!isalpha(target_id[0])) { /* ... error ... */ exit(1); }
-         for (int i = 1; target_id[i] != '\0'; i++) {
-            if (!isalnum(target_id[i]) && target_id[i] != '_') { /* ... error ... */ exit(1); }
-         }
-
-
-        // Add the edge to the graph
-        add_edge(graph, source_id, target_id);
     }
-
-    // Check if the file ended without a closing brace (optional)
-
-
-    fclose(file);
+    return p;
 }
 
-// Function to print graph statistics
-void print_graph_stats(Graph* graph) {
-    printf("Graph Statistics:\n");
-    printf("- Number of nodes: %d\n", graph->num_nodes);
-    printf("- Number of edges: %d\n", graph->num_edges);
-
-    if (graph->num_nodes == 0) {
-        printf("- In-degree range: N/A\n");
-        printf("- Out-degree range: N/A\n");
-    } else {
-        // Initialize with the first node's degrees
-        int min_in_degree = graph->nodes[0].in_degree;
-        int max_in_degree = graph->nodes[0].in_degree;
-        int min_out_degree = graph->nodes[0].out_degree;
-        int max_out_degree = graph->nodes[0].out_degree;
-
-        // Iterate from the second node onwards
-        for (int i = 1; i < graph->num_nodes; i++) {
-            if (graph->nodes[i].in_degree < min_in_degree) {
-                min_in_degree = graph->nodes[i].in_degree;
-            }
-            if (graph->nodes[i].in_degree > max_in_degree) {
-                max_in_degree = graph->nodes[i].in_degree;
-            }
-            if (graph->nodes[i].out_degree < min_out_degree) {
-                min_out_degree = graph->nodes[i].out_degree;
-            }
-            if (graph->nodes[i].out_degree > max_out_degree) {
-                max_out_degree = graph->nodes[i].out_degree;
-            }
+// Skip a packed list with count predecessors
+static inline const unsigned char* skip_list(const unsigned char* p, size_t count) {
+    for (size_t k = 0; k < count; k += 4) {
+        unsigned control = *p++;
+        for (size_t i = 0; i < 4 && k + i < count; i++) {
+            p += ((control >> (2 * i)) & 3) + 1;
         }
-        printf("- In-degree range: %d-%d\n", min_in_degree, max_in_degree);
-        printf("- Out-degree range: %d-%d\n", min_out_degree, max_out_degree);
     }
-}
\ No newline at end of file
+    return p;
+}
+
+void init_graph(Graph* graph);
+void free_graph(Graph* graph);
+// free_graph() as a Guard release
+void release_graph(void* graph);
+int find_node_index(Graph* graph, const char* id);
+int intern_node(Graph* graph, const char* id, size_t len);
+int add_node(Graph* graph, const char* id);
+void add_edge(Graph* graph, const char* source_id, const char* target_id);
+void add_edge_index(Graph* graph, int source_index, int target_index);
+void finalize_graph(Graph* graph);
+void finalize_graph_chunks(Graph* graph, const EdgeChunk* chunks, int num_chunks);
+void detach_graph(Graph* graph);
+// Renumber the nodes so that node order[i] becomes node i; the IDs move
+// with their nodes. A snapshot-backed graph is detached first.
+void permute_graph(Graph* graph, const int* order);
+// Replace in_sources by the packed form, sorting every predecessor list,
+// on num_threads threads. A snapshot-backed graph is detached first.
+void pack_graph(Graph* graph, int num_threads);
+// Decode a packed graph back into in_sources; no-op if it is not packed
+void unpack_graph(Graph* graph);
+// Start of node j's list in packed_sources
+const unsigned char* packed_list(const Graph* graph, int j);
+long find_deleted_edges(const Graph* graph, const EdgeChunk* deleted, unsigned char* removed);
+void update_graph_edges(Graph* graph, int built_nodes, const EdgeChunk* inserted,
+                        const unsigned char* removed, size_t num_removed);
+void print_graph_stats(FILE* file, Graph* graph);
+void print_ranks(Graph* graph, const double* ranks);
+// Like print_ranks() for num_vectors vectors stored node-major (the ranks
+// of node i are ranks[i * num_vectors ...]); one tab-separated column each
+void print_rank_block(FILE* file, Graph* graph, const double* ranks, int num_vectors);
+void save_rank_block(Graph* graph, const double* ranks, int num_vectors, const char* filename);
+// Print the lines of the top nodes by rank in the first vector, best
+// first (equal ranks by ID), selected with a heap of top entries
+void print_top_ranks(FILE* file, Graph* graph, const double* ranks, int num_vectors, size_t top);
+
+#endif /* !_INC_GRAPH_H */
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "idtable.h"
+#include "error.h"
+
+
+// 64-bit FNV-1a
+static uint64_t hash_id(const char* id, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)id[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void idtable_init(IdTable* table) {
+    memset(table, 0, sizeof(*table));
+}
+
+void idtable_free(IdTable* table) {
+    free(table->arena);
+    free(table->offsets);
+    free(table->slots);
+    idtable_init(table);
+}
+
+int idtable_valid(const IdTable* table) {
+    if (table->num_ids > 0 && (table->offsets[0] != 0 || table->offsets[table->num_ids] != table->arena_len)) {
+        return 0;
+    }
+    if (table->num_ids == 0 && table->arena_len != 0) {
+        return 0;
+    }
+    for (int i = 0; i < table->num_ids; i++) {
+        size_t end = table->offsets[i + 1];
+        if (end <= table->offsets[i] || table->arena[end - 1] != '\0') {
+            return 0;
+        }
+    }
+    // idtable_find() does not probe an empty slot array
+    if (table->num_slots == 0) {
+        return table->num_ids == 0;
+    }
+    if ((table->num_slots & (table->num_slots - 1)) != 0) {
+        return 0;
+    }
+    size_t used = 0;
+    for (size_t slot = 0; slot < table->num_slots; slot++) {
+        int index = table->slots[slot];
+        if (index < -1 || index >= table->num_ids) {
+            return 0;
+        }
+        used += index >= 0;
+    }
+    return used < table->num_slots;
+}
+
+static size_t probe(const IdTable* table, const char* id, size_t len, int* found) {
+    size_t mask = table->num_slots - 1;
+    size_t slot = hash_id(id, len) & mask;
+    for (;;) {
+        int index = table->slots[slot];
+        if (index < 0) {
+            *found = -1;
+            return slot;
+        }
+        if (idtable_length(table, index) == len &&
+            memcmp(idtable_get(table, index), id, len) == 0) {
+            *found = index;
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+// Double the slot array and re-insert every interned ID
+static void grow_slots(IdTable* table) {
+    size_t num_slots = table->num_slots ? 2 * table->num_slots : 1024;
+    int *slots = malloc(num_slots * sizeof(int));
+    if (!slots) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for ID table");
+    }
+    memset(slots, 0xff, num_slots * sizeof(int));
+    free(table->slots);
+    table->slots = slots;
+    table->num_slots = num_slots;
+
+    size_t mask = num_slots - 1;
+    for (int i = 0; i < table->num_ids; i++) {
+        size_t slot = hash_id(idtable_get(table, i), idtable_length(table, i)) & mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i;
+    }
+}
+
+int idtable_find(const IdTable* table, const char* id, size_t len) {
+    if (table->num_slots == 0) {
+        return -1;
+    }
+    int found;
+    probe(table, id, len, &found);
+    return found;
+}
+
+int idtable_intern(IdTable* table, const char* id, size_t len) {
+    // Keep the load factor at or below 1/2
+    if ((size_t)table->num_ids + 1 > table->num_slots / 2) {
+        grow_slots(table);
+    }
+    int found;
+    size_t slot = probe(table, id, len, &found);
+    if (found >= 0) {
+        return found;
+    }
+
+    if (table->num_ids + 1 >= table->ids_capacity) {
+        int capacity = table->ids_capacity ? 2 * table->ids_capacity : 256;
+        size_t *offsets = realloc(table->offsets, capacity * sizeof(size_t));
+        if (!offsets) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for ID table");
+        }
+        if (table->ids_capacity == 0) {
+            offsets[0] = 0;
+        }
+        table->offsets = offsets;
+        table->ids_capacity = capacity;
+    }
+    if (table->arena_len + len + 1 > table->arena_cap) {
+        size_t capacity = table->arena_cap ? 2 * table->arena_cap : 4096;
+        while (capacity < table->arena_len + len + 1) {
+            capacity *= 2;
+        }
+        char *arena = realloc(table->arena, capacity);
+        if (!arena) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for ID table");
+        }
+        table->arena = arena;
+        table->arena_cap = capacity;
+    }
+
+    memcpy(table->arena + table->arena_len, id, len);
+    table->arena[table->arena_len + len] = '\0';
+    table->arena_len += len + 1;
+
+    int index = table->num_ids++;
+    table->offsets[table->num_ids] = table->arena_len;
+    table->slots[slot] = index;
+    return index;
+}
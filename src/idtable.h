@@ -0,0 +1,48 @@
+#ifndef _INC_IDTABLE_H
+#define _INC_IDTABLE_H
+
+#include <stddef.h>
+
+// Interning table mapping node IDs to dense indices 0, 1, 2, ...
+// Every ID is stored exactly once, NUL-terminated, in an append-only string
+// arena; an open-addressing hash table (linear probing) over the arena
+// offsets gives O(1) amortized lookups.
+typedef struct {
+    char *arena;
+    size_t arena_len;
+    size_t arena_cap;
+
+    // ID i occupies arena[offsets[i] .. offsets[i + 1] - 1), plus its NUL
+    size_t *offsets;
+    int num_ids;
+    int ids_capacity;
+
+    // Power-of-two sized; each slot holds an ID index or -1 when empty
+    int *slots;
+    size_t num_slots;
+} IdTable;
+
+void idtable_init(IdTable* table);
+void idtable_free(IdTable* table);
+
+// Return the index of the given ID, or -1 if it was never interned
+int idtable_find(const IdTable* table, const char* id, size_t len);
+
+// Return the index of the given ID, appending it to the table if needed
+int idtable_intern(IdTable* table, const char* id, size_t len);
+
+// Check a table that was not built by idtable_intern() (e.g. mapped from a
+// file): every ID lies within the arena and ends with its NUL, and the
+// slots hold valid indices and at least one empty slot, so lookups stay in
+// bounds and terminate. Returns 1 if the table is consistent.
+int idtable_valid(const IdTable* table);
+
+static inline const char* idtable_get(const IdTable* table, int index) {
+    return table->arena + table->offsets[index];
+}
+
+static inline size_t idtable_length(const IdTable* table, int index) {
+    return table->offsets[index + 1] - table->offsets[index] - 1;
+}
+
+#endif /* !_INC_IDTABLE_H */
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+
+static void rank_sweep_scalar(size_t n, double base, double damping,
+                              const double* link_sums, const double* current,
+                              const double* inv_degree, double* next,
+                              double* next_contrib, SweepSums* sums) {
+    double l1 = 0.0, linf = sums->linf, dangling = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double value = base + damping * link_sums[i];
+        double diff = fabs(value - current[i]);
+        l1 += diff;
+        if (diff > linf) linf = diff;
+        if (inv_degree[i] == 0.0) dangling += value;
+        next[i] = value;
+        next_contrib[i] = value * inv_degree[i];
+    }
+    sums->l1 += l1;
+    sums->linf = linf;
+    sums->dangling += dangling;
+}
+
+static double rank_scale_scalar(size_t n, const double* ranks,
+                                const double* inv_degree, double* contrib) {
+    double dangling = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        if (inv_degree[i] == 0.0) dangling += ranks[i];
+        contrib[i] = ranks[i] * inv_degree[i];
+    }
+    return dangling;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("avx2")))
+static double hsum256(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v), hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2")))
+static double hmax256(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v), hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_max_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_max_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2")))
+static void rank_sweep_avx2(size_t n, double base, double damping,
+                            const double* link_sums, const double* current,
+                            const double* inv_degree, double* next,
+                            double* next_contrib, SweepSums* sums) {
+    const __m256d vbase = _mm256_set1_pd(base), vdamping = _mm256_set1_pd(damping);
+    const __m256d sign = _mm256_set1_pd(-0.0), zero = _mm256_setzero_pd();
+    __m256d l1 = zero, linf = zero, dangling = zero;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d value = _mm256_add_pd(vbase, _mm256_mul_pd(vdamping, _mm256_loadu_pd(link_sums + i)));
+        __m256d diff = _mm256_andnot_pd(sign, _mm256_sub_pd(value, _mm256_loadu_pd(current + i)));
+        __m256d inv = _mm256_loadu_pd(inv_degree + i);
+        l1 = _mm256_add_pd(l1, diff);
+        linf = _mm256_max_pd(linf, diff);
+        dangling = _mm256_add_pd(dangling, _mm256_and_pd(_mm256_cmp_pd(inv, zero, _CMP_EQ_OQ), value));
+        _mm256_storeu_pd(next + i, value);
+        _mm256_storeu_pd(next_contrib + i, _mm256_mul_pd(value, inv));
+    }
+    sums->l1 += hsum256(l1);
+    sums->dangling += hsum256(dangling);
+    double vmax = hmax256(linf);
+    if (vmax > sums->linf) sums->linf = vmax;
+    rank_sweep_scalar(n - i, base, damping, link_sums + i, current + i, inv_degree + i,
+                      next + i, next_contrib + i, sums);
+}
+
+__attribute__((target("avx2")))
+static double rank_scale_avx2(size_t n, const double* ranks,
+                              const double* inv_degree, double* contrib) {
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d dangling = zero;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d value = _mm256_loadu_pd(ranks + i), inv = _mm256_loadu_pd(inv_degree + i);
+        dangling = _mm256_add_pd(dangling, _mm256_and_pd(_mm256_cmp_pd(inv, zero, _CMP_EQ_OQ), value));
+        _mm256_storeu_pd(contrib + i, _mm256_mul_pd(value, inv));
+    }
+    return hsum256(dangling) + rank_scale_scalar(n - i, ranks + i, inv_degree + i, contrib + i);
+}
+
+__attribute__((target("avx512f")))
+static void rank_sweep_avx512(size_t n, double base, double damping,
+                              const double* link_sums, const double* current,
+                              const double* inv_degree, double* next,
+                              double* next_contrib, SweepSums* sums) {
+    const __m512d vbase = _mm512_set1_pd(base), vdamping = _mm512_set1_pd(damping);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d l1 = zero, linf = zero, dangling = zero;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d value = _mm512_add_pd(vbase, _mm512_mul_pd(vdamping, _mm512_loadu_pd(link_sums + i)));
+        __m512d diff = _mm512_abs_pd(_mm512_sub_pd(value, _mm512_loadu_pd(current + i)));
+        __m512d inv = _mm512_loadu_pd(inv_degree + i);
+        l1 = _mm512_add_pd(l1, diff);
+        linf = _mm512_max_pd(linf, diff);
+        dangling = _mm512_mask_add_pd(dangling, _mm512_cmp_pd_mask(inv, zero, _CMP_EQ_OQ), dangling, value);
+        _mm512_storeu_pd(next + i, value);
+        _mm512_storeu_pd(next_contrib + i, _mm512_mul_pd(value, inv));
+    }
+    sums->l1 += _mm512_reduce_add_pd(l1);
+    sums->dangling += _mm512_reduce_add_pd(dangling);
+    double vmax = _mm512_reduce_max_pd(linf);
+    if (vmax > sums->linf) sums->linf = vmax;
+    rank_sweep_scalar(n - i, base, damping, link_sums + i, current + i, inv_degree + i,
+                      next + i, next_contrib + i, sums);
+}
+
+__attribute__((target("avx512f")))
+static double rank_scale_avx512(size_t n, const double* ranks,
+                                const double* inv_degree, double* contrib) {
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d dangling = zero;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d value = _mm512_loadu_pd(ranks + i), inv = _mm512_loadu_pd(inv_degree + i);
+        dangling = _mm512_mask_add_pd(dangling, _mm512_cmp_pd_mask(inv, zero, _CMP_EQ_OQ), dangling, value);
+        _mm512_storeu_pd(contrib + i, _mm512_mul_pd(value, inv));
+    }
+    return _mm512_reduce_add_pd(dangling) + rank_scale_scalar(n - i, ranks + i, inv_degree + i, contrib + i);
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+rank_sweep_fn rank_sweep = rank_sweep_scalar;
+rank_scale_fn rank_scale = rank_scale_scalar;
+
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+static const char *kernels_name = "scalar";
+
+static void select_kernels(void) {
+    // PAGERANK_KERNELS=scalar|avx2|avx512 caps the selection (for testing)
+    const char *cap = getenv("PAGERANK_KERNELS");
+    int allow_avx2 = !cap || strcmp(cap, "scalar") != 0;
+    int allow_avx512 = allow_avx2 && (!cap || strcmp(cap, "avx2") != 0);
+
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (allow_avx512 && __builtin_cpu_supports("avx512f")) {
+        rank_sweep = rank_sweep_avx512;
+        rank_scale = rank_scale_avx512;
+        kernels_name = "avx512";
+    } else if (allow_avx2 && __builtin_cpu_supports("avx2")) {
+        rank_sweep = rank_sweep_avx2;
+        rank_scale = rank_scale_avx2;
+        kernels_name = "avx2";
+    }
+#else
+    (void)allow_avx512;
+#endif
+}
+
+const char* kernels_init() {
+    // Solvers of separate engines may start on several threads at once
+    pthread_once(&kernels_once, select_kernels);
+    return kernels_name;
+}
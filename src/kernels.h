@@ -0,0 +1,44 @@
+#ifndef _INC_KERNELS_H
+#define _INC_KERNELS_H
+
+#include <stddef.h>
+
+// Dense vector kernels of the rank iteration. Each exists as portable
+// scalar code and, on x86, as AVX2 and AVX-512 versions; kernels_init()
+// picks the widest one the CPU supports. The element-wise values round
+// identically (no FMA contraction), but the vector versions accumulate the
+// residuals and the dangling mass per lane and add the lanes up at the
+// end. The sums therefore differ from the scalar ones by reassociation,
+// and as the dangling mass feeds the next iteration, ranks (and the
+// iteration meeting a tolerance) agree across kernel sets only up to
+// rounding.
+
+// Accumulators of a sweep; callers initialize them and may chain sweeps
+typedef struct {
+    double l1;          // sum of |next - current|
+    double linf;        // max of |next - current|
+    double dangling;    // sum of next over nodes with inv_degree == 0
+} SweepSums;
+
+// For i < n:
+//   next[i]         = base + damping * link_sums[i]
+//   next_contrib[i] = next[i] * inv_degree[i]
+// and fold |next[i] - current[i]| and the dangling mass into sums.
+typedef void (*rank_sweep_fn)(size_t n, double base, double damping,
+                              const double* link_sums, const double* current,
+                              const double* inv_degree, double* next,
+                              double* next_contrib, SweepSums* sums);
+
+// For i < n: contrib[i] = ranks[i] * inv_degree[i]; returns the sum of
+// ranks[i] over nodes with inv_degree == 0.
+typedef double (*rank_scale_fn)(size_t n, const double* ranks,
+                                const double* inv_degree, double* contrib);
+
+extern rank_sweep_fn rank_sweep;
+extern rank_scale_fn rank_scale;
+
+// Select the kernels for this CPU, once per process (thread-safe); returns
+// the name of the selected set
+const char* kernels_init();
+
+#endif /* !_INC_KERNELS_H */
@@ -1,10 +1,20 @@
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 #include <ctype.h> // For isdigit
+#include <unistd.h>
+#include "pagerank.h"
 #include "utils.h"
-#include "graph.h"
+#include "snapshot.h"
+#include "external.h"
+#include "markov.h"
+#include "rankfile.h"
+#include "reorder.h"
+#include "profile.h"
+#include "server.h"
 
 void print_helppage () {
     printf("Usage: ./pagerank [OPTIONS] ... [FILENAME]\n");
@@ -12,8 +22,114 @@ void print_helppage () {
     printf("  -h        Print a brief overview of the available command line parameters\n");
     printf("  -r N      Simulate N steps of the random surfer and output the result\n");
     printf("  -m N      Simulate N steps of the Markov chain and output the result\n");
+    printf("  -m auto   Iterate the Markov chain until it converges (see -e)\n");
+    printf("  -e TOL    Stop the Markov chain once the L1 change per step is below TOL\n");
+    printf("            (Default with -m auto: TOL = 1e-9)\n");
     printf("  -s        Compute and print the statistics of the graph\n");
     printf("  -p P      Set the teleportation parameter p to P%%. (Default: P = 10)\n");
+    printf("            A comma-separated list P1,P2,... ranks the graph for every value\n");
+    printf("            in one run of -m and prints one column per value, in order\n");
+    printf("  -j T      Use T threads (Default: T = 1)\n");
+    printf("  --walks R Estimate the ranks from R random walks started at every node\n");
+    printf("            (complete-path Monte Carlo; needs P > 0)\n");
+    printf("  --seed S  Seed the random surfer with the integer S for reproducible runs\n");
+    printf("            (Default: derived from the clock and process id)\n");
+    printf("  --solver S\n");
+    printf("            Markov chain solver: jacobi, gauss-seidel, extrapolate[:K]\n");
+    printf("            (quadratic extrapolation every K iterations, Default: K = 10),\n");
+    printf("            adaptive, blocked (cache-blocked propagation; only faster than\n");
+    printf("            jacobi once the ranks, 8 bytes per node, exceed the last-level\n");
+    printf("            cache, and 2-4x slower below that), or all to compare them on\n");
+    printf("            stderr (implies -v)\n");
+    printf("            (Default: jacobi)\n");
+    printf("  --seeds LIST\n");
+    printf("            Personalized PageRank: teleport to the comma-separated nodes of\n");
+    printf("            LIST (each ID optionally followed by :WEIGHT) instead of all\n");
+    printf("            nodes. Repeat to compute several vectors in one batched run\n");
+    printf("  --teleport FILE\n");
+    printf("            Like --seeds, one set per line of FILE\n");
+    printf("  --push EPS\n");
+    printf("            Approximate the personalized PageRank of a single set locally\n");
+    printf("            by pushing residuals larger than EPS per out-edge\n");
+    printf("  --delta FILE\n");
+    printf("            Apply the edge diff in FILE ('+A -> B;' inserts, '-A -> B;'\n");
+    printf("            deletes an edge) to the graph after loading it\n");
+    printf("  --ranks FILE\n");
+    printf("            Start -m from the ranks in FILE (as printed by -m) instead of\n");
+    printf("            the uniform vector; with --delta, FILE must hold converged\n");
+    printf("            ranks of the graph before the diff, and only the nodes it\n");
+    printf("            affects are re-converged\n");
+    printf("  --save-ranks FILE\n");
+    printf("            Also write the computed ranks to FILE with full precision,\n");
+    printf("            e.g. for a later --ranks\n");
+    printf("  --top K   Print only the K nodes with the highest rank (in the first\n");
+    printf("            column), best first, instead of all nodes sorted by ID\n");
+    printf("  --format F\n");
+    printf("            Result format: text (Default), raw (the little-endian float64\n");
+    printf("            ranks in node order, aligned with the ID table of a snapshot)\n");
+    printf("            or columnar (header, ID offsets, ID bytes and ranks)\n");
+    printf("  --output FILE\n");
+    printf("            Write the results to FILE instead of stdout\n");
+    printf("  --reorder M\n");
+    printf("            Renumber the nodes after loading for cache locality: degree\n");
+    printf("            (hubs first), rcm (reverse Cuthill-McKee) or community (label\n");
+    printf("            propagation blocks). The output does not change (Default: none)\n");
+    printf("  --pack    Keep the in-edges delta-coded as group varints, about half\n");
+    printf("            the memory and bandwidth. Snapshots written with --save-binary\n");
+    printf("            stay packed\n");
+    printf("  --save-binary FILE\n");
+    printf("            Write the loaded graph to FILE as a binary snapshot; a snapshot\n");
+    printf("            can be given as FILENAME instead of a DOT file\n");
+    printf("  --save-edges FILE\n");
+    printf("            Convert the DOT file FILENAME to the edge file FILE in one\n");
+    printf("            streaming pass and rank it out of core: only per-node arrays\n");
+    printf("            stay in memory and each -m iteration reads the edges from\n");
+    printf("            disk. An edge file can be given as FILENAME later on\n");
+    printf("  --profile[=FILE]\n");
+    printf("            Report wall and CPU time, heap growth and hardware counters\n");
+    printf("            per phase and the time of each Markov chain iteration on\n");
+    printf("            stderr, or as JSON to FILE\n");
+    printf("  --serve SOCKET\n");
+    printf("            Load the graph once and answer rank queries (score ID, top K,\n");
+    printf("            ranks, each with optional p=P and seeds=LIST) on the Unix\n");
+    printf("            socket SOCKET until interrupted, caching the converged vectors\n");
+    printf("  --workers W\n");
+    printf("            Answer up to W requests at the same time (Default: W = 4)\n");
+    printf("  -v        Report timings and convergence details on stderr\n");
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-h] [-r N] [-m N|auto] [-e TOL] [-s] [-p P[,P...]] [-j T] [-v] [--walks R] [--seed S] [--solver S] [--seeds LIST] [--teleport FILE] [--push EPS] [--delta FILE] [--ranks FILE] [--save-ranks FILE] [--top K] [--format F] [--output FILE] [--reorder M] [--pack] [--profile[=FILE]] [--serve SOCKET] [--workers W] [--save-binary FILE] [--save-edges FILE] [FILENAME]\n", program);
+}
+
+// The engine behind the command line; a failed call ends the program
+static PagerankEngine *engine;
+
+static void check(PagerankStatus status) {
+    if (status != PAGERANK_OK) {
+        fprintf(stderr, "Error: %s\n", pagerank_error(engine));
+        exit(1);
+    }
+}
+
+// Where and how results are written
+typedef struct {
+    size_t top;             // print only the best nodes (--top; 0 means all, by ID)
+    const char *format;     // --format
+    FILE *file;             // stdout or --output
+    const char *name;       // of file, for messages
+    const char *save_path;  // full-precision text copy (--save-ranks)
+    Profile *profile;       // --profile, or NULL
+} RankOutput;
+
+// Write the last result of the engine as selected by output and save it
+// with full precision if requested
+static void output_ranks(const RankOutput* output) {
+    profile_phase(output->profile, "output");
+    check(pagerank_write_ranks(engine, output->file, output->name, output->format, output->top));
+    if (output->save_path) {
+        check(pagerank_save_ranks(engine, output->save_path));
+    }
 }
 
 // Helper to check if a string is purely numeric
@@ -26,13 +142,42 @@ int is_numeric(const char *s) {
 
 
 int main(int argc, char *const argv[]) {
-    char option;
+    int option;
     char *filename = NULL;
+    char *save_path = NULL; // Snapshot to write (--save-binary)
+    char *edges_path = NULL; // Edge file to convert to and rank out of core (--save-edges)
     int s_flag = 0; // Flag for -s option
-    int r_steps = -1; // Steps for random surfer (-1 means not specified)
+    int v_flag = 0; // Flag for -v option
+    int num_threads = 1; // Threads for parsing and the Markov chain (-j)
+    long long r_steps = -1; // Steps for random surfer (-1 means not specified)
+    int walks = -1; // Walks per node for the complete-path estimator (--walks)
     int m_steps = -1; // Steps for Markov chain (-1 means not specified)
-    int p_percent = 10; // Default teleportation percentage
-    double teleport_prob = 0.10; // Teleportation probability derived from p_percent
+    double tolerance = 0.0; // Convergence tolerance for the Markov chain (-e)
+    double teleport_prob = 0.10; // Teleportation probability derived from -p (the first one of a list)
+    double *teleport_probs = NULL; // All values of -p P1,P2,... (parameter sweep)
+    int num_probs = 1;
+    int jacobi_solver = 1; // Markov chain solver is jacobi (--solver)
+    int compare_solvers = 0; // --solver all
+    uint64_t seed = 0; // Random surfer seed (--seed)
+    int seed_given = 0;
+    const char **seed_lists = calloc(argc, sizeof(char *)); // --seeds, in order
+    int num_seed_lists = 0;
+    char *teleport_path = NULL; // Teleport sets file (--teleport)
+    double push_epsilon = 0.0; // Residual threshold of --push (0 means no push)
+    char *delta_path = NULL; // Edge diff to apply (--delta)
+    char *ranks_path = NULL; // Previous ranks to start -m from (--ranks)
+    char *save_ranks_path = NULL; // Full-precision copy of the output (--save-ranks)
+    size_t top = 0; // Print only the best nodes (--top; 0 means all, by ID)
+    RankFormat format = RANKS_TEXT; // Result format (--format)
+    const char *format_name = "text";
+    char *output_path = NULL; // Result file instead of stdout (--output)
+    ReorderMethod reorder = REORDER_NONE; // Node renumbering after loading (--reorder)
+    const char *reorder_name = "none";
+    int pack = 0; // Compress the in-edges (--pack)
+    int profile_flag = 0; // Profile the phases (--profile)
+    char *profile_path = NULL; // JSON profile instead of the table on stderr (--profile=FILE)
+    char *socket_path = NULL; // Serve queries on this socket (--serve)
+    int num_workers = 4; // Requests answered at the same time (--workers)
 
     // Input validation: Check if no arguments are provided
     if (argc == 1) {
@@ -40,35 +185,204 @@ int main(int argc, char *const argv[]) {
          exit(0);
     }
 
-    while ((option = getopt(argc, argv, "hr:m:sp:")) != -1) {
+    engine = pagerank_create();
+    if (!engine) {
+        perror("Failed to allocate memory for the engine");
+        exit(1);
+    }
+
+    enum { OPT_SAVE_BINARY = 256, OPT_SOLVER, OPT_SEED, OPT_WALKS, OPT_SEEDS, OPT_TELEPORT, OPT_PUSH,
+           OPT_DELTA, OPT_RANKS, OPT_SAVE_RANKS, OPT_TOP,
+           OPT_FORMAT, OPT_OUTPUT, OPT_REORDER, OPT_PACK, OPT_PROFILE,
+           OPT_SERVE, OPT_WORKERS, OPT_SAVE_EDGES };
+    static const struct option long_options[] = {
+        { "save-binary", required_argument, NULL, OPT_SAVE_BINARY },
+        { "solver", required_argument, NULL, OPT_SOLVER },
+        { "seed", required_argument, NULL, OPT_SEED },
+        { "walks", required_argument, NULL, OPT_WALKS },
+        { "seeds", required_argument, NULL, OPT_SEEDS },
+        { "teleport", required_argument, NULL, OPT_TELEPORT },
+        { "push", required_argument, NULL, OPT_PUSH },
+        { "delta", required_argument, NULL, OPT_DELTA },
+        { "ranks", required_argument, NULL, OPT_RANKS },
+        { "save-ranks", required_argument, NULL, OPT_SAVE_RANKS },
+        { "top", required_argument, NULL, OPT_TOP },
+        { "format", required_argument, NULL, OPT_FORMAT },
+        { "output", required_argument, NULL, OPT_OUTPUT },
+        { "reorder", required_argument, NULL, OPT_REORDER },
+        { "pack", no_argument, NULL, OPT_PACK },
+        { "profile", optional_argument, NULL, OPT_PROFILE },
+        { "serve", required_argument, NULL, OPT_SERVE },
+        { "workers", required_argument, NULL, OPT_WORKERS },
+        { "save-edges", required_argument, NULL, OPT_SAVE_EDGES },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((option = getopt_long(argc, argv, "hr:m:e:sp:vj:", long_options, NULL)) != -1) {
         switch (option) {
+            case OPT_SAVE_BINARY:
+                save_path = optarg;
+                break;
+            case OPT_SAVE_EDGES:
+                edges_path = optarg;
+                break;
+            case OPT_SEEDS:
+                seed_lists[num_seed_lists++] = optarg;
+                break;
+            case OPT_DELTA:
+                delta_path = optarg;
+                break;
+            case OPT_RANKS:
+                ranks_path = optarg;
+                break;
+            case OPT_SAVE_RANKS:
+                save_ranks_path = optarg;
+                break;
+            case OPT_TELEPORT:
+                teleport_path = optarg;
+                break;
+            case OPT_PUSH: {
+                char *end;
+                push_epsilon = strtod(optarg, &end);
+                if (*optarg == '\0' || *end != '\0' || !(push_epsilon > 0.0)) {
+                    fprintf(stderr, "Error: Invalid threshold EPS for --push option: '%s'. EPS must be a positive number.\n", optarg);
+                    exit(1);
+                }
+                break;
+            }
+            case OPT_FORMAT:
+                if (!parse_rank_format(optarg, &format)) {
+                    fprintf(stderr, "Error: Unknown output format '%s' for --format option. Use text, raw or columnar.\n", optarg);
+                    exit(1);
+                }
+                format_name = optarg;
+                break;
+            case OPT_OUTPUT:
+                output_path = optarg;
+                break;
+            case OPT_REORDER:
+                if (!parse_reorder_method(optarg, &reorder)) {
+                    fprintf(stderr, "Error: Unknown method '%s' for --reorder option. Use none, degree, rcm or community.\n", optarg);
+                    exit(1);
+                }
+                reorder_name = optarg;
+                break;
+            case OPT_PACK:
+                pack = 1;
+                break;
+            case OPT_PROFILE:
+                profile_flag = 1;
+                profile_path = optarg;
+                break;
+            case OPT_SERVE:
+                socket_path = optarg;
+                break;
+            case OPT_WORKERS:
+                if (!is_numeric(optarg) || (num_workers = atoi(optarg)) < 1) {
+                    fprintf(stderr, "Error: Invalid number of workers W for --workers option: '%s'. W must be a positive integer.\n", optarg);
+                    exit(1);
+                }
+                break;
+            case OPT_TOP:
+                if (!is_numeric(optarg) || atoll(optarg) < 1) {
+                    fprintf(stderr, "Error: Invalid number of nodes K for --top option: '%s'. K must be a positive integer.\n", optarg);
+                    exit(1);
+                }
+                top = (size_t)atoll(optarg);
+                break;
+            case OPT_WALKS:
+                if (!is_numeric(optarg) || (walks = atoi(optarg)) < 1) {
+                    fprintf(stderr, "Error: Invalid number of walks R for --walks option: '%s'. R must be a positive integer.\n", optarg);
+                    exit(1);
+                }
+                break;
+            case OPT_SEED: {
+                char *end;
+                seed = strtoull(optarg, &end, 0);
+                if (!isdigit((unsigned char)*optarg) || *end != '\0') {
+                    fprintf(stderr, "Error: Invalid seed S for --seed option: '%s'. S must be a non-negative integer.\n", optarg);
+                    exit(1);
+                }
+                seed_given = 1;
+                break;
+            }
+            case OPT_SOLVER:
+                if (pagerank_set_solver(engine, optarg) != PAGERANK_OK) {
+                    fprintf(stderr, "Error: Invalid solver for --solver option: '%s'. Use jacobi, gauss-seidel, extrapolate[:K] with K >= 4, adaptive, blocked or all.\n",
+                            optarg);
+                    exit(1);
+                }
+                jacobi_solver = strcmp(optarg, "jacobi") == 0;
+                compare_solvers = strcmp(optarg, "all") == 0;
+                break;
             case 'h':
                 print_helppage();
                 exit(0);
             case 's':
                 s_flag = 1; // Set the flag when -s is encountered
                 break;
+            case 'v':
+                v_flag = 1;
+                break;
+            case 'j':
+                if (!is_numeric(optarg) || (num_threads = atoi(optarg)) < 1) {
+                    fprintf(stderr, "Error: Invalid number of threads T for -j option: '%s'. T must be a positive integer.\n", optarg);
+                    exit(1);
+                }
+                break;
             case 'r':
-                if (!is_numeric(optarg) || (r_steps = atoi(optarg)) < 0) {
+                if (!is_numeric(optarg) || (r_steps = strtoll(optarg, NULL, 10)) < 0) {
                     fprintf(stderr, "Error: Invalid number of steps N for -r option: '%s'. N must be a non-negative integer.\n", optarg);
                     exit(1);
                 }
                 break;
             case 'm':
+                if (strcmp(optarg, "auto") == 0) {
+                    m_steps = MARKOV_AUTO_MAX_ITERATIONS;
+                    if (tolerance == 0.0) tolerance = 1e-9;
+                    break;
+                }
                  if (!is_numeric(optarg) || (m_steps = atoi(optarg)) < 0) {
                     fprintf(stderr, "Error: Invalid number of steps N for -m option: '%s'. N must be a non-negative integer.\n", optarg);
                     exit(1);
                 }
                 break;
-            case 'p':
-                 if (!is_numeric(optarg) || (p_percent = atoi(optarg)) < 0 || p_percent > 100) {
-                    fprintf(stderr, "Error: Invalid percentage P for -p option: '%s'. P must be between 0 and 100.\n", optarg);
+            case 'e': {
+                char *end;
+                tolerance = strtod(optarg, &end);
+                if (*optarg == '\0' || *end != '\0' || !(tolerance > 0.0)) {
+                    fprintf(stderr, "Error: Invalid tolerance TOL for -e option: '%s'. TOL must be a positive number.\n", optarg);
                     exit(1);
                 }
-                teleport_prob = (double)p_percent / 100.0;
                 break;
+            }
+            case 'p': {
+                // A comma-separated list of percentages runs a parameter sweep
+                free(teleport_probs);
+                teleport_probs = malloc((strlen(optarg) / 2 + 1) * sizeof(double));
+                if (!teleport_probs) {
+                    perror("Failed to allocate memory for teleport probabilities");
+                    exit(1);
+                }
+                num_probs = 0;
+                const char *token = optarg;
+                for (;;) {
+                    char *end;
+                    long p_percent = strtol(token, &end, 10);
+                    if (end == token || isspace(*token) || (*end != ',' && *end != '\0') ||
+                        p_percent < 0 || p_percent > 100) {
+                        fprintf(stderr, "Error: Invalid percentage P for -p option: '%s'. P must be between 0 and 100.\n", optarg);
+                        exit(1);
+                    }
+                    teleport_probs[num_probs++] = (double)p_percent / 100.0;
+                    if (*end == '\0') break;
+                    token = end + 1;
+                }
+                teleport_prob = teleport_probs[0];
+                break;
+            }
             default: // Handles unknown options or missing arguments for options
-                fprintf(stderr, "Usage: %s [-h] [-r N] [-m N] [-s] [-p P] [FILENAME]\n", argv[0]);
+                print_usage(argv[0]);
                 exit(1);
         }
     }
@@ -79,13 +393,13 @@ int main(int argc, char *const argv[]) {
         // Optional: Check if more than one filename is provided
         if (optind + 1 < argc) {
             fprintf(stderr, "Error: Too many file names provided.\n");
-            fprintf(stderr, "Usage: %s [-h] [-r N] [-m N] [-s] [-p P] [FILENAME]\n", argv[0]);
+            print_usage(argv[0]);
             exit(1);
         }
     } else {
         // Filename is required unless only -h was used (which exits)
          fprintf(stderr, "Error: No input file provided.\n");
-         fprintf(stderr, "Usage: %s [-h] [-r N] [-m N] [-s] [-p P] [FILENAME]\n", argv[0]);
+         print_usage(argv[0]);
          exit(1);
     }
 
@@ -97,77 +411,182 @@ int main(int argc, char *const argv[]) {
          fprintf(stderr, "Warning: Both -r and -m specified. Running both simulations.\n");
          // Or exit: fprintf(stderr, "Error: Cannot specify both -r and -m options.\n"); exit(1);
     }
+    int personalized = num_seed_lists > 0 || teleport_path;
+    if (push_epsilon > 0 && !personalized) {
+         fprintf(stderr, "Error: --push needs a teleport set (--seeds or --teleport).\n");
+         exit(1);
+    }
+    if (personalized && m_steps >= 0 && (!jacobi_solver || compare_solvers)) {
+         fprintf(stderr, "Error: Personalized PageRank only supports the jacobi solver.\n");
+         exit(1);
+    }
+    if (ranks_path && (m_steps < 0 || personalized || compare_solvers)) {
+         fprintf(stderr, "Error: --ranks needs -m with a single solver and without teleport sets.\n");
+         exit(1);
+    }
+    if (num_probs > 1 && (m_steps < 0 || r_steps >= 0 || walks > 0 || push_epsilon > 0 || personalized ||
+                          ranks_path || !jacobi_solver || compare_solvers)) {
+         fprintf(stderr, "Error: A list of -p values needs -m with the jacobi solver, without teleport sets or --ranks.\n");
+         exit(1);
+    }
+    if ((walks > 0 || push_epsilon > 0) && teleport_prob == 0.0) {
+         fprintf(stderr, "Error: --walks and --push need a teleportation probability P > 0, otherwise they never end.\n");
+         exit(1);
+    }
     if (s_flag && (r_steps >= 0 || m_steps >= 0)) {
          fprintf(stderr, "Warning: -s specified with -r or -m. Running statistics first, then simulation(s).\n");
          // Or exit: fprintf(stderr, "Error: Cannot specify -s with -r or -m options.\n"); exit(1);
     }
+    if (socket_path && (s_flag || r_steps >= 0 || walks > 0 || push_epsilon > 0 || personalized || ranks_path ||
+                        save_ranks_path || top > 0 || format != RANKS_TEXT || output_path || num_probs > 1 ||
+                        compare_solvers)) {
+         fprintf(stderr, "Error: --serve answers queries only; it cannot be combined with -s, -r, --walks, --push, --seeds, --teleport, --ranks, --save-ranks, --top, --format, --output, a list of -p values or --solver all.\n");
+         exit(1);
+    }
+    if (socket_path && m_steps < 0) {
+        // Queries are answered with converged vectors
+        m_steps = MARKOV_AUTO_MAX_ITERATIONS;
+        if (tolerance == 0.0) tolerance = 1e-9;
+    }
+    if (edges_path && is_snapshot_file(filename)) {
+         fprintf(stderr, "Error: --save-edges converts a DOT file, but %s is a snapshot.\n", filename);
+         exit(1);
+    }
+    int num_results = (r_steps >= 0 || walks > 0) + (push_epsilon > 0) + (m_steps >= 0);
+    if (format != RANKS_TEXT && (top > 0 || num_results > 1)) {
+         fprintf(stderr, "Error: Binary output formats hold all ranks of a single result; they cannot be combined with --top or with more than one of -r, --walks, --push and -m.\n");
+         exit(1);
+    }
+    Profile *profile = profile_flag ? profile_create() : NULL;
+    RankOutput output = { top, format_name, stdout, "stdout", save_ranks_path, profile };
+    if (output_path) {
+        output.file = fopen(output_path, "wb");
+        output.name = output_path;
+        if (!output.file) {
+            perror("Error opening output file");
+            exit(1);
+        }
+    } else if (format != RANKS_TEXT && num_results > 0 && isatty(STDOUT_FILENO)) {
+         fprintf(stderr, "Error: Refusing to write binary output to a terminal; use --output FILE or redirect stdout.\n");
+         exit(1);
+    }
 
 
-    // Initialize graph common to multiple options
-    Graph graph;
-    init_graph(&graph);
-    parse_dot_file(&graph, filename); // Assume parse handles file errors
+    // The comparison table of --solver all is part of the log
+    pagerank_set_log(engine, v_flag || compare_solvers ? stderr : NULL);
+    check(pagerank_set_threads(engine, num_threads));
+    if (teleport_probs) {
+        check(pagerank_set_teleport(engine, teleport_probs, num_probs));
+    }
+    check(pagerank_set_iterations(engine, m_steps >= 0 ? m_steps : 0, tolerance));
+    pagerank_record_iterations(engine, profile != NULL);
+
+    if (edges_path) {
+        // The graph never has to fit in memory: rank the edge file instead
+        profile_phase(profile, "convert");
+        check(pagerank_convert_edges(engine, filename, edges_path));
+        filename = edges_path;
+    }
+    profile_phase(profile, is_snapshot_file(filename) || is_edge_file(filename) ? "load" : "parse");
+    check(pagerank_load(engine, filename));
+
+    // Renumber before the diff, whose new nodes are simply appended
+    if (reorder != REORDER_NONE) {
+        profile_phase(profile, "reorder");
+        check(pagerank_reorder(engine, reorder_name));
+    }
+
+    if (delta_path) {
+        profile_phase(profile, "delta");
+        check(pagerank_apply_diff(engine, delta_path));
+    }
+
+    if (pack) {
+        profile_phase(profile, "pack");
+        check(pagerank_pack(engine));
+    }
+
+    if (save_path) {
+        profile_phase(profile, "save");
+        check(pagerank_save_snapshot(engine, save_path));
+    }
 
     // Handle -s
     if (s_flag) {
-        print_graph_stats(&graph);
+        profile_phase(profile, "stats");
+        check(pagerank_print_stats(engine, stdout));
         // Decide if -s should exit or continue to other operations
         // Based on common usage, -s usually just prints stats and exits.
         // If you want it to run *before* simulations, remove the exit(0).
+        profile_report(profile, profile_path);
+        profile_free(profile);
+        pagerank_free(engine);
         exit(0);
     }
 
-    // Check if graph has nodes before simulations
-    if (graph.num_nodes == 0 && (r_steps > 0 || m_steps > 0)) {
-        fprintf(stderr, "Warning: Input graph has no nodes. Cannot run simulations.\n");
-        // Decide whether to exit or just print empty results later
-        if (r_steps > 0) printf("\nRandom Surfer Results (N=%d, p=%.2f):\n(No nodes)\n", r_steps, teleport_prob);
-        if (m_steps > 0) printf("\nMarkov Chain Results (N=%d, p=%.2f):\n(No nodes)\n", m_steps, teleport_prob);
-        exit(0); // Exit if no nodes for simulations
+    // Handle --serve; the teleport sets, -p and the results are per query
+    if (socket_path) {
+        profile_phase(profile, "serve");
+        ServerOptions options = { socket_path, num_workers, teleport_prob, v_flag };
+        serve(engine, &options);
+        free(seed_lists);
+        free(teleport_probs);
+        profile_report(profile, profile_path);
+        profile_free(profile);
+        pagerank_free(engine);
+        exit(0);
+    }
+
+    // Handle -r (Random Surfer) and --walks (complete-path estimator)
+    if (r_steps >= 0 || walks > 0) {
+        if (!seed_given) {
+            seed = rand_seed();
+        }
+        profile_phase(profile, "surfer");
+        check(r_steps >= 0 ? pagerank_run_surfer(engine, r_steps, seed) : pagerank_run_walks(engine, walks, seed));
+        output_ranks(&output);
     }
 
+    // Teleport sets refer to node IDs, so they are resolved after loading
+    if (personalized) {
+        profile_phase(profile, "seeds");
+    }
+    for (int i = 0; i < num_seed_lists; i++) {
+        check(pagerank_add_seeds(engine, seed_lists[i]));
+    }
+    if (teleport_path) {
+        check(pagerank_read_seeds(engine, teleport_path));
+    }
 
-    // Handle -r (Random Surfer)
-    if (r_steps >= 0) {
-         if (graph.num_nodes > 0) {
-            printf("\nRunning Random Surfer Simulation (N=%d, p=%.2f)...\n", r_steps, teleport_prob);
-            rand_init(); // Initialize random seed before simulation
-            simulate_random_surfer(&graph, r_steps, teleport_prob);
-         } else if (r_steps == 0) {
-              printf("\nRandom Surfer Results (N=0, p=%.2f):\n(No steps performed)\n", teleport_prob);
-         }
+    // Handle --push (local personalized PageRank)
+    if (push_epsilon > 0) {
+        profile_phase(profile, "push");
+        check(pagerank_run_push(engine, push_epsilon));
+        output_ranks(&output);
     }
 
-    // Handle -m (Markov Chain)
+    // Handle -m (Markov Chain), personalized with teleport sets
     if (m_steps >= 0) {
-         if (graph.num_nodes > 0) {
-             printf("\nRunning Markov Chain Simulation (N=%d, p=%.2f)...\n", m_steps, teleport_prob);
-             simulate_markov_chain(&graph, m_steps, teleport_prob);
-         } else if (m_steps == 0) {
-             printf("\nMarkov Chain Results (N=0, p=%.2f):\n", teleport_prob);
-              // Print initial uniform distribution if steps = 0
-             double initial_rank = 1.0 / graph.num_nodes; // Should not happen due to check above, but for completeness
-             if (graph.num_nodes > 0) initial_rank = 1.0 / graph.num_nodes; else initial_rank = 0; // Avoid division by zero
-
-             // Need node IDs to print correctly, maybe call a helper
-             NodeRank *results = malloc(graph.num_nodes * sizeof(NodeRank));
-             if (!results) { perror("Failed to allocate memory for results"); exit(1); }
-             for (int i = 0; i < graph.num_nodes; ++i) {
-                 strncpy(results[i].id, graph.nodes[i].id, MAX_ID_LENGTH - 1);
-                 results[i].id[MAX_ID_LENGTH - 1] = '\0';
-                 results[i].rank = initial_rank;
-             }
-             // Need the comparison function here too
-             // int compare_node_ranks(const void *a, const void *b); // Declare or define
-             // qsort(results, graph.num_nodes, sizeof(NodeRank), compare_node_ranks);
-              for (int i = 0; i < graph.num_nodes; ++i) {
-                    printf("- %s: %.6f\n", results[i].id, results[i].rank);
-              }
-              free(results);
-         }
-    }
-
-    // Note: No need to free graph resources here if using stack allocation for Graph struct
-    // and static arrays within it. If you used malloc inside graph functions, add cleanup.
+        check(pagerank_set_start_ranks(engine, ranks_path));
+        profile_phase(profile, "markov");
+        check(pagerank_run_markov(engine));
+        output_ranks(&output);
+        int num_iterations;
+        const double *iteration_seconds = pagerank_iteration_seconds(engine, &num_iterations);
+        profile_iterations(profile, iteration_seconds, num_iterations);
+        if (tolerance > 0 && !compare_solvers && !pagerank_converged(engine) && pagerank_num_nodes(engine) > 0) {
+            fprintf(stderr, "Warning: Markov chain did not converge to %g within %d iterations.\n", tolerance, m_steps);
+        }
+    }
+
+    free(seed_lists);
+    free(teleport_probs);
+    if (output_path && fclose(output.file) != 0) {
+        perror("Error writing output file");
+        exit(1);
+    }
+    profile_report(profile, profile_path);
+    profile_free(profile);
+    pagerank_free(engine);
     exit(0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,1227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "markov.h"
+#include "graph.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "utils.h"
+#include "error.h"
+
+
+// Shared state of one pull iteration. Thread t owns the destination nodes
+// [bounds[t], bounds[t + 1]), chosen so that every range covers about the
+// same number of nodes plus in-edges. Each destination pulls the
+// precomputed contributions current_prob[i] / out_degree(i) of its
+// predecessors over the CSC, so no two threads ever write the same entry.
+typedef struct {
+    const Graph *graph;
+    const double *inv_degree;   // 1 / out_degree(i), 0 for dangling nodes
+    double damping;             // 1 - p
+    double base;                // uniform share added to every node
+    const double *current;
+    double *next;
+    const double *contrib;
+    double *next_contrib;
+    int *bounds;
+    double *partials;           // per thread: dangling sum, L1, Linf, edges
+    // Adaptive solver only: nodes whose rank changed by less than
+    // freeze_tolerance relative to their rank in freeze_after consecutive
+    // sweeps are frozen, i.e. their link sum is kept in frozen_sums instead
+    // of being gathered again
+    unsigned char *frozen;      // consecutive quiet sweeps, capped at freeze_after
+    double *frozen_sums;
+    double freeze_tolerance;
+    int freeze_after;
+    struct PropagationBins *bins;   // blocked solver only
+} PullStep;
+
+// Partial results are a cache line apart to avoid false sharing
+#define PARTIAL_STRIDE 8
+enum { PARTIAL_DANGLING, PARTIAL_L1, PARTIAL_LINF, PARTIAL_EDGES, PARTIAL_FROZEN };
+
+// A single quiet sweep can be a coincidence (e.g. a node whose first
+// iterate happens to equal the uniform start), so require a few in a row.
+// Every failed check of the adaptive solver doubles the number, up to
+// FREEZE_AFTER_MAX, since a node can also stay quiet until a change
+// upstream reaches it.
+#define FREEZE_AFTER 3
+#define FREEZE_AFTER_MAX 192
+
+// Nodes per block of the pull step: the link sums of a block are gathered
+// into a small buffer that stays in L1 and then finished by one dense sweep
+#define SWEEP_BLOCK 256
+
+// Compute the contributions of the initial vector
+static void pull_init(void* arg, int tid, int num_threads) {
+    PullStep *step = arg;
+    int lo = step->bounds[tid], hi = step->bounds[tid + 1];
+    step->partials[tid * PARTIAL_STRIDE + PARTIAL_DANGLING] =
+        rank_scale(hi - lo, step->current + lo, step->inv_degree + lo, step->next_contrib + lo);
+}
+
+static void pull_step(void* arg, int tid, int num_threads) {
+    PullStep *step = arg;
+    const Graph *graph = step->graph;
+    const size_t *in_offsets = graph->in_offsets;
+    const int *in_sources = graph->in_sources;
+    const double *contrib = step->contrib;
+    double link_sums[SWEEP_BLOCK];
+    SweepSums sums = { 0.0, 0.0, 0.0 };
+
+    for (int lo = step->bounds[tid]; lo < step->bounds[tid + 1]; lo += SWEEP_BLOCK) {
+        int hi = lo + SWEEP_BLOCK < step->bounds[tid + 1] ? lo + SWEEP_BLOCK : step->bounds[tid + 1];
+        for (int j = lo; j < hi; ++j) {
+            double sum = 0.0;
+            for (size_t e = in_offsets[j]; e < in_offsets[j + 1]; ++e) {
+                sum += contrib[in_sources[e]];
+            }
+            link_sums[j - lo] = sum;
+        }
+        // Ranks, next contributions, residuals and dangling mass in one pass
+        rank_sweep(hi - lo, step->base, step->damping, link_sums, step->current + lo,
+                   step->inv_degree + lo, step->next + lo, step->next_contrib + lo, &sums);
+    }
+    double *partials = step->partials + tid * PARTIAL_STRIDE;
+    partials[PARTIAL_DANGLING] = sums.dangling;
+    partials[PARTIAL_L1] = sums.l1;
+    partials[PARTIAL_LINF] = sums.linf;
+}
+
+// Sum contrib over the packed list at p of node j, which has count
+// predecessors. Returns the start of the next node's list.
+static inline const unsigned char* packed_sum(const unsigned char* p, int j, size_t count,
+                                              const double* contrib, double* sum) {
+    uint32_t source = (uint32_t)j, values[4];
+    double total = 0.0;
+    for (size_t k = 0; k < count; k += 4) {
+        int group = count - k < 4 ? (int)(count - k) : 4;
+        // Full groups get an unrolled decoder
+        p = group == 4 ? read_group(p, 4, values) : read_group(p, group, values);
+        if (k == 0) values[0] = zigzag_decode(values[0]);
+        for (int i = 0; i < group; ++i) {
+            source += values[i];
+            total += contrib[source];
+        }
+    }
+    *sum = total;
+    return p;
+}
+
+// pull_step() on a packed graph: the predecessors are decoded on the fly,
+// trading a few instructions per edge for reading about half the bytes
+static void pull_step_packed(void* arg, int tid, int num_threads) {
+    PullStep *step = arg;
+    const Graph *graph = step->graph;
+    const size_t *in_offsets = graph->in_offsets;
+    const double *contrib = step->contrib;
+    double link_sums[SWEEP_BLOCK];
+    SweepSums sums = { 0.0, 0.0, 0.0 };
+    // The lists of a thread are consecutive, so one cursor walks them all
+    const unsigned char *p = packed_list(graph, step->bounds[tid]);
+
+    for (int lo = step->bounds[tid]; lo < step->bounds[tid + 1]; lo += SWEEP_BLOCK) {
+        int hi = lo + SWEEP_BLOCK < step->bounds[tid + 1] ? lo + SWEEP_BLOCK : step->bounds[tid + 1];
+        for (int j = lo; j < hi; ++j) {
+            p = packed_sum(p, j, in_offsets[j + 1] - in_offsets[j], contrib, &link_sums[j - lo]);
+        }
+        // Ranks, next contributions, residuals and dangling mass in one pass
+        rank_sweep(hi - lo, step->base, step->damping, link_sums, step->current + lo,
+                   step->inv_degree + lo, step->next + lo, step->next_contrib + lo, &sums);
+    }
+    double *partials = step->partials + tid * PARTIAL_STRIDE;
+    partials[PARTIAL_DANGLING] = sums.dangling;
+    partials[PARTIAL_L1] = sums.l1;
+    partials[PARTIAL_LINF] = sums.linf;
+}
+
+// Pull step of the adaptive solver: the in-edges of frozen nodes are not
+// read, their stale link sum still receives the current uniform share
+static void pull_step_adaptive(void* arg, int tid, int num_threads) {
+    PullStep *step = arg;
+    const Graph *graph = step->graph;
+    const size_t *in_offsets = graph->in_offsets;
+    const int *in_sources = graph->in_sources;
+    const double *contrib = step->contrib;
+    double dangling = 0.0, residual_l1 = 0.0, residual_linf = 0.0;
+    size_t edges = 0, num_frozen = 0;
+    // On a packed graph the lists of frozen nodes are skipped, not decoded
+    const unsigned char *p = graph->packed_sources ? packed_list(graph, step->bounds[tid]) : NULL;
+
+    for (int j = step->bounds[tid]; j < step->bounds[tid + 1]; ++j) {
+        double sum = step->frozen_sums[j];
+        if (step->frozen[j] == step->freeze_after) {
+            num_frozen++;
+            if (p) p = skip_list(p, in_offsets[j + 1] - in_offsets[j]);
+        } else if (p) {
+            p = packed_sum(p, j, in_offsets[j + 1] - in_offsets[j], contrib, &sum);
+            edges += in_offsets[j + 1] - in_offsets[j];
+        } else {
+            sum = 0.0;
+            for (size_t e = in_offsets[j]; e < in_offsets[j + 1]; ++e) {
+                sum += contrib[in_sources[e]];
+            }
+            edges += in_offsets[j + 1] - in_offsets[j];
+        }
+        double value = step->base + step->damping * sum;
+        double diff = fabs(value - step->current[j]);
+        residual_l1 += diff;
+        if (diff > residual_linf) residual_linf = diff;
+        if (step->frozen[j] < step->freeze_after) {
+            step->frozen[j] = diff < step->freeze_tolerance * step->current[j] ? step->frozen[j] + 1 : 0;
+            step->frozen_sums[j] = sum;
+        }
+        step->next[j] = value;
+        step->next_contrib[j] = value * step->inv_degree[j];
+        if (step->inv_degree[j] == 0.0) dangling += value;
+    }
+    double *partials = step->partials + tid * PARTIAL_STRIDE;
+    partials[PARTIAL_DANGLING] = dangling;
+    partials[PARTIAL_L1] = residual_l1;
+    partials[PARTIAL_LINF] = residual_linf;
+    partials[PARTIAL_EDGES] = (double)edges;
+    partials[PARTIAL_FROZEN] = (double)num_frozen;
+}
+
+// Check of an adaptive step whose residual met the tolerance: the frozen
+// nodes gather their in-edges after all, which completes the step as a
+// plain Jacobi step, and the residuals are taken again over all nodes.
+// Every node is thawed: if the check fails, some froze too early and all
+// have to prove themselves again.
+static void pull_step_thaw(void* arg, int tid, int num_threads) {
+    PullStep *step = arg;
+    const Graph *graph = step->graph;
+    const size_t *in_offsets = graph->in_offsets;
+    const int *in_sources = graph->in_sources;
+    const double *contrib = step->contrib;
+    double dangling = 0.0, residual_l1 = 0.0, residual_linf = 0.0;
+    size_t edges = 0;
+    const unsigned char *p = graph->packed_sources ? packed_list(graph, step->bounds[tid]) : NULL;
+
+    for (int j = step->bounds[tid]; j < step->bounds[tid + 1]; ++j) {
+        if (step->frozen[j] != step->freeze_after) {
+            if (p) p = skip_list(p, in_offsets[j + 1] - in_offsets[j]);
+        } else {
+            double sum = 0.0;
+            if (p) {
+                p = packed_sum(p, j, in_offsets[j + 1] - in_offsets[j], contrib, &sum);
+            } else {
+                for (size_t e = in_offsets[j]; e < in_offsets[j + 1]; ++e) {
+                    sum += contrib[in_sources[e]];
+                }
+            }
+            edges += in_offsets[j + 1] - in_offsets[j];
+            step->next[j] = step->base + step->damping * sum;
+            step->next_contrib[j] = step->next[j] * step->inv_degree[j];
+        }
+        step->frozen[j] = 0;
+        double diff = fabs(step->next[j] - step->current[j]);
+        residual_l1 += diff;
+        if (diff > residual_linf) residual_linf = diff;
+        if (step->inv_degree[j] == 0.0) dangling += step->next[j];
+    }
+    double *partials = step->partials + tid * PARTIAL_STRIDE;
+    partials[PARTIAL_DANGLING] = dangling;
+    partials[PARTIAL_L1] = residual_l1;
+    partials[PARTIAL_LINF] = residual_linf;
+    partials[PARTIAL_EDGES] = (double)edges;
+}
+
+// Quadratic extrapolation (Kamvar et al.) of the last four iterates x_k
+// (current), x_{k-1}, x_{k-2} and x_{k-3}: fits the error to the two
+// dominant non-principal eigenvectors by least squares and cancels them,
+// writing the estimate over current. Returns 0 (and leaves current alone)
+// if the fit is degenerate.
+static int quadratic_extrapolate(int n, double* current, const double* x1, const double* x2, const double* x3) {
+    // y_i = x_{k-i} - x_{k-3}; solve [y_2 y_1] g = -y_0 in the least squares sense
+    double a11 = 0.0, a12 = 0.0, a22 = 0.0, b1 = 0.0, b2 = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double y2 = x2[i] - x3[i], y1 = x1[i] - x3[i], y0 = current[i] - x3[i];
+        a11 += y2 * y2;
+        a12 += y2 * y1;
+        a22 += y1 * y1;
+        b1 -= y2 * y0;
+        b2 -= y1 * y0;
+    }
+    double det = a11 * a22 - a12 * a12;
+    if (!(fabs(det) > 1e-12 * a11 * a22)) {
+        return 0;
+    }
+    double g1 = (b1 * a22 - b2 * a12) / det;
+    double g2 = (a11 * b2 - a12 * b1) / det;
+    double beta0 = g1 + g2 + 1.0, beta1 = g2 + 1.0;
+
+    double total = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double value = beta0 * x2[i] + beta1 * x1[i] + current[i];
+        current[i] = value > 0.0 ? value : 0.0;
+        total += current[i];
+    }
+    for (int i = 0; i < n; ++i) {
+        current[i] /= total;
+    }
+    return 1;
+}
+
+// Split the nodes into num_threads ranges of about equal nodes + edges,
+// counting the edges of the given offsets (in_offsets or out_offsets)
+static void balance_ranges(const Graph* graph, const size_t* offsets, int num_threads, int* bounds) {
+    size_t total = graph->num_edges + graph->num_nodes;
+    bounds[0] = 0;
+    for (int t = 1; t < num_threads; t++) {
+        size_t target = range_start(total, t, num_threads);
+        int lo = bounds[t - 1], hi = graph->num_nodes;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (offsets[mid] + mid < target) lo = mid + 1; else hi = mid;
+        }
+        bounds[t] = lo;
+    }
+    bounds[num_threads] = graph->num_nodes;
+}
+
+static double sum_partials(const double* partials, int num_threads, int which) {
+    double sum = 0.0;
+    for (int t = 0; t < num_threads; t++) {
+        sum += partials[t * PARTIAL_STRIDE + which];
+    }
+    return sum;
+}
+
+// Propagation blocking (Beamer et al.) for the blocked solver: instead of
+// gathering contributions from all over the vector, an iteration first
+// streams over the out-edges in source order and appends each edge's
+// contribution to the bin of its target's partition, then applies the bins
+// one partition at a time. A partition spans 1 << shift nodes, so its link
+// sums stay in the L2 cache while everything else is read and written
+// sequentially. The bins are ordered by partition, then binning thread,
+// then source, so every node adds up its contributions in source order
+// whatever the number of threads. Targets never change and are stored once,
+// as offsets within their partition; only the values are rewritten.
+typedef struct PropagationBins {
+    const Graph *graph;
+    int shift;
+    int num_parts;
+    size_t *starts;         // bin of partition p and thread t starts at [p * T + t]
+    size_t *cursors;        // per thread: next free slot in each of its bins
+    uint16_t *targets;      // per binned edge: target - (p << shift)
+    double *values;         // per binned edge: contribution of its source
+    double *link_sums;      // per thread: link sums of one partition
+    int *source_bounds;     // thread t bins the out-edges of these sources
+    int *part_bounds;       // and applies these partitions
+} PropagationBins;
+
+// Nodes per partition of the blocked solver: 2^16 link sums take 512 KiB,
+// which leaves room in L2 for the streamed bins. Also the limit of the
+// 16-bit target offsets.
+#define PARTITION_BITS 16
+
+// Count the edges thread tid will put in each bin
+static void bins_count(void* arg, int tid, int num_threads) {
+    PropagationBins *bins = arg;
+    const Graph *graph = bins->graph;
+    size_t *counts = bins->starts + 1;
+    for (int i = bins->source_bounds[tid]; i < bins->source_bounds[tid + 1]; ++i) {
+        for (size_t e = graph->out_offsets[i]; e < graph->out_offsets[i + 1]; ++e) {
+            counts[(size_t)(graph->out_targets[e] >> bins->shift) * num_threads + tid]++;
+        }
+    }
+}
+
+// Reset the cursors of thread tid to the start of its bins
+static size_t* bins_rewind(PropagationBins* bins, int tid, int num_threads) {
+    size_t *cursor = bins->cursors + (size_t)tid * bins->num_parts;
+    for (int p = 0; p < bins->num_parts; p++) {
+        cursor[p] = bins->starts[(size_t)p * num_threads + tid];
+    }
+    return cursor;
+}
+
+static void bins_fill(void* arg, int tid, int num_threads) {
+    PropagationBins *bins = arg;
+    const Graph *graph = bins->graph;
+    const int mask = (1 << bins->shift) - 1;
+    size_t *cursor = bins_rewind(bins, tid, num_threads);
+    for (int i = bins->source_bounds[tid]; i < bins->source_bounds[tid + 1]; ++i) {
+        for (size_t e = graph->out_offsets[i]; e < graph->out_offsets[i + 1]; ++e) {
+            int target = graph->out_targets[e];
+            bins->targets[cursor[target >> bins->shift]++] = (uint16_t)(target & mask);
+        }
+    }
+}
+
+static void bins_free(PropagationBins* bins) {
+    if (!bins) {
+        return;
+    }
+    free(bins->starts);
+    free(bins->cursors);
+    free(bins->targets);
+    free(bins->values);
+    free(bins->link_sums);
+    free(bins->source_bounds);
+    free(bins->part_bounds);
+    free(bins);
+}
+
+static void release_bins(void* bins) {
+    bins_free(bins);
+}
+
+// Set up the bins for the pool's threads; bounds are the balanced node
+// ranges of the pull step
+static PropagationBins* bins_create(const Graph* graph, ThreadPool* pool, const int* bounds) {
+    const int n = graph->num_nodes, num_threads = pool_size(pool);
+    PropagationBins *bins = calloc(1, sizeof(PropagationBins));
+    if (!bins) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for propagation bins");
+    }
+    // Smaller partitions if there are not enough to keep every thread busy
+    bins->graph = graph;
+    bins->shift = PARTITION_BITS;
+    while (bins->shift > 8 && ((n - 1) >> bins->shift) + 1 < num_threads) bins->shift--;
+    bins->num_parts = ((n - 1) >> bins->shift) + 1;
+
+    const size_t num_bins = (size_t)bins->num_parts * num_threads;
+    bins->starts = calloc(num_bins + 1, sizeof(size_t));
+    bins->cursors = malloc(num_bins * sizeof(size_t));
+    bins->targets = malloc((graph->num_edges ? graph->num_edges : 1) * sizeof(uint16_t));
+    bins->values = malloc((graph->num_edges ? graph->num_edges : 1) * sizeof(double));
+    bins->link_sums = malloc(((size_t)num_threads << bins->shift) * sizeof(double));
+    bins->source_bounds = malloc((num_threads + 1) * sizeof(int));
+    bins->part_bounds = malloc((num_threads + 1) * sizeof(int));
+    if (!bins->starts || !bins->cursors || !bins->targets || !bins->values || !bins->link_sums
+        || !bins->source_bounds || !bins->part_bounds) {
+        bins_free(bins);
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for propagation bins");
+    }
+
+    // Binning is balanced by out-edges, applying by in-edges: thread t
+    // takes the partitions whose first node falls into its pull range
+    balance_ranges(graph, graph->out_offsets, num_threads, bins->source_bounds);
+    for (int t = 0; t <= num_threads; t++) {
+        int p = (int)(((size_t)bounds[t] + (1 << bins->shift) - 1) >> bins->shift);
+        bins->part_bounds[t] = t == num_threads ? bins->num_parts : p;
+    }
+
+    pool_run(pool, bins_count, bins);
+    for (size_t b = 0; b < num_bins; b++) {
+        bins->starts[b + 1] += bins->starts[b];
+    }
+    pool_run(pool, bins_fill, bins);
+    return bins;
+}
+
+// First phase of a blocked step: bin the current contributions
+static void blocked_bin(void* arg, int tid, int num_threads) {
+    PullStep *step = arg;
+    PropagationBins *bins = step->bins;
+    const size_t *out_offsets = step->graph->out_offsets;
+    const int *out_targets = step->graph->out_targets;
+    const double *contrib = step->contrib;
+    const int shift = bins->shift;
+    double *values = bins->values;
+    size_t *cursor = bins_rewind(bins, tid, num_threads);
+    for (int i = bins->source_bounds[tid]; i < bins->source_bounds[tid + 1]; ++i) {
+        double value = contrib[i];
+        for (size_t e = out_offsets[i]; e < out_offsets[i + 1]; ++e) {
+            values[cursor[out_targets[e] >> shift]++] = value;
+        }
+    }
+}
+
+// Second phase: add up the bins of each partition and finish its nodes
+// like pull_step()
+static void blocked_apply(void* arg, int tid, int num_threads) {
+    PullStep *step = arg;
+    PropagationBins *bins = step->bins;
+    const int n = step->graph->num_nodes;
+    const uint16_t *targets = bins->targets;
+    const double *values = bins->values;
+    double *link_sums = bins->link_sums + ((size_t)tid << bins->shift);
+    SweepSums sums = { 0.0, 0.0, 0.0 };
+
+    for (int p = bins->part_bounds[tid]; p < bins->part_bounds[tid + 1]; p++) {
+        int lo = p << bins->shift;
+        int hi = n - lo > (1 << bins->shift) ? lo + (1 << bins->shift) : n;
+        memset(link_sums, 0, (hi - lo) * sizeof(double));
+        size_t end = bins->starts[(size_t)(p + 1) * num_threads];
+        for (size_t k = bins->starts[(size_t)p * num_threads]; k < end; ++k) {
+            link_sums[targets[k]] += values[k];
+        }
+        rank_sweep(hi - lo, step->base, step->damping, link_sums, step->current + lo,
+                   step->inv_degree + lo, step->next + lo, step->next_contrib + lo, &sums);
+    }
+    double *partials = step->partials + tid * PARTIAL_STRIDE;
+    partials[PARTIAL_DANGLING] = sums.dangling;
+    partials[PARTIAL_L1] = sums.l1;
+    partials[PARTIAL_LINF] = sums.linf;
+}
+
+static void release_pool(void* pool) {
+    pool_destroy(pool);
+}
+
+// Jacobi power iteration, optionally with periodic extrapolation or
+// adaptive freezing of converged nodes
+static void jacobi_iterate(Graph* graph, const MarkovOptions* options, double* ranks, MarkovStats* stats) {
+    const int n = graph->num_nodes;
+    int num_threads = options->num_threads > 0 ? options->num_threads : 1;
+    if (num_threads > n) num_threads = n > 0 ? n : 1;
+
+    double *buffer = malloc(n * sizeof(double));
+    double *contrib = malloc(n * sizeof(double));
+    double *inv_degree = malloc(n * sizeof(double));
+    double *next_contrib = malloc(n * sizeof(double));
+    int *bounds = malloc((num_threads + 1) * sizeof(int));
+    double *partials = calloc((size_t)num_threads * PARTIAL_STRIDE, sizeof(double));
+    Guard guards[6];
+    guard_memory(guards, (void *[]){ buffer, contrib, inv_degree, next_contrib, bounds, partials }, 6);
+    if (!buffer || !contrib || !inv_degree || !next_contrib || !bounds || !partials) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->kernels = kernels_init();
+    double start = wall_time();
+
+    for (int i = 0; i < n; ++i) {
+        int degree = out_degree(graph, i);
+        inv_degree[i] = degree ? 1.0 / degree : 0.0;
+    }
+
+    ThreadPool *pool = pool_create(num_threads);
+    Guard pool_guard;
+    guard_push(&pool_guard, release_pool, pool);
+    balance_ranges(graph, graph->in_offsets, num_threads, bounds);
+
+    const int extrapolate = options->solver == SOLVER_EXTRAPOLATE;
+    const int interval = options->extrapolation_interval >= 4 ? options->extrapolation_interval
+                                                               : MARKOV_EXTRAPOLATION_INTERVAL;
+    // x_{k-2} and x_{k-3} for the extrapolation (x_{k-1} is still in next)
+    double *history = extrapolate ? malloc(2 * (size_t)n * sizeof(double)) : NULL;
+    unsigned char *frozen = options->solver == SOLVER_ADAPTIVE ? calloc(n, 1) : NULL;
+    double *frozen_sums = frozen ? malloc(n * sizeof(double)) : NULL;
+    Guard solver_guards[3];
+    guard_memory(solver_guards, (void *[]){ history, frozen, frozen_sums }, 3);
+    if ((extrapolate && !history) || (frozen && !frozen_sums)) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+    PropagationBins *bins = options->solver == SOLVER_BLOCKED ? bins_create(graph, pool, bounds) : NULL;
+    Guard bins_guard;
+    guard_push(&bins_guard, release_bins, bins);
+
+    double *current = ranks, *next = buffer;
+    PullStep step = {
+        .graph = graph,
+        .inv_degree = inv_degree,
+        .damping = 1.0 - options->teleport_prob,
+        .current = current,
+        .next_contrib = contrib,
+        .bounds = bounds,
+        .partials = partials,
+        .frozen = frozen,
+        .frozen_sums = frozen_sums,
+        .freeze_tolerance = options->tolerance,
+        .freeze_after = FREEZE_AFTER,
+        .bins = bins,
+    };
+    pool_run(pool, pull_init, &step);
+    double dangle_sum = sum_partials(partials, num_threads, PARTIAL_DANGLING);
+
+    // --- Run N iterations ---
+    for (int k = 0; k < options->max_iterations; ++k) {
+        double iteration_start = options->iteration_seconds ? wall_time() : 0.0;
+        // Teleport probability and the (1-p) share of the dangling
+        // probability are distributed uniformly
+        step.base = (options->teleport_prob + step.damping * dangle_sum) / n;
+        step.current = current;
+        step.next = next;
+        step.contrib = contrib;
+        step.next_contrib = next_contrib;
+        if (bins) {
+            pool_run(pool, blocked_bin, &step);
+            pool_run(pool, blocked_apply, &step);
+        } else {
+            pool_run(pool, frozen ? pull_step_adaptive : graph->packed_sources ? pull_step_packed : pull_step, &step);
+        }
+        stats->edge_sweeps += frozen && graph->num_edges
+            ? sum_partials(partials, num_threads, PARTIAL_EDGES) / graph->num_edges : 1.0;
+        // The adaptive solver converged on its frozen approximation; the
+        // true residual decides
+        if (frozen && options->tolerance > 0 && sum_partials(partials, num_threads, PARTIAL_FROZEN) > 0 &&
+            sum_partials(partials, num_threads, PARTIAL_L1) < options->tolerance) {
+            pool_run(pool, pull_step_thaw, &step);
+            if (graph->num_edges) {
+                stats->edge_sweeps += sum_partials(partials, num_threads, PARTIAL_EDGES) / graph->num_edges;
+            }
+            if (sum_partials(partials, num_threads, PARTIAL_L1) >= options->tolerance &&
+                step.freeze_after < FREEZE_AFTER_MAX) {
+                step.freeze_after *= 2;
+            }
+        }
+
+        dangle_sum = sum_partials(partials, num_threads, PARTIAL_DANGLING);
+        double residual_l1 = sum_partials(partials, num_threads, PARTIAL_L1);
+        double residual_linf = 0.0;
+        for (int t = 0; t < num_threads; t++) {
+            double linf = partials[t * PARTIAL_STRIDE + PARTIAL_LINF];
+            if (linf > residual_linf) residual_linf = linf;
+        }
+
+        // Swap buffers for the next iteration
+        double *tmp = current; current = next; next = tmp;
+        tmp = contrib; contrib = next_contrib; next_contrib = tmp;
+        if (options->iteration_seconds) {
+            options->iteration_seconds[k] = wall_time() - iteration_start;
+        }
+
+        stats->iterations = k + 1;
+        stats->residual_l1 = residual_l1;
+        stats->residual_linf = residual_linf;
+        if (options->tolerance > 0 && residual_l1 < options->tolerance) {
+            stats->converged = 1;
+            break;
+        }
+
+        if (extrapolate) {
+            // current holds x_{k+1}, next x_k; keep the two iterates before
+            int phase = (k + 1) % interval;
+            if (phase == interval - 2) {
+                memcpy(history + n, next, n * sizeof(double));
+            } else if (phase == interval - 1) {
+                memcpy(history, next, n * sizeof(double));
+            } else if (phase == 0 && quadratic_extrapolate(n, current, next, history, history + n)) {
+                step.current = current;
+                step.next_contrib = contrib;
+                pool_run(pool, pull_init, &step);
+                dangle_sum = sum_partials(partials, num_threads, PARTIAL_DANGLING);
+            }
+        }
+    } // End of iterations loop
+
+    if (current != ranks) {
+        memcpy(ranks, current, n * sizeof(double));
+    }
+
+    guard_pop(&bins_guard);
+    guard_pop_memory(solver_guards, 3);
+    guard_pop(&pool_guard);
+    guard_pop_memory(guards, 6);
+    pool_destroy(pool);
+    stats->seconds = wall_time() - start;
+    free(ranks == current ? next : current);
+    free(contrib);
+    free(next_contrib);
+    free(inv_degree);
+    free(bounds);
+    free(partials);
+    free(history);
+    free(frozen);
+    free(frozen_sums);
+    bins_free(bins);
+}
+
+// Gauss-Seidel iteration: each node is updated in place from the newest
+// ranks of its predecessors, so information travels along several edges per
+// sweep. The uniform share is taken from the dangling mass at the start of
+// the sweep and the vector is renormalized after it. Inherently sequential,
+// so it always runs on one thread.
+static void gauss_seidel_iterate(Graph* graph, const MarkovOptions* options, double* ranks, MarkovStats* stats) {
+    const int n = graph->num_nodes;
+    const double damping = 1.0 - options->teleport_prob;
+    double *contrib = malloc(n * sizeof(double));
+    double *inv_degree = malloc(n * sizeof(double));
+    if (!contrib || !inv_degree) {
+        free(contrib);
+        free(inv_degree);
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->kernels = kernels_init();
+    double start = wall_time();
+
+    for (int i = 0; i < n; ++i) {
+        int degree = out_degree(graph, i);
+        inv_degree[i] = degree ? 1.0 / degree : 0.0;
+    }
+    double dangle_sum = rank_scale(n, ranks, inv_degree, contrib);
+
+    for (int k = 0; k < options->max_iterations; ++k) {
+        double iteration_start = options->iteration_seconds ? wall_time() : 0.0;
+        double base = (options->teleport_prob + damping * dangle_sum) / n;
+        double residual_l1 = 0.0, residual_linf = 0.0, total = 0.0;
+        const unsigned char *p = graph->packed_sources;
+        for (int j = 0; j < n; ++j) {
+            double sum = 0.0;
+            if (p) {
+                p = packed_sum(p, j, in_degree(graph, j), contrib, &sum);
+            } else {
+                for (size_t e = graph->in_offsets[j]; e < graph->in_offsets[j + 1]; ++e) {
+                    sum += contrib[graph->in_sources[e]];
+                }
+            }
+            double value = base + damping * sum;
+            double diff = fabs(value - ranks[j]);
+            residual_l1 += diff;
+            if (diff > residual_linf) residual_linf = diff;
+            ranks[j] = value;
+            contrib[j] = value * inv_degree[j];
+            total += value;
+        }
+        for (int j = 0; j < n; ++j) {
+            ranks[j] /= total;
+        }
+        dangle_sum = rank_scale(n, ranks, inv_degree, contrib);
+        if (options->iteration_seconds) {
+            options->iteration_seconds[k] = wall_time() - iteration_start;
+        }
+
+        stats->iterations = k + 1;
+        stats->edge_sweeps += 1.0;
+        stats->residual_l1 = residual_l1;
+        stats->residual_linf = residual_linf;
+        if (options->tolerance > 0 && residual_l1 < options->tolerance) {
+            stats->converged = 1;
+            break;
+        }
+    }
+
+    stats->seconds = wall_time() - start;
+    free(contrib);
+    free(inv_degree);
+}
+
+void markov_iterate(Graph* graph, const MarkovOptions* options, double* ranks, MarkovStats* stats) {
+    if (options->solver == SOLVER_GAUSS_SEIDEL) {
+        gauss_seidel_iterate(graph, options, ranks, stats);
+    } else {
+        jacobi_iterate(graph, options, ranks, stats);
+    }
+    stats->solver = options->solver;
+}
+
+// Work cap of the local phase of markov_iterate_local(), in sweeps over
+// all edges; past it a change is no longer local and full sweeps are cheaper
+#define LOCAL_SWEEP_BUDGET 4
+// Target of the local phase when no tolerance is set
+#define LOCAL_TOLERANCE 1e-9
+// Factor by which the push threshold of the local phase shrinks
+#define EPSILON_STEP 8
+
+void markov_iterate_local(Graph* graph, const MarkovOptions* options, const int* active,
+                          size_t num_active, double* ranks, MarkovStats* stats) {
+    const int n = graph->num_nodes;
+    const double damping = 1.0 - options->teleport_prob;
+    const double target = options->tolerance > 0 ? options->tolerance : LOCAL_TOLERANCE;
+    // Nodes are queued while their residual exceeds epsilon. It starts
+    // coarse and shrinks whenever the queue runs dry before the residual
+    // meets the target, down to a floor at which the queue can only run dry
+    // once it does.
+    const double floor_epsilon = target / (2.0 * n);
+    double epsilon = target / 2.0;
+    double *residual = malloc(n * sizeof(double));
+    double *inv_degree = malloc(n * sizeof(double));
+    int *queue = malloc(n * sizeof(int));
+    unsigned char *queued = calloc(n, 1);
+    double *sums = malloc((num_active ? num_active : 1) * sizeof(double));
+    if (!residual || !inv_degree || !queue || !queued || !sums) {
+        free(residual);
+        free(inv_degree);
+        free(queue);
+        free(queued);
+        free(sums);
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+    double start = wall_time();
+
+    double dangle_sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        int degree = out_degree(graph, i);
+        inv_degree[i] = degree ? 1.0 / degree : 0.0;
+        if (!degree) dangle_sum += ranks[i];
+    }
+    const double base = (options->teleport_prob + damping * dangle_sum) / n;
+
+    // Local phase: push the residuals r = (one Jacobi step of x) - x. The
+    // start ranks met the tolerance before the change, so only the active
+    // nodes have residuals worth computing. Pushing r_u adds it to x_u and
+    // d r_u / deg(u) to the residual of each successor; for a dangling u it
+    // moves the uniform share of every node, which is kept as one pending
+    // shift and applied once the queue runs dry.
+    // residual holds the contributions until the link sums are gathered
+    for (int i = 0; i < n; ++i) {
+        residual[i] = ranks[i] * inv_degree[i];
+    }
+    size_t head = 0, count = 0, edges = 0;
+    int max_sweeps = options->max_iterations < LOCAL_SWEEP_BUDGET ? options->max_iterations : LOCAL_SWEEP_BUDGET;
+    const size_t budget = (size_t)max_sweeps * (graph->num_edges + n);
+    for (size_t a = 0; a < num_active; a++) {
+        int u = active[a];
+        if (graph->packed_sources) {
+            packed_sum(packed_list(graph, u), u, in_degree(graph, u), residual, &sums[a]);
+        } else {
+            sums[a] = 0.0;
+            for (size_t e = graph->in_offsets[u]; e < graph->in_offsets[u + 1]; ++e) {
+                sums[a] += residual[graph->in_sources[e]];
+            }
+        }
+        edges += in_degree(graph, u) + 1;
+    }
+    memset(residual, 0, n * sizeof(double));
+    for (size_t a = 0; a < num_active; a++) {
+        int u = active[a];
+        residual[u] = base + damping * sums[a] - ranks[u];
+        if (fabs(residual[u]) > epsilon && !queued[u]) {
+            queued[u] = 1;
+            queue[(head + count++) % n] = u;
+        }
+    }
+    free(sums);
+
+    double shift = 0.0, residual_l1 = 0.0, residual_linf = 0.0;
+    int settled = 0;
+    for (;;) {
+        while (count > 0 && edges < budget) {
+            int u = queue[head];
+            head = (head + 1) % n;
+            count--;
+            queued[u] = 0;
+
+            double push = residual[u] + shift;
+            ranks[u] += push;
+            residual[u] = -shift;
+            edges += graph->out_offsets[u + 1] - graph->out_offsets[u] + 1;
+            if (inv_degree[u] == 0.0) {
+                shift += damping * push / n;
+                continue;
+            }
+            double share = damping * push * inv_degree[u];
+            for (size_t e = graph->out_offsets[u]; e < graph->out_offsets[u + 1]; ++e) {
+                int w = graph->out_targets[e];
+                residual[w] += share;
+                if (!queued[w] && fabs(residual[w] + shift) > epsilon) {
+                    queued[w] = 1;
+                    queue[(head + count++) % n] = w;
+                }
+            }
+        }
+        if (count > 0) {
+            break;
+        }
+        // Apply the pending shift; this also gives the exact residual
+        residual_l1 = residual_linf = 0.0;
+        for (int j = 0; j < n; ++j) {
+            residual[j] += shift;
+            double r = fabs(residual[j]);
+            residual_l1 += r;
+            if (r > residual_linf) residual_linf = r;
+        }
+        shift = 0.0;
+        edges += n;
+        settled = residual_l1 < target;
+        if (settled || edges >= budget) {
+            break;
+        }
+        epsilon = epsilon / EPSILON_STEP > floor_epsilon ? epsilon / EPSILON_STEP : floor_epsilon;
+        for (int j = 0; j < n; ++j) {
+            if (fabs(residual[j]) > epsilon) {
+                queued[j] = 1;
+                queue[(head + count++) % n] = j;
+            }
+        }
+        edges += n;
+    }
+    free(residual);
+    free(inv_degree);
+    free(queue);
+    free(queued);
+    const double local_sweeps = (double)edges / (graph->num_edges + n);
+
+    if (settled) {
+        memset(stats, 0, sizeof(*stats));
+        stats->kernels = kernels_init();
+        stats->solver = options->solver;
+        stats->converged = options->tolerance > 0;
+        stats->residual_l1 = residual_l1;
+        stats->residual_linf = residual_linf;
+    } else {
+        // Global phase: the change reached too much of the graph. Full
+        // sweeps finish it within what is left of max_iterations.
+        double total = 0.0;
+        for (int i = 0; i < n; ++i) {
+            total += ranks[i];
+        }
+        for (int i = 0; i < n; ++i) {
+            ranks[i] /= total;
+        }
+        MarkovOptions global = *options;
+        const size_t sweep = graph->num_edges + n;
+        global.max_iterations -= (int)((edges + sweep - 1) / sweep);
+        if (global.max_iterations < 0) global.max_iterations = 0;
+        markov_iterate(graph, &global, ranks, stats);
+    }
+    stats->edge_sweeps += local_sweeps;
+    stats->seconds = wall_time() - start;
+}
+
+// Shared state of one iteration of the block (personalized) chain: K rank
+// vectors stored node-major, so the in-edges of a node are read once and
+// feed all K sums
+typedef struct {
+    const Graph *graph;
+    const double *inv_degree;
+    const double *damping;      // per vector: 1 - p
+    int num_vectors;
+    const double *teleport;     // V x K teleport distributions, NULL for uniform
+    const double *base;         // per vector: p + (1-p) * dangling mass (/ n if uniform)
+    const double *current;
+    double *next;
+    const double *contrib;
+    double *next_contrib;
+    int *bounds;
+    double *scratch;            // per thread: K link sums
+    int *lists;                 // per thread: a decoded list of a packed graph
+    size_t list_stride;
+    double *partials;           // per thread: K dangling sums, K L1 residuals, Linf
+    size_t partial_stride;
+} BlockStep;
+
+static void block_init(void* arg, int tid, int num_threads) {
+    BlockStep *step = arg;
+    const int K = step->num_vectors;
+    double *dangling = step->partials + tid * step->partial_stride;
+    memset(dangling, 0, K * sizeof(double));
+    for (int j = step->bounds[tid]; j < step->bounds[tid + 1]; ++j) {
+        for (int k = 0; k < K; ++k) {
+            double value = step->current[(size_t)j * K + k];
+            step->next_contrib[(size_t)j * K + k] = value * step->inv_degree[j];
+            if (step->inv_degree[j] == 0.0) dangling[k] += value;
+        }
+    }
+}
+
+// sums[l] = sum of contrib[source * K + l] over the in-edges begin..end,
+// for l < lanes; inlined with a constant lanes
+static inline void gather_lanes(const int* sources, size_t begin, size_t end, const double* contrib,
+                                int K, int lanes, double* sums) {
+    double acc[8] = {0};
+    for (size_t e = begin; e < end; ++e) {
+        const double *row = contrib + (size_t)sources[e] * K;
+        for (int l = 0; l < lanes; ++l) {
+            acc[l] += row[l];
+        }
+    }
+    memcpy(sums, acc, lanes * sizeof(double));
+}
+
+static void block_step(void* arg, int tid, int num_threads) {
+    BlockStep *step = arg;
+    const Graph *graph = step->graph;
+    const int K = step->num_vectors;
+    double *sums = step->scratch + (size_t)tid * K;
+    double *dangling = step->partials + tid * step->partial_stride;
+    double *residual_l1 = dangling + K;
+    double residual_linf = 0.0;
+    memset(dangling, 0, 2 * K * sizeof(double));
+    // A packed list is decoded once for all chunks of vectors
+    const unsigned char *p = graph->packed_sources ? packed_list(graph, step->bounds[tid]) : NULL;
+    int *list = step->lists + tid * step->list_stride;
+
+    for (int j = step->bounds[tid]; j < step->bounds[tid + 1]; ++j) {
+        // Sum the in-edges in chunks of 8 and 4 vectors whose sums stay in
+        // registers; a plain loop over all K keeps them in memory instead
+        const int *sources = graph->in_sources;
+        size_t begin = graph->in_offsets[j], end = graph->in_offsets[j + 1];
+        if (p) {
+            p = read_list(p, j, end - begin, list);
+            sources = list;
+            end -= begin;
+            begin = 0;
+        }
+        int k = 0;
+        for (; k + 8 <= K; k += 8) {
+            gather_lanes(sources, begin, end, step->contrib + k, K, 8, sums + k);
+        }
+        for (; k + 4 <= K; k += 4) {
+            gather_lanes(sources, begin, end, step->contrib + k, K, 4, sums + k);
+        }
+        for (; k < K; ++k) {
+            gather_lanes(sources, begin, end, step->contrib + k, K, 1, sums + k);
+        }
+        const size_t row = (size_t)j * K;
+        const double *teleport = step->teleport ? step->teleport + row : NULL;
+        for (int k = 0; k < K; ++k) {
+            double share = teleport ? step->base[k] * teleport[k] : step->base[k];
+            double value = share + step->damping[k] * sums[k];
+            double diff = fabs(value - step->current[row + k]);
+            residual_l1[k] += diff;
+            if (diff > residual_linf) residual_linf = diff;
+            if (step->inv_degree[j] == 0.0) dangling[k] += value;
+            step->next[row + k] = value;
+            step->next_contrib[row + k] = value * step->inv_degree[j];
+        }
+    }
+    dangling[2 * K] = residual_linf;
+}
+
+void markov_iterate_block(Graph* graph, const MarkovOptions* options, const double* teleport,
+                          const double* teleport_probs, int num_vectors, double* ranks,
+                          MarkovStats* stats) {
+    const int n = graph->num_nodes, K = num_vectors;
+    const size_t size = (size_t)n * K;
+    int num_threads = options->num_threads > 0 ? options->num_threads : 1;
+    if (num_threads > n) num_threads = n > 0 ? n : 1;
+    // Round up to whole cache lines to avoid false sharing
+    const size_t partial_stride = (2 * K + 1 + PARTIAL_STRIDE - 1) / PARTIAL_STRIDE * PARTIAL_STRIDE;
+
+    double *buffer = malloc(size * sizeof(double));
+    double *contrib = malloc(size * sizeof(double));
+    double *next_contrib = malloc(size * sizeof(double));
+    double *inv_degree = malloc(n * sizeof(double));
+    double *base = malloc(K * sizeof(double));
+    double *damping = malloc(K * sizeof(double));
+    double *scratch = malloc((size_t)num_threads * K * sizeof(double));
+    int *bounds = malloc((num_threads + 1) * sizeof(int));
+    double *partials = calloc(num_threads * partial_stride, sizeof(double));
+    size_t list_stride = 0;
+    for (int j = 0; graph->packed_sources && j < n; ++j) {
+        if ((size_t)in_degree(graph, j) > list_stride) list_stride = in_degree(graph, j);
+    }
+    int *lists = malloc((num_threads * list_stride + 1) * sizeof(int));
+    Guard guards[10];
+    guard_memory(guards, (void *[]){ buffer, contrib, next_contrib, inv_degree, base, damping, scratch, bounds, partials, lists }, 10);
+    if (!buffer || !contrib || !next_contrib || !inv_degree || !base || !damping || !scratch || !bounds || !partials || !lists) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->solver = SOLVER_JACOBI;
+    stats->kernels = "scalar";
+    double start = wall_time();
+
+    for (int i = 0; i < n; ++i) {
+        int degree = out_degree(graph, i);
+        inv_degree[i] = degree ? 1.0 / degree : 0.0;
+    }
+
+    for (int q = 0; q < K; q++) {
+        damping[q] = 1.0 - (teleport_probs ? teleport_probs[q] : options->teleport_prob);
+    }
+
+    ThreadPool *pool = pool_create(num_threads);
+    Guard pool_guard;
+    guard_push(&pool_guard, release_pool, pool);
+    balance_ranges(graph, graph->in_offsets, num_threads, bounds);
+
+    double *current = ranks, *next = buffer;
+    BlockStep step = {
+        .graph = graph,
+        .inv_degree = inv_degree,
+        .damping = damping,
+        .num_vectors = K,
+        .teleport = teleport,
+        .base = base,
+        .current = current,
+        .next_contrib = contrib,
+        .bounds = bounds,
+        .scratch = scratch,
+        .lists = lists,
+        .list_stride = list_stride,
+        .partials = partials,
+        .partial_stride = partial_stride,
+    };
+    pool_run(pool, block_init, &step);
+
+    for (int k = 0; k < options->max_iterations; ++k) {
+        double iteration_start = options->iteration_seconds ? wall_time() : 0.0;
+        // Teleport probability and the (1-p) share of the dangling
+        // probability follow each vector's teleport distribution
+        for (int q = 0; q < K; q++) {
+            double dangle_sum = 0.0;
+            for (int t = 0; t < num_threads; t++) {
+                dangle_sum += partials[t * partial_stride + q];
+            }
+            base[q] = 1.0 - damping[q] + damping[q] * dangle_sum;
+            if (!teleport) base[q] /= n;
+        }
+        step.current = current;
+        step.next = next;
+        step.contrib = contrib;
+        step.next_contrib = next_contrib;
+        pool_run(pool, block_step, &step);
+        stats->edge_sweeps += 1.0;
+
+        // The block has converged when its slowest vector has
+        double residual_l1 = 0.0, residual_linf = 0.0;
+        for (int q = 0; q < K; q++) {
+            double l1 = 0.0;
+            for (int t = 0; t < num_threads; t++) {
+                l1 += partials[t * partial_stride + K + q];
+            }
+            if (l1 > residual_l1) residual_l1 = l1;
+        }
+        for (int t = 0; t < num_threads; t++) {
+            double linf = partials[t * partial_stride + 2 * K];
+            if (linf > residual_linf) residual_linf = linf;
+        }
+
+        double *tmp = current; current = next; next = tmp;
+        tmp = contrib; contrib = next_contrib; next_contrib = tmp;
+        if (options->iteration_seconds) {
+            options->iteration_seconds[k] = wall_time() - iteration_start;
+        }
+
+        stats->iterations = k + 1;
+        stats->residual_l1 = residual_l1;
+        stats->residual_linf = residual_linf;
+        if (options->tolerance > 0 && residual_l1 < options->tolerance) {
+            stats->converged = 1;
+            break;
+        }
+    }
+
+    if (current != ranks) {
+        memcpy(ranks, current, size * sizeof(double));
+    }
+
+    guard_pop(&pool_guard);
+    guard_pop_memory(guards, 10);
+    pool_destroy(pool);
+    stats->seconds = wall_time() - start;
+    free(ranks == current ? next : current);
+    free(contrib);
+    free(next_contrib);
+    free(inv_degree);
+    free(base);
+    free(damping);
+    free(scratch);
+    free(bounds);
+    free(partials);
+    free(lists);
+}
+
+double* simulate_teleport_sweep(Graph* graph, const MarkovOptions* options,
+                                const double* teleport_probs, int num_probs, MarkovStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (graph->num_nodes == 0) {
+        return NULL;
+    }
+
+    const size_t size = (size_t)graph->num_nodes * num_probs;
+    double *ranks = malloc(size * sizeof(double));
+    if (!ranks) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+    double initial_prob = 1.0 / graph->num_nodes;
+    for (size_t i = 0; i < size; ++i) {
+        ranks[i] = initial_prob;
+    }
+
+    Guard guard;
+    guard_push(&guard, free, ranks);
+    markov_iterate_block(graph, options, NULL, teleport_probs, num_probs, ranks, stats);
+    guard_pop(&guard);
+    return ranks;
+}
+
+// --- Markov Chain Simulation ---
+double* simulate_markov_chain(Graph* graph, const MarkovOptions* options, MarkovStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (graph->num_nodes == 0) {
+        return NULL;
+    }
+
+    double *ranks = malloc(graph->num_nodes * sizeof(double));
+    if (!ranks) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+
+    // Initialize with uniform probability
+    double initial_prob = 1.0 / graph->num_nodes;
+    for (int i = 0; i < graph->num_nodes; ++i) {
+        ranks[i] = initial_prob;
+    }
+
+    Guard guard;
+    guard_push(&guard, free, ranks);
+    markov_iterate(graph, options, ranks, stats);
+    guard_pop(&guard);
+    return ranks;
+}
+
+static const char* const solver_names[] = {
+    [SOLVER_JACOBI] = "jacobi",
+    [SOLVER_GAUSS_SEIDEL] = "gauss-seidel",
+    [SOLVER_EXTRAPOLATE] = "extrapolate",
+    [SOLVER_ADAPTIVE] = "adaptive",
+    [SOLVER_BLOCKED] = "blocked",
+};
+
+int parse_markov_solver(const char* name, MarkovSolver* solver) {
+    for (int s = 0; s < NUM_SOLVERS; s++) {
+        if (strcmp(name, solver_names[s]) == 0) {
+            *solver = (MarkovSolver)s;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Run every solver from the uniform distribution and report them side by
+// side; returns the ranks of the Jacobi baseline
+double* compare_markov_solvers(Graph* graph, const MarkovOptions* options, FILE* file) {
+    if (graph->num_nodes == 0) {
+        return NULL;
+    }
+    double *ranks = malloc(graph->num_nodes * sizeof(double));
+    double *baseline = malloc(graph->num_nodes * sizeof(double));
+    Guard guards[2];
+    guard_memory(guards, (void *[]){ ranks, baseline }, 2);
+    if (!ranks || !baseline) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+
+    double baseline_seconds = 0.0;
+    for (int s = 0; s < NUM_SOLVERS; s++) {
+        MarkovOptions solver_options = *options;
+        solver_options.solver = (MarkovSolver)s;
+        MarkovStats stats;
+        for (int i = 0; i < graph->num_nodes; ++i) {
+            ranks[i] = 1.0 / graph->num_nodes;
+        }
+        markov_iterate(graph, &solver_options, ranks, &stats);
+
+        double max_diff = 0.0;
+        if (s == SOLVER_JACOBI) {
+            memcpy(baseline, ranks, graph->num_nodes * sizeof(double));
+            baseline_seconds = stats.seconds;
+        } else {
+            for (int i = 0; i < graph->num_nodes; ++i) {
+                double diff = fabs(ranks[i] - baseline[i]);
+                if (diff > max_diff) max_diff = diff;
+            }
+        }
+        if (file) {
+            fprintf(file, "%-13s %6d iterations %8.2f edge sweeps %s %9.3f s (%.2fx)  max diff to jacobi %.2e\n",
+                    solver_names[s], stats.iterations, stats.edge_sweeps,
+                    stats.converged ? "converged    " : "not converged", stats.seconds,
+                    stats.seconds > 0 ? baseline_seconds / stats.seconds : 0.0, max_diff);
+        }
+    }
+
+    guard_pop_memory(guards, 2);
+    free(ranks);
+    return baseline;
+}
+
+void print_markov_stats(FILE* file, const MarkovStats* stats) {
+    fprintf(file, "Markov chain (%s solver, %s kernels): %d iterations (%.2f edge sweeps)%s, residual L1 %.3e Linf %.3e, %.3f s (%.4g ms/iteration)\n",
+            solver_names[stats->solver], stats->kernels ? stats->kernels : "no",
+            stats->iterations, stats->edge_sweeps, stats->converged ? " (converged)" : "",
+            stats->residual_l1, stats->residual_linf, stats->seconds,
+            stats->iterations ? 1e3 * stats->seconds / stats->iterations : 0.0);
+}
@@ -0,0 +1,92 @@
+#ifndef _INC_MARKOV_H
+#define _INC_MARKOV_H
+
+#include "graph.h"
+
+// Iteration cap for -m auto
+#define MARKOV_AUTO_MAX_ITERATIONS 10000
+
+// Default number of iterations between two extrapolation steps
+#define MARKOV_EXTRAPOLATION_INTERVAL 10
+
+typedef enum {
+    SOLVER_JACOBI,          // plain power iteration
+    SOLVER_GAUSS_SEIDEL,    // in-place updates, single-threaded
+    SOLVER_EXTRAPOLATE,     // power iteration with periodic quadratic extrapolation
+    SOLVER_ADAPTIVE,        // power iteration that freezes converged nodes
+    SOLVER_BLOCKED,         // power iteration with cache-blocked propagation
+    NUM_SOLVERS
+} MarkovSolver;
+
+typedef struct {
+    double teleport_prob;
+    int max_iterations;
+    // Stop as soon as the L1 residual between two iterates drops below this;
+    // 0 runs exactly max_iterations
+    double tolerance;
+    int num_threads;
+    MarkovSolver solver;
+    int extrapolation_interval;     // 0 for MARKOV_EXTRAPOLATION_INTERVAL
+    // If not NULL, receives the wall time of each iteration (room for
+    // max_iterations entries; stats->iterations are written)
+    double *iteration_seconds;
+} MarkovOptions;
+
+typedef struct {
+    MarkovSolver solver;
+    int iterations;
+    double edge_sweeps;     // edges read, in units of num_edges
+    int converged;
+    double residual_l1;     // ||x_k - x_{k-1}||_1 of the last iteration
+    double residual_linf;   // ||x_k - x_{k-1}||_inf of the last iteration
+    double seconds;
+    const char *kernels;    // vector kernel set used, see kernels_init()
+} MarkovStats;
+
+// Iterate the PageRank Markov chain with the selected solver, starting from
+// (and overwriting) ranks. The Jacobi-based solvers use a pull formulation
+// over the in-edges (CSC) that runs on num_threads threads without atomics.
+void markov_iterate(Graph* graph, const MarkovOptions* options, double* ranks, MarkovStats* stats);
+
+// Re-converge ranks after a local change of the graph, starting from the
+// ranks converged before it: push the residuals of the active nodes (whose
+// in-edges or predecessors' degrees changed) out along the out-edges until
+// the residual of the whole vector meets the tolerance. If that takes
+// more than a few sweeps' worth of edges, markov_iterate() finishes with
+// what is left of max_iterations. edge_sweeps in stats counts both phases;
+// iterations only the full sweeps.
+void markov_iterate_local(Graph* graph, const MarkovOptions* options, const int* active,
+                          size_t num_active, double* ranks, MarkovStats* stats);
+
+// PageRank for num_vectors chains at once. teleport and ranks are
+// node-major V x K blocks (entry [i * K + k] belongs to node i and vector
+// k); every column of teleport sums to 1. Vector k teleports, and leaves
+// dangling nodes, according to column k, or uniformly if teleport is NULL,
+// with probability teleport_probs[k] (options->teleport_prob for all if
+// NULL). Each sweep over the in-edges updates all K vectors. ranks holds
+// the start vectors and receives the result; the iteration stops once
+// every vector meets the tolerance.
+void markov_iterate_block(Graph* graph, const MarkovOptions* options, const double* teleport,
+                          const double* teleport_probs, int num_vectors, double* ranks,
+                          MarkovStats* stats);
+
+// Run markov_iterate() from the uniform distribution. Returns the ranks
+// (malloc'ed; NULL for an empty graph).
+double* simulate_markov_chain(Graph* graph, const MarkovOptions* options, MarkovStats* stats);
+
+// Global PageRank for each of num_probs teleport probabilities in one
+// markov_iterate_block() run from the uniform distribution. Returns the
+// node-major V x num_probs rank block (malloc'ed; NULL for an empty graph).
+double* simulate_teleport_sweep(Graph* graph, const MarkovOptions* options,
+                                const double* teleport_probs, int num_probs, MarkovStats* stats);
+
+// Run every solver and print a comparison table to file (if not NULL);
+// returns the ranks of the Jacobi baseline like simulate_markov_chain()
+double* compare_markov_solvers(Graph* graph, const MarkovOptions* options, FILE* file);
+
+// Map a solver name as given on the command line; returns 0 if unknown
+int parse_markov_solver(const char* name, MarkovSolver* solver);
+
+void print_markov_stats(FILE* file, const MarkovStats* stats);
+
+#endif /* !_INC_MARKOV_H */
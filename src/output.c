@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include "output.h"
+#include "error.h"
+
+
+void output_init(OutputBuffer* out, FILE* file) {
+    out->file = file;
+    out->used = 0;
+    out->data = malloc(OUTPUT_BUFFER_SIZE);
+    if (!out->data) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for the output buffer");
+    }
+    guard_push(&out->guard, free, out->data);
+}
+
+void output_flush(OutputBuffer* out) {
+    if (out->used > 0 && fwrite(out->data, 1, out->used, out->file) != out->used) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not write output");
+    }
+    out->used = 0;
+}
+
+void output_free(OutputBuffer* out) {
+    output_flush(out);
+    guard_pop(&out->guard);
+    free(out->data);
+    out->data = NULL;
+}
+
+static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+void output_double(OutputBuffer* out, double value, int decimals) {
+    output_reserve(out, OUTPUT_NUMBER_MAX);
+    char *p = out->data + out->used;
+
+    if (decimals >= 0) {
+        // Round the scaled value to an integer and print its digits. The
+        // product is off from the exact one by at most half an ulp (< 1e-6
+        // below 2^32), which only matters close to a rounding tie; those
+        // cases, and everything else out of range, are left to snprintf.
+        double scaled = value * powers_of_ten[decimals];
+        double whole = floor(scaled), frac = scaled - whole;
+        if (value >= 0.0 && scaled < 4294967296.0 && fabs(frac - 0.5) > 1e-5) {
+            uint64_t q = (uint64_t)whole + (frac > 0.5);
+            uint64_t unit = (uint64_t)powers_of_ten[decimals];
+            uint64_t integer = q / unit, fraction = q % unit;
+            char digits[24];
+            int n = 0;
+            do {
+                digits[n++] = (char)('0' + integer % 10);
+                integer /= 10;
+            } while (integer);
+            while (n) *p++ = digits[--n];
+            if (decimals > 0) {
+                *p++ = '.';
+                for (int i = decimals - 1; i >= 0; --i) {
+                    p[i] = (char)('0' + fraction % 10);
+                    fraction /= 10;
+                }
+                p += decimals;
+            }
+            out->used = p - out->data;
+            return;
+        }
+        int len = snprintf(p, OUTPUT_NUMBER_MAX, "%.*f", decimals, value);
+        if (len < OUTPUT_NUMBER_MAX) {
+            out->used += len;
+        } else {
+            // Too long for the reserved room (huge values)
+            output_flush(out);
+            fprintf(out->file, "%.*f", decimals, value);
+        }
+        return;
+    }
+    out->used += snprintf(p, OUTPUT_NUMBER_MAX, "%.17g", value);
+}
@@ -0,0 +1,57 @@
+#ifndef _INC_OUTPUT_H
+#define _INC_OUTPUT_H
+
+#include <stdio.h>
+#include <string.h>
+#include "error.h"
+
+// Size of the buffer of an OutputBuffer; large enough that every flush is
+// a single big write
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+// Room for the longest number output_double() writes
+#define OUTPUT_NUMBER_MAX 32
+
+// Buffered writer that formats rank output itself instead of going
+// through printf for every field
+typedef struct {
+    FILE *file;
+    char *data;
+    size_t used;
+    Guard guard;    // releases data if writing fails
+} OutputBuffer;
+
+// The buffer must stay in place until output_free()
+void output_init(OutputBuffer* out, FILE* file);
+
+// Write the buffered bytes to the file
+void output_flush(OutputBuffer* out);
+
+// Flush and release the buffer (the file stays open)
+void output_free(OutputBuffer* out);
+
+static inline void output_reserve(OutputBuffer* out, size_t len) {
+    if (out->used + len > OUTPUT_BUFFER_SIZE) output_flush(out);
+}
+
+static inline void output_bytes(OutputBuffer* out, const char* data, size_t len) {
+    if (len > OUTPUT_BUFFER_SIZE) {
+        output_flush(out);
+        fwrite(data, 1, len, out->file);
+        return;
+    }
+    output_reserve(out, len);
+    memcpy(out->data + out->used, data, len);
+    out->used += len;
+}
+
+static inline void output_char(OutputBuffer* out, char c) {
+    output_reserve(out, 1);
+    out->data[out->used++] = c;
+}
+
+// Append value formatted like printf("%.*f", decimals, value), decimals
+// 0..9, or like printf("%.17g", value) if decimals is negative
+void output_double(OutputBuffer* out, double value, int decimals);
+
+#endif /* !_INC_OUTPUT_H */
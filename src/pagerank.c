@@ -0,0 +1,642 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pagerank.h"
+#include "error.h"
+#include "graph.h"
+#include "dot.h"
+#include "snapshot.h"
+#include "external.h"
+#include "markov.h"
+#include "surfer.h"
+#include "personalized.h"
+#include "delta.h"
+#include "rankfile.h"
+#include "reorder.h"
+#include "utils.h"
+
+
+// Iteration cap until pagerank_set_iterations()
+#define DEFAULT_MAX_ITERATIONS 100
+
+struct PagerankEngine {
+    Graph graph;
+    int loaded;                 // graph holds a complete graph
+    int changing;               // a call is modifying the graph
+    char *edge_file;            // out of core: the graph only has the IDs of this edge file
+    FILE *log;
+    ErrorReport report;
+
+    // Settings
+    int num_threads;
+    double *teleport_probs;
+    int num_probs;
+    int max_iterations;
+    double tolerance;
+    MarkovSolver solver;
+    int extrapolation_interval;
+    int compare_solvers;
+    SeedSets seeds;
+    char *start_ranks;
+    int record_iterations;
+
+    // Nodes the last edge diff affected directly
+    int *delta_active;
+    size_t num_delta_active;
+
+    // Last result; ranks is NULL for an empty graph
+    double *ranks;
+    int num_vectors;
+    int converged;
+    double *iteration_seconds;
+    int num_iterations;
+};
+
+// Start an API call: a fail() further down (also in this function)
+// returns its status from the calling function
+#define ENTER(engine, trap)                                 \
+    trap_init(&(trap), &(engine)->report);                  \
+    if (setjmp((trap).env)) return failed(engine);          \
+    trap_enter(&(trap))
+
+static PagerankStatus failed(PagerankEngine* engine) {
+    // A half modified graph is still consistent enough to be freed
+    if (engine->changing) {
+        engine->changing = 0;
+        engine->loaded = 0;
+        free_graph(&engine->graph);
+    }
+    return engine->report.status;
+}
+
+static PagerankStatus done(ErrorTrap* trap) {
+    trap_leave(trap);
+    return PAGERANK_OK;
+}
+
+static void* alloc_or_fail(size_t size) {
+    void *data = malloc(size ? size : 1);
+    if (!data) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for the engine");
+    }
+    return data;
+}
+
+static char* copy_string(const char* text) {
+    char *copy = alloc_or_fail(strlen(text) + 1);
+    return strcpy(copy, text);
+}
+
+static void require_graph(const PagerankEngine* engine) {
+    if (!engine->loaded) {
+        fail(PAGERANK_ERROR_STATE, "No graph loaded.");
+    }
+}
+
+static void require_in_memory(const PagerankEngine* engine, const char* operation) {
+    require_graph(engine);
+    if (engine->edge_file) {
+        fail(PAGERANK_ERROR_STATE, "%s needs the graph in memory, but %s is ranked out of core.",
+             operation, engine->edge_file);
+    }
+}
+
+static void drop_result(PagerankEngine* engine) {
+    free(engine->ranks);
+    engine->ranks = NULL;
+    engine->num_vectors = 0;
+    engine->converged = 0;
+    engine->num_iterations = 0;
+}
+
+// Teleport sets and the diff refer to node indices
+static void drop_node_state(PagerankEngine* engine) {
+    drop_result(engine);
+    seed_sets_free(&engine->seeds);
+    seed_sets_init(&engine->seeds);
+    free(engine->delta_active);
+    engine->delta_active = NULL;
+    engine->num_delta_active = 0;
+}
+
+PagerankEngine* pagerank_create(void) {
+    PagerankEngine *engine = calloc(1, sizeof(PagerankEngine));
+    double *probs = malloc(sizeof(double));
+    if (!engine || !probs) {
+        free(engine);
+        free(probs);
+        return NULL;
+    }
+    ErrorTrap trap;
+    trap_init(&trap, &engine->report);
+    if (setjmp(trap.env)) {
+        free(engine);
+        free(probs);
+        return NULL;
+    }
+    trap_enter(&trap);
+    init_graph(&engine->graph);
+    seed_sets_init(&engine->seeds);
+    trap_leave(&trap);
+
+    probs[0] = 0.10;
+    engine->teleport_probs = probs;
+    engine->num_probs = 1;
+    engine->num_threads = 1;
+    engine->max_iterations = DEFAULT_MAX_ITERATIONS;
+    engine->solver = SOLVER_JACOBI;
+    return engine;
+}
+
+void pagerank_free(PagerankEngine* engine) {
+    if (!engine) {
+        return;
+    }
+    if (engine->loaded) {
+        free_graph(&engine->graph);
+    }
+    seed_sets_free(&engine->seeds);
+    free(engine->delta_active);
+    free(engine->ranks);
+    free(engine->teleport_probs);
+    free(engine->start_ranks);
+    free(engine->edge_file);
+    free(engine->iteration_seconds);
+    free(engine);
+}
+
+const char* pagerank_error(const PagerankEngine* engine) {
+    return engine->report.message;
+}
+
+void pagerank_set_log(PagerankEngine* engine, FILE* log) {
+    engine->log = log;
+}
+
+PagerankStatus pagerank_load(PagerankEngine* engine, const char* filename) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    if (engine->loaded) {
+        free_graph(&engine->graph);
+        engine->loaded = 0;
+    }
+    drop_node_state(engine);
+    free(engine->start_ranks);
+    engine->start_ranks = NULL;
+    free(engine->edge_file);
+    engine->edge_file = NULL;
+
+    engine->changing = 1;
+    init_graph(&engine->graph);
+    double start = wall_time();
+    int from_snapshot = is_snapshot_file(filename);
+    int out_of_core = !from_snapshot && is_edge_file(filename);
+    size_t bytes;
+    if (out_of_core) {
+        bytes = open_edge_file(&engine->graph, filename);
+        engine->edge_file = copy_string(filename);
+    } else {
+        bytes = from_snapshot ? load_snapshot(&engine->graph, filename)
+                              : parse_dot_file(&engine->graph, filename, engine->num_threads);
+    }
+    engine->changing = 0;
+    engine->loaded = 1;
+    if (engine->log) {
+        double seconds = wall_time() - start;
+        fprintf(engine->log, "%s %.1f MB in %.6f s (%.1f MB/s)\n", from_snapshot || out_of_core ? "Loaded" : "Parsed",
+                bytes / 1e6, seconds, seconds > 0 ? bytes / 1e6 / seconds : 0.0);
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_convert_edges(PagerankEngine* engine, const char* dot_filename, const char* edge_filename) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    double start = wall_time();
+    size_t bytes = convert_dot_to_edges(dot_filename, edge_filename);
+    if (engine->log) {
+        double seconds = wall_time() - start;
+        fprintf(engine->log, "Converted %.1f MB in %.6f s (%.1f MB/s)\n",
+                bytes / 1e6, seconds, seconds > 0 ? bytes / 1e6 / seconds : 0.0);
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_reorder(PagerankEngine* engine, const char* method) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    ReorderMethod reorder;
+    if (!parse_reorder_method(method, &reorder)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Unknown reordering method '%s'. Use none, degree, rcm or community.", method);
+    }
+    require_graph(engine);
+    if (reorder != REORDER_NONE) {
+        require_in_memory(engine, "Reordering");
+    }
+    if (reorder == REORDER_NONE) {
+        return done(&trap);
+    }
+    drop_node_state(engine);
+    engine->changing = 1;
+    ReorderStats stats;
+    reorder_graph(&engine->graph, reorder, engine->log != NULL, &stats);
+    engine->changing = 0;
+    if (engine->log) {
+        print_reorder_stats(engine->log, &stats);
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_apply_diff(PagerankEngine* engine, const char* filename) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "Applying an edge diff");
+    // A diff that does not fit the graph fails here, before any change
+    EdgeDiff diff;
+    read_edge_diff(&engine->graph, filename, &diff);
+    drop_result(engine);
+    free(engine->delta_active);
+    engine->delta_active = NULL;
+    engine->num_delta_active = 0;
+    engine->changing = 1;
+    DeltaStats delta;
+    apply_edge_diff(&engine->graph, &diff, &engine->delta_active, &engine->num_delta_active, &delta);
+    engine->changing = 0;
+    if (engine->log) {
+        fprintf(engine->log, "Applied +%zu -%zu edges (%d new nodes, %zu affected) in %.3f s\n",
+                delta.inserted, delta.deleted, delta.new_nodes, delta.active_nodes, delta.seconds);
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_pack(PagerankEngine* engine) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "Packing");
+    Graph *graph = &engine->graph;
+    double start = wall_time();
+    engine->changing = 1;
+    pack_graph(graph, engine->num_threads);
+    engine->changing = 0;
+    if (engine->log) {
+        size_t bytes = graph->packed_index[packed_index_length(graph->num_nodes) - 1];
+        fprintf(engine->log, "Packed %zu in-edges into %.1f MB (%.2f bytes/edge) in %.3f s\n",
+                graph->num_edges, bytes / 1e6, graph->num_edges ? (double)bytes / graph->num_edges : 0.0,
+                wall_time() - start);
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_save_snapshot(PagerankEngine* engine, const char* filename) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "Saving a snapshot");
+    save_snapshot(&engine->graph, filename);
+    return done(&trap);
+}
+
+PagerankStatus pagerank_print_stats(PagerankEngine* engine, FILE* file) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "Graph statistics");
+    print_graph_stats(file, &engine->graph);
+    return done(&trap);
+}
+
+int pagerank_num_nodes(const PagerankEngine* engine) {
+    return engine->loaded ? engine->graph.num_nodes : 0;
+}
+
+size_t pagerank_num_edges(const PagerankEngine* engine) {
+    return engine->loaded ? engine->graph.num_edges : 0;
+}
+
+const char* pagerank_node_id(const PagerankEngine* engine, int index) {
+    if (!engine->loaded || index < 0 || index >= engine->graph.num_nodes) {
+        return NULL;
+    }
+    return node_id(&engine->graph, index);
+}
+
+int pagerank_node_index(const PagerankEngine* engine, const char* id) {
+    return engine->loaded ? idtable_find(&engine->graph.ids, id, strlen(id)) : -1;
+}
+
+PagerankStatus pagerank_set_threads(PagerankEngine* engine, int num_threads) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    if (num_threads < 1) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Invalid number of threads %d; it must be positive.", num_threads);
+    }
+    engine->num_threads = num_threads;
+    return done(&trap);
+}
+
+PagerankStatus pagerank_set_teleport(PagerankEngine* engine, const double* probs, int count) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    if (count < 1) {
+        fail(PAGERANK_ERROR_ARGUMENT, "At least one teleportation probability is needed.");
+    }
+    for (int k = 0; k < count; k++) {
+        if (!(probs[k] >= 0.0 && probs[k] <= 1.0)) {
+            fail(PAGERANK_ERROR_ARGUMENT, "Invalid teleportation probability %g; it must be between 0 and 1.", probs[k]);
+        }
+    }
+    double *copy = alloc_or_fail(count * sizeof(double));
+    memcpy(copy, probs, count * sizeof(double));
+    free(engine->teleport_probs);
+    engine->teleport_probs = copy;
+    engine->num_probs = count;
+    return done(&trap);
+}
+
+PagerankStatus pagerank_set_iterations(PagerankEngine* engine, int max_iterations, double tolerance) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    if (max_iterations < 0 || !(tolerance >= 0.0)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Invalid iteration limit %d or tolerance %g; neither may be negative.",
+             max_iterations, tolerance);
+    }
+    engine->max_iterations = max_iterations;
+    engine->tolerance = tolerance;
+    return done(&trap);
+}
+
+PagerankStatus pagerank_set_solver(PagerankEngine* engine, const char* name) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    MarkovSolver solver = SOLVER_JACOBI;
+    int interval = 0;
+    const char *colon = strchr(name, ':');
+    size_t length = colon ? (size_t)(colon - name) : strlen(name);
+    char base[32];
+    int valid = length < sizeof(base);
+    if (valid) {
+        memcpy(base, name, length);
+        base[length] = '\0';
+    }
+    int compare = valid && strcmp(base, "all") == 0;
+    if (valid && !compare) {
+        valid = parse_markov_solver(base, &solver);
+    }
+    if (valid && colon) {
+        char *end;
+        long value = strtol(colon + 1, &end, 10);
+        valid = solver == SOLVER_EXTRAPOLATE && !compare && colon[1] != '\0' && *end == '\0' && value >= 4 && value <= 1000000;
+        interval = (int)value;
+    }
+    if (!valid) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Invalid solver '%s'. Use jacobi, gauss-seidel, extrapolate[:K] with K >= 4, adaptive, blocked or all.", name);
+    }
+    engine->solver = solver;
+    engine->extrapolation_interval = interval;
+    engine->compare_solvers = compare;
+    return done(&trap);
+}
+
+PagerankStatus pagerank_add_seeds(PagerankEngine* engine, const char* list) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "A teleport set");
+    add_seed_set(&engine->seeds, &engine->graph, list, strlen(list));
+    return done(&trap);
+}
+
+PagerankStatus pagerank_read_seeds(PagerankEngine* engine, const char* filename) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "A teleport set");
+    read_seed_sets(&engine->seeds, &engine->graph, filename);
+    return done(&trap);
+}
+
+PagerankStatus pagerank_clear_seeds(PagerankEngine* engine) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    seed_sets_free(&engine->seeds);
+    seed_sets_init(&engine->seeds);
+    return done(&trap);
+}
+
+PagerankStatus pagerank_set_start_ranks(PagerankEngine* engine, const char* filename) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    char *copy = filename ? copy_string(filename) : NULL;
+    free(engine->start_ranks);
+    engine->start_ranks = copy;
+    return done(&trap);
+}
+
+void pagerank_record_iterations(PagerankEngine* engine, int enable) {
+    engine->record_iterations = enable;
+}
+
+PagerankStatus pagerank_run_markov(PagerankEngine* engine) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_graph(engine);
+    const int personalized = engine->seeds.num_sets > 0;
+    if (personalized && (engine->solver != SOLVER_JACOBI || engine->compare_solvers)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Personalized PageRank only supports the jacobi solver.");
+    }
+    if (engine->start_ranks && (personalized || engine->compare_solvers)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Start ranks need a single solver and no teleport sets.");
+    }
+    if (engine->num_probs > 1 && (personalized || engine->start_ranks || engine->solver != SOLVER_JACOBI
+                                  || engine->compare_solvers)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Several teleportation probabilities need the jacobi solver, without teleport sets or start ranks.");
+    }
+    if (engine->edge_file && (engine->solver != SOLVER_JACOBI || engine->compare_solvers || engine->num_probs > 1
+                              || personalized || engine->start_ranks)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Out-of-core ranking only supports the jacobi solver with one teleportation probability, without teleport sets or start ranks.");
+    }
+    drop_result(engine);
+
+    Graph *graph = &engine->graph;
+    MarkovOptions options = { engine->teleport_probs[0], engine->max_iterations, engine->tolerance,
+                              engine->num_threads, engine->solver, engine->extrapolation_interval, NULL };
+    if (engine->compare_solvers) {
+        engine->ranks = compare_markov_solvers(graph, &options, engine->log);
+        engine->num_vectors = 1;
+        engine->converged = 1;
+        return done(&trap);
+    }
+    if (engine->record_iterations) {
+        free(engine->iteration_seconds);
+        engine->iteration_seconds = NULL;
+        engine->iteration_seconds = alloc_or_fail(engine->max_iterations * sizeof(double));
+        options.iteration_seconds = engine->iteration_seconds;
+    }
+
+    MarkovStats stats;
+    double *ranks;
+    int num_vectors = 1;
+    if (engine->edge_file) {
+        StreamStats stream;
+        ranks = simulate_external(engine->edge_file, &options, &stats, &stream);
+        if (engine->log) {
+            double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+            fprintf(engine->log, "Streamed %.1f MB per iteration%s: %.1f MB/s, %.3f s waiting for the disk\n",
+                    stats.iterations ? stream.bytes_read / 1e6 / stats.iterations : 0.0,
+                    stream.direct ? " (direct I/O)" : "", stream.bytes_read / 1e6 / seconds, stream.wait_seconds);
+        }
+    } else if (engine->num_probs > 1) {
+        ranks = simulate_teleport_sweep(graph, &options, engine->teleport_probs, engine->num_probs, &stats);
+        num_vectors = engine->num_probs;
+    } else if (personalized) {
+        ranks = simulate_personalized(graph, &options, &engine->seeds, &stats);
+        num_vectors = engine->seeds.num_sets;
+    } else if (engine->start_ranks) {
+        ranks = simulate_delta(graph, &options, engine->start_ranks, engine->delta_active,
+                               engine->num_delta_active, &stats);
+    } else {
+        ranks = simulate_markov_chain(graph, &options, &stats);
+    }
+    engine->ranks = ranks;
+    engine->num_vectors = num_vectors;
+    engine->converged = stats.converged;
+    engine->num_iterations = engine->record_iterations ? stats.iterations : 0;
+    if (engine->log) {
+        print_markov_stats(engine->log, &stats);
+    }
+    return done(&trap);
+}
+
+// Random surfer (steps), or complete-path walks if walks_per_node > 0
+static PagerankStatus run_walkers(PagerankEngine* engine, long long steps, int walks_per_node, uint64_t seed) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "The random surfer");
+    if (walks_per_node > 0 && engine->teleport_probs[0] == 0.0) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Complete-path walks need a teleportation probability > 0, otherwise they never end.");
+    }
+    drop_result(engine);
+    if (engine->log) {
+        fprintf(engine->log, "Random surfer seed: %llu\n", (unsigned long long)seed);
+    }
+    SurferOptions options = { engine->teleport_probs[0], steps, walks_per_node, seed, engine->num_threads };
+    SurferStats stats;
+    engine->ranks = walks_per_node > 0 ? simulate_random_walks(&engine->graph, &options, &stats)
+                                       : simulate_random_surfer(&engine->graph, &options, &stats);
+    engine->num_vectors = 1;
+    if (engine->log) {
+        print_surfer_stats(engine->log, &stats);
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_run_surfer(PagerankEngine* engine, long long steps, uint64_t seed) {
+    if (steps < 0) {
+        ErrorTrap trap;
+        ENTER(engine, trap);
+        fail(PAGERANK_ERROR_ARGUMENT, "Invalid number of steps %lld; it must not be negative.", steps);
+    }
+    return run_walkers(engine, steps, 0, seed);
+}
+
+PagerankStatus pagerank_run_walks(PagerankEngine* engine, int walks_per_node, uint64_t seed) {
+    if (walks_per_node < 1) {
+        ErrorTrap trap;
+        ENTER(engine, trap);
+        fail(PAGERANK_ERROR_ARGUMENT, "Invalid number of walks %d; it must be positive.", walks_per_node);
+    }
+    return run_walkers(engine, 0, walks_per_node, seed);
+}
+
+PagerankStatus pagerank_run_push(PagerankEngine* engine, double epsilon) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_in_memory(engine, "Push");
+    if (!(epsilon > 0.0)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Invalid push threshold %g; it must be positive.", epsilon);
+    }
+    if (engine->teleport_probs[0] == 0.0) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Push needs a teleportation probability > 0, otherwise it never ends.");
+    }
+    if (engine->seeds.num_sets != 1) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Push computes a single vector, but %d teleport sets were given.",
+             engine->seeds.num_sets);
+    }
+    drop_result(engine);
+    double start = wall_time();
+    size_t pushes;
+    engine->ranks = simulate_push(&engine->graph, engine->teleport_probs[0], &engine->seeds, epsilon, &pushes);
+    engine->num_vectors = 1;
+    if (engine->log) {
+        fprintf(engine->log, "Push: %zu pushes in %.3f s\n", pushes, wall_time() - start);
+    }
+    return done(&trap);
+}
+
+int pagerank_num_vectors(const PagerankEngine* engine) {
+    return engine->num_vectors;
+}
+
+int pagerank_converged(const PagerankEngine* engine) {
+    return engine->converged;
+}
+
+const double* pagerank_iteration_seconds(const PagerankEngine* engine, int* count) {
+    *count = engine->num_iterations;
+    return engine->iteration_seconds;
+}
+
+static void require_result(const PagerankEngine* engine) {
+    require_graph(engine);
+    if (engine->num_vectors == 0) {
+        fail(PAGERANK_ERROR_STATE, "No ranks computed yet.");
+    }
+}
+
+PagerankStatus pagerank_get_ranks(const PagerankEngine* engine, double* buffer, size_t length) {
+    // Only the error report is written
+    PagerankEngine *self = (PagerankEngine *)engine;
+    ErrorTrap trap;
+    ENTER(self, trap);
+    require_result(engine);
+    size_t size = (size_t)engine->graph.num_nodes * engine->num_vectors;
+    if (length < size) {
+        fail(PAGERANK_ERROR_ARGUMENT, "The buffer holds %zu ranks, but %zu are needed.", length, size);
+    }
+    if (size > 0) {
+        memcpy(buffer, engine->ranks, size * sizeof(double));
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_write_ranks(PagerankEngine* engine, FILE* file, const char* name,
+                                    const char* format, size_t top) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    RankFormat rank_format;
+    if (!parse_rank_format(format, &rank_format)) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Unknown output format '%s'. Use text, raw or columnar.", format);
+    }
+    if (rank_format != RANKS_TEXT && top > 0) {
+        fail(PAGERANK_ERROR_ARGUMENT, "Binary output formats hold all ranks; they cannot be limited to the top nodes.");
+    }
+    require_result(engine);
+    Graph *graph = &engine->graph;
+    if (rank_format != RANKS_TEXT) {
+        if (fflush(file) != 0) {
+            fail_errno(PAGERANK_ERROR_IO, "Could not write ranks to %s", name);
+        }
+        write_rank_file(graph, engine->ranks, engine->num_vectors, rank_format, fileno(file), name);
+    } else if (top > 0) {
+        print_top_ranks(file, graph, engine->ranks, engine->num_vectors, top);
+    } else {
+        print_rank_block(file, graph, engine->ranks, engine->num_vectors);
+    }
+    return done(&trap);
+}
+
+PagerankStatus pagerank_save_ranks(PagerankEngine* engine, const char* filename) {
+    ErrorTrap trap;
+    ENTER(engine, trap);
+    require_result(engine);
+    save_rank_block(&engine->graph, engine->ranks, engine->num_vectors, filename);
+    return done(&trap);
+}
@@ -0,0 +1,166 @@
+#ifndef _INC_PAGERANK_H
+#define _INC_PAGERANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// libpagerank: PageRank of a graph held by an engine handle. A program
+// loads a graph (DOT file or snapshot) once and ranks it as often as it
+// likes, with different settings, without exiting on errors: every call
+// that can fail returns a PagerankStatus, and pagerank_error() describes
+// the last failure.
+//
+// An engine must only be used by one thread at a time; separate engines
+// are independent. A call that fails releases the memory, files and
+// threads it acquired. If a failure interrupts a change of the graph
+// (pagerank_reorder(), pagerank_apply_diff(), pagerank_pack()), the graph
+// is freed and has to be loaded again. This includes failures on the
+// worker threads of a call, which are handed back to the calling thread.
+
+typedef struct PagerankEngine PagerankEngine;
+
+typedef enum {
+    PAGERANK_OK = 0,
+    PAGERANK_ERROR_ARGUMENT,    // invalid value or combination of settings
+    PAGERANK_ERROR_STATE,       // no graph loaded, or no ranks computed yet
+    PAGERANK_ERROR_IO,          // a file could not be opened, read or written
+    PAGERANK_ERROR_FORMAT,      // malformed input file or unknown node ID
+    PAGERANK_ERROR_MEMORY,      // out of memory
+    PAGERANK_ERROR_SYSTEM,      // other system failure, e.g. creating threads
+} PagerankStatus;
+
+// Returns NULL if out of memory
+PagerankEngine* pagerank_create(void);
+void pagerank_free(PagerankEngine* engine);
+
+// Message of the last failed call ("" after a successful one)
+const char* pagerank_error(const PagerankEngine* engine);
+
+// Report timings and convergence details to log, as pagerank -v does
+// (NULL, the default, is quiet)
+void pagerank_set_log(PagerankEngine* engine, FILE* log);
+
+// --- Graph ---
+
+// Load a DOT file, a snapshot or an edge file (detected by their magic),
+// replacing the current graph; teleport sets, start ranks and results are
+// dropped. An edge file is ranked out of core: only its node IDs are
+// loaded, and every iteration streams the edges from disk. Such a graph
+// supports pagerank_run_markov() with the jacobi solver and one
+// teleportation probability, without teleport sets or start ranks; the
+// calls that need the edges in memory fail with PAGERANK_ERROR_STATE.
+PagerankStatus pagerank_load(PagerankEngine* engine, const char* filename);
+
+// Convert a DOT file into an edge file for out-of-core ranking in one
+// streaming pass, without loading the graph (it keeps only the node IDs
+// and out-degrees in memory). The current graph is not changed.
+PagerankStatus pagerank_convert_edges(PagerankEngine* engine, const char* dot_filename,
+                                      const char* edge_filename);
+
+// Renumber the nodes for cache locality: "none", "degree", "rcm" or
+// "community". Drops teleport sets and results like pagerank_load().
+PagerankStatus pagerank_reorder(PagerankEngine* engine, const char* method);
+
+// Apply an edge diff file ("+A -> B;" / "-A -> B;" lines). The nodes it
+// affects are re-converged first by the next pagerank_run_markov() with
+// start ranks. Drops results. The whole diff is checked first, so a
+// malformed line or a deletion of a missing edge fails (with
+// PAGERANK_ERROR_FORMAT) before the graph or the results change.
+PagerankStatus pagerank_apply_diff(PagerankEngine* engine, const char* filename);
+
+// Store the in-edges compressed (see pack_graph())
+PagerankStatus pagerank_pack(PagerankEngine* engine);
+
+PagerankStatus pagerank_save_snapshot(PagerankEngine* engine, const char* filename);
+
+// Print the node and edge counts and the degree ranges
+PagerankStatus pagerank_print_stats(PagerankEngine* engine, FILE* file);
+
+int pagerank_num_nodes(const PagerankEngine* engine);
+size_t pagerank_num_edges(const PagerankEngine* engine);
+
+// ID of node index (0 .. num_nodes - 1), or NULL if out of range
+const char* pagerank_node_id(const PagerankEngine* engine, int index);
+
+// Index of the node with the given ID, or -1 if there is none
+int pagerank_node_index(const PagerankEngine* engine, const char* id);
+
+// --- Settings, kept until changed ---
+
+// Threads for loading and the Markov chain, and walkers of the surfer
+// (default 1)
+PagerankStatus pagerank_set_threads(PagerankEngine* engine, int num_threads);
+
+// Teleportation probabilities in [0, 1] (default 0.1). Several values
+// make pagerank_run_markov() rank the graph for all of them in one run,
+// one vector each.
+PagerankStatus pagerank_set_teleport(PagerankEngine* engine, const double* probs, int count);
+
+// Iteration cap of the Markov chain and the L1 tolerance at which it stops
+// early, 0 for none (default 100 and 0)
+PagerankStatus pagerank_set_iterations(PagerankEngine* engine, int max_iterations, double tolerance);
+
+// "jacobi" (default), "gauss-seidel", "extrapolate[:K]", "adaptive",
+// "blocked", or "all" to compare them in a table on the log (see
+// pagerank_set_log()) and keep the Jacobi ranks
+PagerankStatus pagerank_set_solver(PagerankEngine* engine, const char* name);
+
+// Add a teleport set for personalized PageRank: comma- or blank-separated
+// node IDs, each optionally followed by :WEIGHT. Every set gives one
+// vector of pagerank_run_markov(); pagerank_run_push() needs exactly one.
+PagerankStatus pagerank_add_seeds(PagerankEngine* engine, const char* list);
+
+// Add one teleport set per line of a file (# starts a comment line)
+PagerankStatus pagerank_read_seeds(PagerankEngine* engine, const char* filename);
+PagerankStatus pagerank_clear_seeds(PagerankEngine* engine);
+
+// Start pagerank_run_markov() from the ranks in a file as printed by
+// pagerank (or pagerank_save_ranks()) instead of the uniform vector; NULL
+// to start uniformly again
+PagerankStatus pagerank_set_start_ranks(PagerankEngine* engine, const char* filename);
+
+// Keep the wall time of every Markov chain iteration (see
+// pagerank_iteration_seconds())
+void pagerank_record_iterations(PagerankEngine* engine, int enable);
+
+// --- Runs; each replaces the previous result ---
+
+PagerankStatus pagerank_run_markov(PagerankEngine* engine);
+
+// Random surfer with steps steps in total, split across the threads
+PagerankStatus pagerank_run_surfer(PagerankEngine* engine, long long steps, uint64_t seed);
+
+// Complete-path Monte Carlo: walks_per_node walks from every node
+PagerankStatus pagerank_run_walks(PagerankEngine* engine, int walks_per_node, uint64_t seed);
+
+// Local push approximation of the personalized PageRank of the single
+// teleport set, with residual threshold epsilon per out-edge
+PagerankStatus pagerank_run_push(PagerankEngine* engine, double epsilon);
+
+// --- Results ---
+
+// Vectors of the last result (0 if there is none)
+int pagerank_num_vectors(const PagerankEngine* engine);
+
+// Whether the last Markov chain run met the tolerance
+int pagerank_converged(const PagerankEngine* engine);
+
+// Wall times of the iterations of the last Markov chain run, if recorded
+const double* pagerank_iteration_seconds(const PagerankEngine* engine, int* count);
+
+// Copy the ranks into buffer, node-major: the num_vectors values of node i
+// start at buffer[i * num_vectors]. length is the size of buffer in
+// doubles and must be at least num_nodes * num_vectors.
+PagerankStatus pagerank_get_ranks(const PagerankEngine* engine, double* buffer, size_t length);
+
+// Write the ranks to file in format "text" (lines sorted by ID, or the top
+// nodes by rank, best first, if top > 0), "raw" or "columnar" (binary,
+// see rankfile.h); name is used in messages
+PagerankStatus pagerank_write_ranks(PagerankEngine* engine, FILE* file, const char* name,
+                                    const char* format, size_t top);
+
+// Write the ranks as text with full precision, e.g. for start ranks
+PagerankStatus pagerank_save_ranks(PagerankEngine* engine, const char* filename);
+
+#endif /* !_INC_PAGERANK_H */
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "parallel.h"
+#include "error.h"
+
+
+// Run a share of a task on a worker thread, which has no trap of its own:
+// a fail() in it is recorded in report instead of ending the process
+static void run_trapped(void (*task)(void* arg, int tid, int num_threads), void* arg, int tid,
+                        int num_threads, ErrorReport* report) {
+    ErrorTrap trap;
+    trap_init(&trap, report);
+    if (setjmp(trap.env)) {
+        return;
+    }
+    trap_enter(&trap);
+    task(arg, tid, num_threads);
+    trap_leave(&trap);
+}
+
+// Raise a failure recorded by a worker on the calling thread, once all
+// workers are done with the task
+static void raise_worker_failure(const ErrorReport* report) {
+    if (report->status != PAGERANK_OK) {
+        fail(report->status, "%s", report->message);
+    }
+}
+
+typedef struct {
+    void (*task)(void* arg, int tid, int num_threads);
+    void *arg;
+    int tid;
+    int num_threads;
+    ErrorReport report;
+} Worker;
+
+static void* worker_main(void* data) {
+    Worker *worker = data;
+    run_trapped(worker->task, worker->arg, worker->tid, worker->num_threads, &worker->report);
+    return NULL;
+}
+
+typedef struct {
+    pthread_t *threads;
+    Worker *workers;
+    int num_started;    // threads[1 .. num_started - 1] are running
+} Crew;
+
+static void crew_join(Crew* crew) {
+    for (int t = 1; t < crew->num_started; t++) {
+        pthread_join(crew->threads[t], NULL);
+    }
+    crew->num_started = 1;
+}
+
+// Wait for the started threads and release them; also the guard release
+// when the calling thread's share of the task fails
+static void crew_finish(void* data) {
+    Crew *crew = data;
+    crew_join(crew);
+    free(crew->threads);
+    free(crew->workers);
+}
+
+void run_parallel(int num_threads, void (*task)(void* arg, int tid, int num_threads), void* arg) {
+    if (num_threads <= 1) {
+        task(arg, 0, 1);
+        return;
+    }
+
+    Crew crew = { malloc(num_threads * sizeof(pthread_t)), malloc(num_threads * sizeof(Worker)), 1 };
+    Guard guard;
+    guard_push(&guard, crew_finish, &crew);
+    if (!crew.threads || !crew.workers) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for threads");
+    }
+    for (int t = 0; t < num_threads; t++) {
+        crew.workers[t] = (Worker){ task, arg, t, num_threads, { PAGERANK_OK, "" } };
+    }
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&crew.threads[t], NULL, worker_main, &crew.workers[t]) != 0) {
+            fail_errno(PAGERANK_ERROR_SYSTEM, "Failed to create thread");
+        }
+        crew.num_started = t + 1;
+    }
+    task(arg, 0, num_threads);
+    crew_join(&crew);
+    for (int t = 1; t < num_threads; t++) {
+        raise_worker_failure(&crew.workers[t].report);
+    }
+    guard_pop(&guard);
+    crew_finish(&crew);
+}
+
+struct ThreadPool {
+    int num_threads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    void (*task)(void* arg, int tid, int num_threads);
+    void *arg;
+    ErrorReport *reports;       // per worker: the failure of its share of the task
+    unsigned long generation;   // bumped for every pool_run()
+    int pending;                // workers still running the current task
+    int shutdown;
+};
+
+typedef struct {
+    ThreadPool *pool;
+    int tid;
+} PoolWorker;
+
+static void* pool_worker_main(void* data) {
+    PoolWorker worker = *(PoolWorker *)data;
+    ThreadPool *pool = worker.pool;
+    free(data);
+
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_trapped(pool->task, pool->arg, worker.tid, pool->num_threads, &pool->reports[worker.tid]);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Stop and release a pool whose threads 1 .. num_threads - 1 are running
+static void pool_shutdown(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int t = 1; t < pool->num_threads; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->reports);
+    free(pool);
+}
+
+ThreadPool* pool_create(int num_threads) {
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (num_threads < 1) num_threads = 1;
+    if (pool) {
+        pool->threads = malloc(num_threads * sizeof(pthread_t));
+        pool->reports = calloc(num_threads, sizeof(ErrorReport));
+    }
+    if (!pool || !pool->threads || !pool->reports) {
+        if (pool) {
+            free(pool->threads);
+            free(pool->reports);
+        }
+        free(pool);
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for threads");
+    }
+    pool->num_threads = 1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    // num_threads counts the started threads until all of them run, so a
+    // failure can shut down exactly those
+    for (int t = 1; t < num_threads; t++) {
+        PoolWorker *worker = malloc(sizeof(PoolWorker));
+        if (worker) {
+            *worker = (PoolWorker){ pool, t };
+        }
+        if (!worker || pthread_create(&pool->threads[t], NULL, pool_worker_main, worker) != 0) {
+            int memory = !worker;
+            free(worker);
+            pool_shutdown(pool);
+            if (memory) {
+                fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for threads");
+            }
+            fail_errno(PAGERANK_ERROR_SYSTEM, "Failed to create thread");
+        }
+        pool->num_threads = t + 1;
+    }
+    return pool;
+}
+
+void pool_destroy(ThreadPool* pool) {
+    if (pool) {
+        pool_shutdown(pool);
+    }
+}
+
+int pool_size(const ThreadPool* pool) {
+    return pool->num_threads;
+}
+
+// Wait until the workers have finished the current task
+static void pool_wait(void* data) {
+    ThreadPool *pool = data;
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_run(ThreadPool* pool, void (*task)(void* arg, int tid, int num_threads), void* arg) {
+    if (pool->num_threads == 1) {
+        task(arg, 0, 1);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->pending = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    // If the calling thread's share fails, the others must be done with
+    // the task's data before it is released
+    Guard guard;
+    guard_push(&guard, pool_wait, pool);
+    task(arg, 0, pool->num_threads);
+    guard_pop(&guard);
+    pool_wait(pool);
+    for (int t = 1; t < pool->num_threads; t++) {
+        raise_worker_failure(&pool->reports[t]);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef _INC_PARALLEL_H
+#define _INC_PARALLEL_H
+
+#include <stddef.h>
+
+// Run task(arg, tid, num_threads) for tid = 0 .. num_threads - 1, each on
+// its own thread (tid 0 runs on the calling thread), and wait for all of
+// them to finish. A fail() on another thread ends only that thread's share;
+// the first such failure (by tid) is raised again on the calling thread
+// once all of them are done.
+void run_parallel(int num_threads, void (*task)(void* arg, int tid, int num_threads), void* arg);
+
+// A fixed set of worker threads for running many short parallel steps
+// (e.g. one per iteration) without creating threads each time
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool* pool_create(int num_threads);
+void pool_destroy(ThreadPool* pool);
+int pool_size(const ThreadPool* pool);
+
+// Like run_parallel(), but on the pool's threads
+void pool_run(ThreadPool* pool, void (*task)(void* arg, int tid, int num_threads), void* arg);
+
+// Split [0, n) into num_threads contiguous ranges; return the start of
+// range tid (range tid ends where range tid + 1 starts).
+static inline size_t range_start(size_t n, int tid, int num_threads) {
+    return (size_t)((unsigned long long)n * tid / num_threads);
+}
+
+#endif /* !_INC_PARALLEL_H */
@@ -0,0 +1,242 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "personalized.h"
+#include "graph.h"
+#include "markov.h"
+#include "error.h"
+
+
+void seed_sets_init(SeedSets* sets) {
+    memset(sets, 0, sizeof(*sets));
+    sets->set_offsets = calloc(1, sizeof(size_t));
+    if (!sets->set_offsets) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for teleport sets");
+    }
+}
+
+void seed_sets_free(SeedSets* sets) {
+    free(sets->set_offsets);
+    free(sets->seeds);
+    memset(sets, 0, sizeof(*sets));
+}
+
+static void append_seed(SeedSets* sets, int node, double weight) {
+    size_t count = sets->set_offsets[sets->num_sets + 1];
+    if (count == sets->seeds_capacity) {
+        size_t capacity = sets->seeds_capacity ? 2 * sets->seeds_capacity : 16;
+        Seed *seeds = realloc(sets->seeds, capacity * sizeof(Seed));
+        if (!seeds) {
+            fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for teleport sets");
+        }
+        sets->seeds = seeds;
+        sets->seeds_capacity = capacity;
+    }
+    sets->seeds[count] = (Seed){ node, weight };
+    sets->set_offsets[sets->num_sets + 1]++;
+}
+
+static int is_separator(char c) {
+    return c == ',' || isspace((unsigned char)c);
+}
+
+void add_seed_set(SeedSets* sets, const Graph* graph, const char* text, size_t len) {
+    // The new set is num_sets; append_seed() grows its end offset
+    size_t *offsets = realloc(sets->set_offsets, (sets->num_sets + 2) * sizeof(size_t));
+    if (!offsets) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for teleport sets");
+    }
+    sets->set_offsets = offsets;
+    const size_t first = offsets[sets->num_sets];
+    offsets[sets->num_sets + 1] = first;
+    const char *end = text + len;
+    while (text < end) {
+        if (is_separator(*text)) {
+            text++;
+            continue;
+        }
+        const char *token = text;
+        while (text < end && !is_separator(*text) && *text != ':') text++;
+        int node = idtable_find(&graph->ids, token, text - token);
+        if (node < 0) {
+            fail(PAGERANK_ERROR_FORMAT, "Unknown node '%.*s' in teleport set.", (int)(text - token), token);
+        }
+        double weight = 1.0;
+        if (text < end && *text == ':') {
+            char buffer[64], *stop = buffer;
+            const char *value = ++text;
+            while (text < end && !is_separator(*text)) text++;
+            size_t value_len = text - value;
+            if (value_len < sizeof(buffer)) {
+                memcpy(buffer, value, value_len);
+                buffer[value_len] = '\0';
+                weight = strtod(buffer, &stop);
+            }
+            if (value_len == 0 || value_len >= sizeof(buffer) || *stop != '\0' || !(weight > 0.0)) {
+                fail(PAGERANK_ERROR_FORMAT, "Invalid weight '%.*s' for node '%s' in teleport set. Weights must be positive numbers.",
+                        (int)(text - value), value, node_id(graph, node));
+            }
+        }
+        append_seed(sets, node, weight);
+    }
+    if (sets->set_offsets[sets->num_sets + 1] == first) {
+        fail(PAGERANK_ERROR_FORMAT, "Empty teleport set.");
+    }
+    sets->num_sets++;
+}
+
+void read_seed_sets(SeedSets* sets, const Graph* graph, const char* filename) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fail_errno(PAGERANK_ERROR_IO, "Could not open teleport file");
+    }
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    Guard guards[2];
+    guard_push(&guards[0], release_file, file);
+    guard_push(&guards[1], release_line, &line);
+    while ((len = getline(&line, &capacity, file)) != -1) {
+        const char *text = line;
+        while (len > 0 && isspace((unsigned char)*text)) {
+            text++;
+            len--;
+        }
+        if (len > 0 && *text != '#') {
+            add_seed_set(sets, graph, text, len);
+        }
+    }
+    guard_pop(&guards[1]);
+    guard_pop(&guards[0]);
+    free(line);
+    fclose(file);
+}
+
+double* simulate_personalized(Graph* graph, const MarkovOptions* options, const SeedSets* sets, MarkovStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (graph->num_nodes == 0) {
+        return NULL;
+    }
+    const int K = sets->num_sets;
+    const size_t size = (size_t)graph->num_nodes * K;
+    double *teleport = calloc(size, sizeof(double));
+    double *ranks = malloc(size * sizeof(double));
+    Guard guards[2];
+    guard_memory(guards, (void *[]){ teleport, ranks }, 2);
+    if (!teleport || !ranks) {
+         fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+
+    // Normalize every set into column k of the teleport block
+    for (int k = 0; k < K; k++) {
+        double total = 0.0;
+        for (size_t s = sets->set_offsets[k]; s < sets->set_offsets[k + 1]; s++) {
+            total += sets->seeds[s].weight;
+        }
+        for (size_t s = sets->set_offsets[k]; s < sets->set_offsets[k + 1]; s++) {
+            teleport[(size_t)sets->seeds[s].node * K + k] += sets->seeds[s].weight / total;
+        }
+    }
+
+    // Start from the teleport distributions themselves
+    memcpy(ranks, teleport, size * sizeof(double));
+    markov_iterate_block(graph, options, teleport, NULL, K, ranks, stats);
+
+    guard_pop_memory(guards, 2);
+    free(teleport);
+    return ranks;
+}
+
+// FIFO of the nodes whose residual is at least epsilon per out-edge
+// (dangling nodes count as one). Every node is in it at most once, so a
+// ring of num_nodes entries suffices.
+typedef struct {
+    const Graph *graph;
+    const double *residual;
+    double epsilon;
+    int *nodes;
+    unsigned char *queued;
+    size_t head, count;
+} PushQueue;
+
+static void push_activate(PushQueue* queue, int node) {
+    int degree = out_degree(queue->graph, node);
+    if (!queue->queued[node] && queue->residual[node] >= queue->epsilon * (degree ? degree : 1)) {
+        queue->queued[node] = 1;
+        queue->nodes[(queue->head + queue->count++) % queue->graph->num_nodes] = node;
+    }
+}
+
+double* simulate_push(Graph* graph, double teleport_prob, const SeedSets* sets, double epsilon, size_t* pushes) {
+    const int n = graph->num_nodes;
+    *pushes = 0;
+    if (n == 0) {
+        return NULL;
+    }
+    double *estimate = calloc(n, sizeof(double));
+    double *residual = calloc(n, sizeof(double));
+    PushQueue queue = {
+        .graph = graph,
+        .residual = residual,
+        .epsilon = epsilon,
+        .nodes = malloc(n * sizeof(int)),
+        .queued = calloc(n, 1),
+    };
+    if (!estimate || !residual || !queue.nodes || !queue.queued) {
+        free(estimate);
+        free(residual);
+        free(queue.nodes);
+        free(queue.queued);
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for probability vectors");
+    }
+
+    const Seed *seeds = sets->seeds + sets->set_offsets[0];
+    const size_t num_seeds = sets->set_offsets[1] - sets->set_offsets[0];
+    double total = 0.0;
+    for (size_t s = 0; s < num_seeds; s++) {
+        total += seeds[s].weight;
+    }
+    for (size_t s = 0; s < num_seeds; s++) {
+        residual[seeds[s].node] += seeds[s].weight / total;
+    }
+    for (size_t s = 0; s < num_seeds; s++) {
+        push_activate(&queue, seeds[s].node);
+    }
+
+    // Invariant: ppr(seeds) = estimate + ppr(residual). A push settles the
+    // teleport share of a node's residual and hands the rest to its
+    // successors, or back to the seeds for a dangling node.
+    while (queue.count > 0) {
+        int u = queue.nodes[queue.head];
+        queue.head = (queue.head + 1) % n;
+        queue.count--;
+        queue.queued[u] = 0;
+
+        double mass = residual[u];
+        residual[u] = 0.0;
+        estimate[u] += teleport_prob * mass;
+        double spread = (1.0 - teleport_prob) * mass;
+        int degree = out_degree(graph, u);
+        if (degree > 0) {
+            const int *targets = graph->out_targets + graph->out_offsets[u];
+            for (int e = 0; e < degree; e++) {
+                residual[targets[e]] += spread / degree;
+                push_activate(&queue, targets[e]);
+            }
+        } else {
+            for (size_t s = 0; s < num_seeds; s++) {
+                residual[seeds[s].node] += spread * seeds[s].weight / total;
+                push_activate(&queue, seeds[s].node);
+            }
+        }
+        (*pushes)++;
+    }
+
+    free(residual);
+    free(queue.nodes);
+    free(queue.queued);
+    return estimate;
+}
@@ -0,0 +1,46 @@
+#ifndef _INC_PERSONALIZED_H
+#define _INC_PERSONALIZED_H
+
+#include <stddef.h>
+#include "graph.h"
+#include "markov.h"
+
+// Teleport sets for personalized PageRank. Each set is a sparse list of
+// seed nodes with positive weights; set k spans
+// seeds[set_offsets[k] .. set_offsets[k + 1]).
+typedef struct {
+    int node;
+    double weight;
+} Seed;
+
+typedef struct {
+    int num_sets;
+    size_t *set_offsets;
+    Seed *seeds;
+    size_t seeds_capacity;
+} SeedSets;
+
+void seed_sets_init(SeedSets* sets);
+void seed_sets_free(SeedSets* sets);
+
+// Add one set given as "<id>[:<weight>]" entries separated by commas or
+// whitespace (weight defaults to 1). Fails (see fail()) on unknown nodes
+// or bad weights.
+void add_seed_set(SeedSets* sets, const Graph* graph, const char* text, size_t len);
+
+// Add one set per non-empty line of a file; lines starting with # are
+// comments
+void read_seed_sets(SeedSets* sets, const Graph* graph, const char* filename);
+
+// Compute the personalized PageRank of every set with one batched
+// markov_iterate_block() run. Returns the node-major V x K rank block
+// (malloc'ed; NULL for an empty graph).
+double* simulate_personalized(Graph* graph, const MarkovOptions* options, const SeedSets* sets, MarkovStats* stats);
+
+// Andersen-Chung-Lang push: approximate the personalized PageRank of the
+// first set locally, touching only nodes whose residual reaches epsilon
+// times their out-degree. Returns the ranks (malloc'ed; NULL for an empty
+// graph) and the number of push operations in *pushes.
+double* simulate_push(Graph* graph, double teleport_prob, const SeedSets* sets, double epsilon, size_t* pushes);
+
+#endif /* !_INC_PERSONALIZED_H */
@@ -0,0 +1,346 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "profile.h"
+#include "utils.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// The heap in use is asked from the allocator that actually serves
+// malloc(): the sanitizer runtime in ASAN builds, glibc otherwise
+#if defined(__SANITIZE_ADDRESS__)
+#define HEAP_FROM_SANITIZER
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define HEAP_FROM_SANITIZER
+#endif
+#endif
+
+#if defined(HEAP_FROM_SANITIZER)
+// From sanitizer/allocator_interface.h, which not every compiler ships
+size_t __sanitizer_get_current_allocated_bytes(void);
+#elif defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+#include <malloc.h>
+#define HEAP_FROM_MALLINFO
+#endif
+#endif
+
+typedef enum {
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    NUM_COUNTERS
+} Counter;
+
+static const char *counter_names[NUM_COUNTERS] = {
+    [COUNTER_INSTRUCTIONS] = "instructions",
+    [COUNTER_CACHE_MISSES] = "cache_misses",
+    [COUNTER_BRANCH_MISSES] = "branch_misses",
+};
+
+// A reading of all meters at one point in time
+typedef struct {
+    double wall;
+    double cpu;                 // all threads of the process
+    long long heap;             // bytes in use, -1 if unknown
+    uint64_t counters[NUM_COUNTERS];
+    int counted;                // counters are valid
+} Sample;
+
+typedef struct {
+    const char *name;
+    Sample begin;
+    Sample delta;               // end - begin; heap is the change
+    long long heap_end;
+} Phase;
+
+struct Profile {
+    int counter_fds[NUM_COUNTERS];  // -1 without hardware counters
+    Phase *phases;
+    int num_phases;
+    int capacity;
+    int running;                // the last phase has not ended yet
+    double *iterations;
+    int num_iterations;
+};
+
+#ifdef __linux__
+// Count a hardware event in user space for this process and the threads
+// it creates from now on. Inherited counts are added to the total when a
+// thread exits, which the thread pools do at the end of every run.
+static int open_counter(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static void open_counters(Profile* profile) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        profile->counter_fds[c] = -1;
+    }
+#ifdef __linux__
+    static const uint64_t configs[NUM_COUNTERS] = {
+        [COUNTER_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+        [COUNTER_CACHE_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+        [COUNTER_BRANCH_MISSES] = PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        profile->counter_fds[c] = open_counter(configs[c]);
+        if (profile->counter_fds[c] < 0) {
+            // All or nothing (no permission, no PMU in a VM, ...)
+            for (int d = 0; d < c; d++) {
+                close(profile->counter_fds[d]);
+                profile->counter_fds[d] = -1;
+            }
+            profile->counter_fds[c] = -1;
+            return;
+        }
+    }
+#endif
+}
+
+static long long heap_in_use(void) {
+#if defined(HEAP_FROM_SANITIZER)
+    return (long long)__sanitizer_get_current_allocated_bytes();
+#elif defined(HEAP_FROM_MALLINFO)
+    struct mallinfo2 info = mallinfo2();
+    return (long long)(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+static double cpu_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void take_sample(const Profile* profile, Sample* sample) {
+    sample->counted = profile->counter_fds[0] >= 0;
+    for (int c = 0; c < NUM_COUNTERS && sample->counted; c++) {
+        // value, time enabled, time running; scaled up if the kernel had
+        // to multiplex the counters
+        uint64_t values[3];
+        if (read(profile->counter_fds[c], values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+            sample->counted = 0;
+        } else {
+            sample->counters[c] = values[2] < values[1]
+                ? (uint64_t)((double)values[0] * values[1] / values[2]) : values[0];
+        }
+    }
+    sample->heap = heap_in_use();
+    sample->cpu = cpu_time();
+    sample->wall = wall_time();
+}
+
+static void end_phase(Profile* profile) {
+    if (!profile->running) {
+        return;
+    }
+    Phase *phase = &profile->phases[profile->num_phases - 1];
+    Sample end;
+    take_sample(profile, &end);
+    phase->delta.wall = end.wall - phase->begin.wall;
+    phase->delta.cpu = end.cpu - phase->begin.cpu;
+    phase->delta.heap = end.heap >= 0 ? end.heap - phase->begin.heap : -1;
+    phase->heap_end = end.heap;
+    phase->delta.counted = end.counted && phase->begin.counted;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        phase->delta.counters[c] = end.counters[c] - phase->begin.counters[c];
+    }
+    profile->running = 0;
+}
+
+Profile* profile_create(void) {
+    Profile *profile = calloc(1, sizeof(Profile));
+    if (!profile) {
+        perror("Failed to allocate memory for the profile");
+        exit(1);
+    }
+    open_counters(profile);
+    return profile;
+}
+
+void profile_phase(Profile* profile, const char* name) {
+    if (!profile) {
+        return;
+    }
+    end_phase(profile);
+    if (!name) {
+        return;
+    }
+    if (profile->num_phases == profile->capacity) {
+        profile->capacity = profile->capacity ? 2 * profile->capacity : 16;
+        profile->phases = realloc(profile->phases, profile->capacity * sizeof(Phase));
+        if (!profile->phases) {
+            perror("Failed to allocate memory for the profile");
+            exit(1);
+        }
+    }
+    Phase *phase = &profile->phases[profile->num_phases++];
+    memset(phase, 0, sizeof(*phase));
+    phase->name = name;
+    profile->running = 1;
+    take_sample(profile, &phase->begin);
+}
+
+void profile_iterations(Profile* profile, const double* seconds, int count) {
+    if (!profile) {
+        return;
+    }
+    free(profile->iterations);
+    profile->iterations = malloc((count ? count : 1) * sizeof(double));
+    if (!profile->iterations) {
+        perror("Failed to allocate memory for the profile");
+        exit(1);
+    }
+    memcpy(profile->iterations, seconds, count * sizeof(double));
+    profile->num_iterations = count;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int any_counted(const Profile* profile) {
+    for (int p = 0; p < profile->num_phases; p++) {
+        if (profile->phases[p].delta.counted) return 1;
+    }
+    return 0;
+}
+
+static void print_table(const Profile* profile, long peak_rss_kib) {
+    const int counters = any_counted(profile);
+    fprintf(stderr, "Profile:\n%-10s %10s %10s %10s", "phase", "wall s", "cpu s", "heap MB");
+    if (counters) {
+        fprintf(stderr, " %15s %15s %15s", "instructions", "cache misses", "branch misses");
+    }
+    fprintf(stderr, "\n");
+
+    Sample total;
+    memset(&total, 0, sizeof(total));
+    total.counted = counters;
+    for (int p = 0; p < profile->num_phases; p++) {
+        const Phase *phase = &profile->phases[p];
+        total.wall += phase->delta.wall;
+        total.cpu += phase->delta.cpu;
+        fprintf(stderr, "%-10s %10.6f %10.6f", phase->name, phase->delta.wall, phase->delta.cpu);
+        if (phase->heap_end >= 0) {
+            fprintf(stderr, " %+10.1f", phase->delta.heap / 1e6);
+        } else {
+            fprintf(stderr, " %10s", "-");
+        }
+        for (int c = 0; c < NUM_COUNTERS && counters; c++) {
+            if (phase->delta.counted) {
+                fprintf(stderr, " %15llu", (unsigned long long)phase->delta.counters[c]);
+                total.counters[c] += phase->delta.counters[c];
+            } else {
+                fprintf(stderr, " %15s", "-");
+            }
+        }
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "%-10s %10.6f %10.6f %10s", "total", total.wall, total.cpu, "");
+    for (int c = 0; c < NUM_COUNTERS && counters; c++) {
+        fprintf(stderr, " %15llu", (unsigned long long)total.counters[c]);
+    }
+    fprintf(stderr, "\n");
+
+    if (profile->num_iterations > 0) {
+        const int count = profile->num_iterations;
+        double *sorted = malloc(count * sizeof(double));
+        if (!sorted) {
+            perror("Failed to allocate memory for the profile");
+            exit(1);
+        }
+        memcpy(sorted, profile->iterations, count * sizeof(double));
+        qsort(sorted, count, sizeof(double), compare_doubles);
+        fprintf(stderr, "Markov chain iterations: %d, min %.3f ms, median %.3f ms, max %.3f ms\n",
+                count, sorted[0] * 1e3, sorted[count / 2] * 1e3, sorted[count - 1] * 1e3);
+        free(sorted);
+    }
+    fprintf(stderr, "Peak RSS: %.1f MB\n", peak_rss_kib * 1024 / 1e6);
+}
+
+static void write_json(const Profile* profile, long peak_rss_kib, FILE* out) {
+    fprintf(out, "{\n  \"phases\": [");
+    for (int p = 0; p < profile->num_phases; p++) {
+        const Phase *phase = &profile->phases[p];
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"wall_s\": %.9f, \"cpu_s\": %.9f",
+                p ? "," : "", phase->name, phase->delta.wall, phase->delta.cpu);
+        if (phase->heap_end >= 0) {
+            fprintf(out, ", \"heap_delta_bytes\": %lld, \"heap_bytes\": %lld",
+                    phase->delta.heap, phase->heap_end);
+        } else {
+            fprintf(out, ", \"heap_delta_bytes\": null, \"heap_bytes\": null");
+        }
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (phase->delta.counted) {
+                fprintf(out, ", \"%s\": %llu", counter_names[c], (unsigned long long)phase->delta.counters[c]);
+            } else {
+                fprintf(out, ", \"%s\": null", counter_names[c]);
+            }
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ],\n  \"markov_iterations_s\": [");
+    for (int k = 0; k < profile->num_iterations; k++) {
+        fprintf(out, "%s%.9f", k ? ", " : "", profile->iterations[k]);
+    }
+    fprintf(out, "],\n  \"peak_rss_bytes\": %lld\n}\n", (long long)peak_rss_kib * 1024);
+}
+
+void profile_report(Profile* profile, const char* path) {
+    if (!profile) {
+        return;
+    }
+    end_phase(profile);
+    struct rusage usage;
+    long peak_rss_kib = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+    if (!path) {
+        print_table(profile, peak_rss_kib);
+        return;
+    }
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror("Error opening profile file");
+        exit(1);
+    }
+    write_json(profile, peak_rss_kib, out);
+    if (fclose(out) != 0) {
+        perror("Error writing profile file");
+        exit(1);
+    }
+}
+
+void profile_free(Profile* profile) {
+    if (!profile) {
+        return;
+    }
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (profile->counter_fds[c] >= 0) close(profile->counter_fds[c]);
+    }
+    free(profile->phases);
+    free(profile->iterations);
+    free(profile);
+}
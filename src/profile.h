@@ -0,0 +1,27 @@
+#ifndef _INC_PROFILE_H
+#define _INC_PROFILE_H
+
+// Phase timers of --profile: wall and CPU time, heap growth and, where
+// perf_event_open() is permitted, hardware counters of each phase of a
+// run. All functions accept a NULL profile and then do nothing, so the
+// call sites need no checks.
+typedef struct Profile Profile;
+
+// Start measuring; the hardware counters are opened here and left out
+// quietly if the kernel or the machine does not provide them
+Profile* profile_create(void);
+
+// End the current phase (if any) and start the next one; NULL only ends
+// the current one. Phases may repeat and are reported in order.
+void profile_phase(Profile* profile, const char* name);
+
+// Record the wall time of each iteration of the Markov chain (copied)
+void profile_iterations(Profile* profile, const double* seconds, int count);
+
+// End the current phase and write the report: a table on stderr, or JSON
+// to path if it is not NULL. Exits if path cannot be written.
+void profile_report(Profile* profile, const char* path);
+
+void profile_free(Profile* profile);
+
+#endif /* !_INC_PROFILE_H */
@@ -0,0 +1,149 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "rankfile.h"
+#include "error.h"
+
+
+#define SECTION_ALIGN 8
+
+int parse_rank_format(const char* name, RankFormat* format) {
+    static const char *names[] = { "text", "raw", "columnar" };
+    for (int f = 0; f < (int)(sizeof(names) / sizeof(names[0])); f++) {
+        if (strcmp(name, names[f]) == 0) {
+            *format = (RankFormat)f;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int host_is_little_endian() {
+    const uint16_t one = 1;
+    return *(const unsigned char *)&one == 1;
+}
+
+// Copy count 64-bit values to little-endian order, widening from width
+// bytes (sizeof(size_t) or 8)
+static unsigned char* to_little_endian(const void* data, size_t count, size_t width) {
+    unsigned char *out = malloc((count ? count : 1) * 8);
+    if (!out) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for rank output");
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint64_t value;
+        if (width == 8) {
+            memcpy(&value, (const char *)data + i * 8, 8);
+        } else {
+            value = ((const size_t *)data)[i];
+        }
+        for (int b = 0; b < 8; b++) {
+            out[i * 8 + b] = (unsigned char)(value >> (8 * b));
+        }
+    }
+    return out;
+}
+
+// Write all iovecs, continuing after partial writes
+static void writev_all(int fd, struct iovec* iov, int count, const char* name) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            fail(PAGERANK_ERROR_IO, "Could not write ranks to %s: %s", name, strerror(errno));
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+void write_rank_file(Graph* graph, const double* ranks, int num_vectors, RankFormat format,
+                     int fd, const char* name) {
+    const size_t num_nodes = graph->num_nodes;
+    const size_t num_ranks = num_nodes * num_vectors;
+    const uint64_t zero_offset = 0;
+
+    // On little-endian hosts with a 64-bit size_t the in-memory arrays
+    // already have the file layout and are written without copying
+    const int native = host_is_little_endian() && sizeof(size_t) == 8;
+    unsigned char *ranks_le = NULL, *offsets_le = NULL;
+    const void *rank_data = ranks, *offset_data = graph->ids.offsets;
+    if (!native) {
+        rank_data = ranks_le = to_little_endian(ranks, num_ranks, 8);
+    }
+    Guard guards[2];
+    guard_push(&guards[0], free, ranks_le);
+    // An empty ID table has not allocated its offsets yet
+    if (!graph->ids.offsets) {
+        offset_data = &zero_offset;
+    } else if (!native) {
+        offset_data = offsets_le = to_little_endian(graph->ids.offsets, num_nodes + 1, sizeof(size_t));
+    }
+    guard_push(&guards[1], free, offsets_le);
+
+    static const char padding[SECTION_ALIGN];
+    struct iovec iov[2 * (RANKFILE_NUM_SECTIONS + 1)];
+    int num_iov = 0;
+    RankFileHeader header;
+
+    if (format == RANKS_RAW) {
+        iov[num_iov++] = (struct iovec){ (void *)rank_data, num_ranks * sizeof(double) };
+    } else {
+        const void *data[RANKFILE_NUM_SECTIONS] = {
+            [RANKFILE_ID_OFFSETS] = offset_data,
+            [RANKFILE_ID_BYTES] = graph->ids.arena,
+            [RANKFILE_RANKS] = rank_data,
+        };
+        const size_t sizes[RANKFILE_NUM_SECTIONS] = {
+            [RANKFILE_ID_OFFSETS] = (num_nodes + 1) * 8,
+            [RANKFILE_ID_BYTES] = graph->ids.arena_len,
+            [RANKFILE_RANKS] = num_ranks * sizeof(double),
+        };
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RANKFILE_MAGIC, sizeof(RANKFILE_MAGIC));
+        header.version = RANKFILE_VERSION;
+        header.num_vectors = num_vectors;
+        header.num_nodes = num_nodes;
+        uint64_t position = (sizeof(header) + SECTION_ALIGN - 1) & ~(uint64_t)(SECTION_ALIGN - 1);
+        iov[num_iov++] = (struct iovec){ &header, sizeof(header) };
+        iov[num_iov++] = (struct iovec){ (void *)padding, position - sizeof(header) };
+        for (int s = 0; s < RANKFILE_NUM_SECTIONS; s++) {
+            header.sections[s].offset = position;
+            header.sections[s].size = sizes[s];
+            uint64_t end = (position + sizes[s] + SECTION_ALIGN - 1) & ~(uint64_t)(SECTION_ALIGN - 1);
+            iov[num_iov++] = (struct iovec){ (void *)data[s], sizes[s] };
+            iov[num_iov++] = (struct iovec){ (void *)padding, end - position - sizes[s] };
+            position = end;
+        }
+        if (!host_is_little_endian()) {
+            // num_nodes and the sections are consecutive 64-bit fields
+            uint32_t fields32[2] = { header.version, header.num_vectors };
+            unsigned char *le = to_little_endian(&header.num_nodes, 1 + 2 * RANKFILE_NUM_SECTIONS, 8);
+            memcpy(&header.num_nodes, le, (1 + 2 * RANKFILE_NUM_SECTIONS) * 8);
+            free(le);
+            unsigned char *p = (unsigned char *)&header.version;
+            for (int f = 0; f < 2; f++) {
+                for (int b = 0; b < 4; b++) {
+                    p[f * 4 + b] = (unsigned char)(fields32[f] >> (8 * b));
+                }
+            }
+        }
+    }
+
+    writev_all(fd, iov, num_iov, name);
+    guard_pop_memory(guards, 2);
+    free(ranks_le);
+    free(offsets_le);
+}
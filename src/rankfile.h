@@ -0,0 +1,53 @@
+#ifndef _INC_RANKFILE_H
+#define _INC_RANKFILE_H
+
+#include <stdint.h>
+#include "graph.h"
+
+// Binary rank output for other programs, which can map it and use it
+// without parsing. Unlike snapshots, all numbers are little-endian with
+// fixed widths, independent of the host.
+//
+// raw: the bare float64 ranks, node-major (num_nodes x num_vectors), in
+// node index order, i.e. aligned with the ID table of the graph's snapshot
+// (see --save-binary) and of a columnar file.
+//
+// columnar: a RankFileHeader followed by 8-byte aligned sections with the
+// IDs and the ranks, so the file is self-contained.
+
+typedef enum {
+    RANKS_TEXT,         // "<id>\t<rank>..." lines sorted by ID
+    RANKS_RAW,
+    RANKS_COLUMNAR,
+} RankFormat;
+
+#define RANKFILE_MAGIC "PRRANKS"
+#define RANKFILE_VERSION 1
+
+enum {
+    RANKFILE_ID_OFFSETS,    // uint64[num_nodes + 1], into the ID bytes
+    RANKFILE_ID_BYTES,      // NUL-terminated IDs back to back, in index order
+    RANKFILE_RANKS,         // float64[num_nodes * num_vectors], node-major
+    RANKFILE_NUM_SECTIONS
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_vectors;
+    uint64_t num_nodes;
+    struct {
+        uint64_t offset;    // from the start of the file
+        uint64_t size;      // in bytes
+    } sections[RANKFILE_NUM_SECTIONS];
+} RankFileHeader;
+
+// Map a format name as given on the command line; returns 0 if unknown
+int parse_rank_format(const char* name, RankFormat* format);
+
+// Write the ranks of all nodes in a binary format to the file descriptor
+// with a single writev(); fails on I/O errors. name is used in messages.
+void write_rank_file(Graph* graph, const double* ranks, int num_vectors, RankFormat format,
+                     int fd, const char* name);
+
+#endif /* !_INC_RANKFILE_H */
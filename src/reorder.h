@@ -0,0 +1,38 @@
+#ifndef _INC_REORDER_H
+#define _INC_REORDER_H
+
+#include <stdio.h>
+#include "graph.h"
+
+// Renumbering of the nodes for better cache locality of the rank
+// iteration. The IDs move with their nodes (see permute_graph()), so the
+// output does not change; only the node index order does, e.g. in raw
+// rank files and in snapshots written afterwards.
+typedef enum {
+    REORDER_NONE,
+    REORDER_DEGREE,     // by total degree, hubs first
+    REORDER_RCM,        // reverse Cuthill-McKee on the undirected graph
+    REORDER_COMMUNITY,  // label propagation communities kept together
+    NUM_REORDER_METHODS
+} ReorderMethod;
+
+typedef struct {
+    ReorderMethod method;
+    double seconds;             // computing the order and permuting
+    double gap_before;          // mean bits of |source - target| per edge
+    double gap_after;
+    double sweep_before;        // seconds of one pull sweep over the in-edges
+    double sweep_after;
+} ReorderStats;
+
+// Map a method name as given on the command line; returns 0 if unknown
+int parse_reorder_method(const char* name, ReorderMethod* method);
+
+// Compute the order with the given method and permute the graph. The
+// sweep times are only measured if probe is set.
+void reorder_graph(Graph* graph, ReorderMethod method, int probe, ReorderStats* stats);
+
+// Print the cost of the reordering next to the saving per sweep
+void print_reorder_stats(FILE* file, const ReorderStats* stats);
+
+#endif /* !_INC_REORDER_H */
@@ -0,0 +1,658 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "server.h"
+#include "utils.h"
+
+
+// Converged vectors kept; the least recently used one is dropped first
+#define CACHE_ENTRIES 32
+
+// Open connections; further clients wait in the listen backlog
+#define MAX_CONNECTIONS 1024
+
+// Longer request lines are refused and end the connection
+#define MAX_REQUEST 65536
+
+// Seconds a connection may stay without a complete request, or a response
+// may wait for the client to read it, before the connection is closed
+#define IDLE_TIMEOUT 300
+
+// A converged rank vector. It stays alive while a request uses it, even
+// if it is dropped from the cache meanwhile.
+typedef struct {
+    double teleport_prob;
+    char *seeds;                // teleport set as requested, "" for none
+    double *ranks;
+    int *order;                 // nodes by rank, best first; sorted on first use
+    pthread_mutex_t order_lock;
+    int refs;                   // cache slot and requests in flight
+    unsigned long long last_used;
+} Vector;
+
+enum {
+    CONNECTION_IDLE,        // polled by the dispatcher for more requests
+    CONNECTION_QUEUED,      // complete requests, waiting for or with a worker
+    CONNECTION_CLOSED,      // done; the dispatcher closes it
+};
+
+// A client connection. Only the dispatcher reads from it; a worker answers
+// the complete request lines it has buffered.
+typedef struct {
+    int fd;
+    FILE *out;
+    char *buffer;               // received bytes not answered yet
+    size_t length;
+    size_t capacity;            // grows up to MAX_REQUEST
+    int eof;                    // the client sent everything
+    int state;
+    double last_active;
+} Connection;
+
+typedef struct {
+    PagerankEngine *engine;
+    const ServerOptions *options;
+    int num_nodes;
+
+    // The engine runs one computation at a time; lookups of node IDs only
+    // read the ID table, which no run changes
+    pthread_mutex_t engine_lock;
+
+    pthread_mutex_t cache_lock;
+    Vector *cache[CACHE_ENTRIES];
+    unsigned long long clock;
+    unsigned long long hits;
+    unsigned long long computed;
+
+    // Connections with complete requests wait in the queue for a worker;
+    // the lock also guards every connection's state
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_ready;
+    Connection *queue[MAX_CONNECTIONS];
+    int queue_head;
+    int queue_size;
+    int stopping;
+    int wake[2];                // a worker handing back a connection wakes the dispatcher
+} Server;
+
+static volatile sig_atomic_t stop_requested;
+
+static void request_stop(int signal) {
+    (void)signal;
+    stop_requested = 1;
+}
+
+static void* alloc_or_die(size_t size) {
+    void *data = malloc(size ? size : 1);
+    if (!data) {
+        perror("Failed to allocate memory for the server");
+        exit(1);
+    }
+    return data;
+}
+
+static void free_vector(Vector* vector) {
+    pthread_mutex_destroy(&vector->order_lock);
+    free(vector->seeds);
+    free(vector->ranks);
+    free(vector->order);
+    free(vector);
+}
+
+static void release_vector(Server* server, Vector* vector) {
+    pthread_mutex_lock(&server->cache_lock);
+    int unused = --vector->refs == 0;
+    pthread_mutex_unlock(&server->cache_lock);
+    if (unused) {
+        free_vector(vector);
+    }
+}
+
+// Cached vector for the parameters with a reference for the caller, or NULL
+static Vector* find_vector(Server* server, double teleport_prob, const char* seeds) {
+    Vector *found = NULL;
+    pthread_mutex_lock(&server->cache_lock);
+    for (int e = 0; e < CACHE_ENTRIES; e++) {
+        Vector *vector = server->cache[e];
+        if (vector && vector->teleport_prob == teleport_prob && strcmp(vector->seeds, seeds) == 0) {
+            vector->refs++;
+            vector->last_used = ++server->clock;
+            server->hits++;
+            found = vector;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&server->cache_lock);
+    return found;
+}
+
+// Add a new vector (with a reference for the caller) in place of the least
+// recently used one
+static void cache_vector(Server* server, Vector* vector) {
+    pthread_mutex_lock(&server->cache_lock);
+    int slot = 0;
+    for (int e = 0; e < CACHE_ENTRIES; e++) {
+        if (!server->cache[e]) {
+            slot = e;
+            break;
+        }
+        if (server->cache[e]->last_used < server->cache[slot]->last_used) {
+            slot = e;
+        }
+    }
+    Vector *evicted = server->cache[slot];
+    if (evicted && --evicted->refs > 0) {
+        evicted = NULL;
+    }
+    vector->refs = 2;
+    vector->last_used = ++server->clock;
+    server->cache[slot] = vector;
+    server->computed++;
+    pthread_mutex_unlock(&server->cache_lock);
+    if (evicted) {
+        free_vector(evicted);
+    }
+}
+
+// Run the Markov chain on the engine; the caller holds the engine lock.
+// Returns NULL with the engine's message in error if the run fails.
+static Vector* compute_vector(Server* server, double teleport_prob, const char* seeds,
+                              char* error, size_t error_size) {
+    PagerankEngine *engine = server->engine;
+    double start = server->options->verbose ? wall_time() : 0.0;
+    PagerankStatus status = pagerank_set_teleport(engine, &teleport_prob, 1);
+    if (status == PAGERANK_OK) {
+        status = pagerank_clear_seeds(engine);
+    }
+    if (status == PAGERANK_OK && *seeds) {
+        status = pagerank_add_seeds(engine, seeds);
+    }
+    if (status == PAGERANK_OK) {
+        status = pagerank_run_markov(engine);
+    }
+    double *ranks = alloc_or_die(server->num_nodes * sizeof(double));
+    if (status == PAGERANK_OK) {
+        status = pagerank_get_ranks(engine, ranks, server->num_nodes);
+    }
+    if (status != PAGERANK_OK) {
+        snprintf(error, error_size, "%s", pagerank_error(engine));
+        free(ranks);
+        return NULL;
+    }
+    Vector *vector = alloc_or_die(sizeof(Vector));
+    vector->teleport_prob = teleport_prob;
+    vector->seeds = strcpy(alloc_or_die(strlen(seeds) + 1), seeds);
+    vector->ranks = ranks;
+    vector->order = NULL;
+    pthread_mutex_init(&vector->order_lock, NULL);
+    if (server->options->verbose) {
+        fprintf(stderr, "Computed p=%g%s%s in %.3f s\n", teleport_prob * 100, *seeds ? " seeds=" : "", seeds,
+                wall_time() - start);
+    }
+    return vector;
+}
+
+// The vector for the parameters, computed unless it is cached
+static Vector* get_vector(Server* server, double teleport_prob, const char* seeds,
+                          char* error, size_t error_size) {
+    Vector *vector = find_vector(server, teleport_prob, seeds);
+    if (vector) {
+        return vector;
+    }
+    pthread_mutex_lock(&server->engine_lock);
+    // Another worker may have computed it while this one waited
+    vector = find_vector(server, teleport_prob, seeds);
+    if (!vector) {
+        vector = compute_vector(server, teleport_prob, seeds, error, error_size);
+        if (vector) {
+            cache_vector(server, vector);
+        }
+    }
+    pthread_mutex_unlock(&server->engine_lock);
+    return vector;
+}
+
+typedef struct {
+    double rank;
+    const char *id;
+    int node;
+} RankedNode;
+
+// Best rank first, equal ranks by ID, as --top prints them
+static int compare_ranked(const void* a, const void* b) {
+    const RankedNode *x = a, *y = b;
+    if (x->rank != y->rank) {
+        return x->rank > y->rank ? -1 : 1;
+    }
+    return strcmp(x->id, y->id);
+}
+
+static const int* ranking_order(Server* server, Vector* vector) {
+    pthread_mutex_lock(&vector->order_lock);
+    if (!vector->order) {
+        const int n = server->num_nodes;
+        RankedNode *nodes = alloc_or_die(n * sizeof(RankedNode));
+        for (int i = 0; i < n; i++) {
+            nodes[i] = (RankedNode){ vector->ranks[i], pagerank_node_id(server->engine, i), i };
+        }
+        qsort(nodes, n, sizeof(RankedNode), compare_ranked);
+        int *order = alloc_or_die(n * sizeof(int));
+        for (int i = 0; i < n; i++) {
+            order[i] = nodes[i].node;
+        }
+        free(nodes);
+        vector->order = order;
+    }
+    pthread_mutex_unlock(&vector->order_lock);
+    return vector->order;
+}
+
+static void print_rank(Server* server, FILE* out, const Vector* vector, int node) {
+    fprintf(out, "%s\t%.17g\n", pagerank_node_id(server->engine, node), vector->ranks[node]);
+}
+
+static void print_stats(Server* server, FILE* out) {
+    pthread_mutex_lock(&server->cache_lock);
+    int cached = 0;
+    for (int e = 0; e < CACHE_ENTRIES; e++) {
+        cached += server->cache[e] != NULL;
+    }
+    unsigned long long hits = server->hits, computed = server->computed;
+    pthread_mutex_unlock(&server->cache_lock);
+    fprintf(out, "OK 5\nnodes\t%d\nedges\t%zu\ncached\t%d\nhits\t%llu\ncomputed\t%llu\n",
+            server->num_nodes, pagerank_num_edges(server->engine), cached, hits, computed);
+}
+
+// Answer one request line; returns 0 if the connection is to be closed
+static int answer(Server* server, char* line, FILE* out) {
+    const char *delimiters = " \t\r\n";
+    char *save;
+    char *command = strtok_r(line, delimiters, &save);
+    if (!command) {
+        return 1;
+    }
+    if (strcmp(command, "quit") == 0) {
+        return 0;
+    }
+    if (strcmp(command, "stats") == 0) {
+        print_stats(server, out);
+        return 1;
+    }
+    int score = strcmp(command, "score") == 0;
+    int top = strcmp(command, "top") == 0;
+    if (!score && !top && strcmp(command, "ranks") != 0) {
+        fprintf(out, "ERR Unknown command '%s'. Use score, top, ranks, stats or quit.\n", command);
+        return 1;
+    }
+
+    double teleport_prob = server->options->teleport_prob;
+    const char *seeds = "";
+    const char *argument = NULL;
+    for (char *token; (token = strtok_r(NULL, delimiters, &save));) {
+        if (strncmp(token, "p=", 2) == 0) {
+            char *end;
+            double percent = strtod(token + 2, &end);
+            if (token[2] == '\0' || *end != '\0' || !(percent >= 0.0 && percent <= 100.0)) {
+                fprintf(out, "ERR Invalid percentage '%s'. P must be between 0 and 100.\n", token + 2);
+                return 1;
+            }
+            teleport_prob = percent / 100.0;
+        } else if (strncmp(token, "seeds=", 6) == 0) {
+            seeds = token + 6;
+        } else if (!argument && (score || top)) {
+            argument = token;
+        } else {
+            fprintf(out, "ERR Unexpected argument '%s'.\n", token);
+            return 1;
+        }
+    }
+
+    int node = -1;
+    size_t count = server->num_nodes;
+    if (score) {
+        if (!argument || (node = pagerank_node_index(server->engine, argument)) < 0) {
+            fprintf(out, "ERR Unknown node '%s'.\n", argument ? argument : "");
+            return 1;
+        }
+    } else if (top) {
+        char *end;
+        long long k = argument ? strtoll(argument, &end, 10) : 0;
+        if (!argument || *end != '\0' || k < 1) {
+            fprintf(out, "ERR Invalid number of nodes '%s'. K must be a positive integer.\n",
+                    argument ? argument : "");
+            return 1;
+        }
+        if ((unsigned long long)k < count) {
+            count = (size_t)k;
+        }
+    }
+
+    char error[512];
+    Vector *vector = get_vector(server, teleport_prob, seeds, error, sizeof(error));
+    if (!vector) {
+        fprintf(out, "ERR %s\n", error);
+        return 1;
+    }
+    if (score) {
+        fprintf(out, "OK 1\n");
+        print_rank(server, out, vector, node);
+    } else {
+        const int *order = ranking_order(server, vector);
+        fprintf(out, "OK %zu\n", count);
+        for (size_t i = 0; i < count; i++) {
+            print_rank(server, out, vector, order[i]);
+        }
+    }
+    release_vector(server, vector);
+    return 1;
+}
+
+// Answer the complete request lines of a connection and hand it back
+static void serve_requests(Server* server, Connection* connection) {
+    char *line = connection->buffer, *end = connection->buffer + connection->length;
+    char *newline;
+    int open = 1;
+    while (open && (newline = memchr(line, '\n', end - line))) {
+        *newline = '\0';
+        open = answer(server, line, connection->out) && fflush(connection->out) == 0;
+        line = newline + 1;
+    }
+    if (open && end - line == MAX_REQUEST) {
+        fprintf(connection->out, "ERR Request longer than %d bytes.\n", MAX_REQUEST);
+        fflush(connection->out);
+        open = 0;
+    }
+    connection->length = end - line;
+    memmove(connection->buffer, line, connection->length);
+
+    pthread_mutex_lock(&server->queue_lock);
+    connection->state = open && !connection->eof ? CONNECTION_IDLE : CONNECTION_CLOSED;
+    connection->last_active = wall_time();
+    pthread_mutex_unlock(&server->queue_lock);
+    char wake = 0;
+    if (write(server->wake[1], &wake, 1) < 0 && errno != EAGAIN) {
+        perror("Failed to wake the dispatcher");
+    }
+}
+
+static void* worker_main(void* arg) {
+    Server *server = arg;
+    pthread_mutex_lock(&server->queue_lock);
+    for (;;) {
+        while (server->queue_size == 0 && !server->stopping) {
+            pthread_cond_wait(&server->queue_ready, &server->queue_lock);
+        }
+        if (server->stopping) {
+            break;
+        }
+        Connection *connection = server->queue[server->queue_head];
+        server->queue_head = (server->queue_head + 1) % MAX_CONNECTIONS;
+        server->queue_size--;
+        pthread_mutex_unlock(&server->queue_lock);
+
+        serve_requests(server, connection);
+        pthread_mutex_lock(&server->queue_lock);
+    }
+    pthread_mutex_unlock(&server->queue_lock);
+    return NULL;
+}
+
+static Connection* open_connection(int fd) {
+    // A client that stops reading its responses must not hold a worker
+    struct timeval timeout = { IDLE_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int copy = dup(fd);
+    Connection *connection = alloc_or_die(sizeof(Connection));
+    *connection = (Connection){ .fd = fd, .capacity = 4096, .state = CONNECTION_IDLE, .last_active = wall_time() };
+    connection->out = copy >= 0 ? fdopen(copy, "w") : NULL;
+    if (!connection->out) {
+        perror("Failed to open a connection");
+        if (copy >= 0) close(copy);
+        close(fd);
+        free(connection);
+        return NULL;
+    }
+    connection->buffer = alloc_or_die(connection->capacity);
+    return connection;
+}
+
+static void close_connection(Connection* connection) {
+    fclose(connection->out);
+    close(connection->fd);
+    free(connection->buffer);
+    free(connection);
+}
+
+// Read what the client sent; returns whether a worker has to answer it,
+// or -1 if the connection is to be closed
+static int receive(Connection* connection) {
+    if (connection->length == connection->capacity) {
+        connection->capacity = 2 * connection->capacity < MAX_REQUEST ? 2 * connection->capacity : MAX_REQUEST;
+        char *buffer = realloc(connection->buffer, connection->capacity);
+        if (!buffer) {
+            perror("Failed to allocate memory for the server");
+            exit(1);
+        }
+        connection->buffer = buffer;
+    }
+    char *start = connection->buffer + connection->length;
+    ssize_t length = read(connection->fd, start, connection->capacity - connection->length);
+    if (length < 0) {
+        return errno == EINTR || errno == EAGAIN ? 0 : -1;
+    }
+    connection->last_active = wall_time();
+    if (length == 0) {
+        // Answer a last line without a newline, as if it had one
+        if (connection->length == 0) {
+            return -1;
+        }
+        connection->eof = 1;
+        if (connection->length < MAX_REQUEST) {
+            connection->buffer[connection->length++] = '\n';
+        }
+        return 1;
+    }
+    connection->length += length;
+    return memchr(start, '\n', length) != NULL || connection->length == MAX_REQUEST;
+}
+
+static int open_socket(const char* path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: Socket path '%s' is too long.\n", path);
+        exit(1);
+    }
+    strcpy(address.sun_path, path);
+    // A socket left behind by an earlier server; other files are kept
+    struct stat info;
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+        unlink(path);
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("Failed to create socket");
+        exit(1);
+    }
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        perror("Failed to listen on socket");
+        exit(1);
+    }
+    return listener;
+}
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void serve(PagerankEngine* engine, const ServerOptions* options) {
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.engine = engine;
+    server.options = options;
+    server.num_nodes = pagerank_num_nodes(engine);
+    pthread_mutex_init(&server.engine_lock, NULL);
+    pthread_mutex_init(&server.cache_lock, NULL);
+    pthread_mutex_init(&server.queue_lock, NULL);
+    pthread_cond_init(&server.queue_ready, NULL);
+    const int num_workers = options->num_workers;
+    if (pipe(server.wake) != 0) {
+        perror("Failed to create pipe");
+        exit(1);
+    }
+    set_nonblocking(server.wake[0]);
+    set_nonblocking(server.wake[1]);
+
+    int listener = open_socket(options->socket_path);
+    set_nonblocking(listener);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;     // without SA_RESTART, so poll() returns
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Only this thread takes the signals
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    pthread_t *threads = alloc_or_die(num_workers * sizeof(pthread_t));
+    for (int w = 0; w < num_workers; w++) {
+        if (pthread_create(&threads[w], NULL, worker_main, &server) != 0) {
+            perror("Failed to create thread");
+            exit(1);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (options->verbose) {
+        fprintf(stderr, "Serving %d nodes on %s with %d workers\n", server.num_nodes, options->socket_path,
+                num_workers);
+    }
+
+    // The dispatcher polls the idle connections and queues those with
+    // complete requests, so a worker is only busy while it answers them
+    Connection **connections = alloc_or_die(MAX_CONNECTIONS * sizeof(Connection *));
+    struct pollfd *polled = alloc_or_die((MAX_CONNECTIONS + 2) * sizeof(struct pollfd));
+    Connection **polled_connections = alloc_or_die(MAX_CONNECTIONS * sizeof(Connection *));
+    int num_connections = 0;
+    while (!stop_requested) {
+        // Close finished and expired connections, poll the idle ones
+        double now = wall_time(), expiry = 0.0;
+        int num_polled = 0, kept = 0;
+        polled[num_polled++] = (struct pollfd){ .fd = server.wake[0], .events = POLLIN };
+        if (num_connections < MAX_CONNECTIONS) {
+            polled[num_polled++] = (struct pollfd){ .fd = listener, .events = POLLIN };
+        }
+        const int first_connection = num_polled;
+        pthread_mutex_lock(&server.queue_lock);
+        for (int c = 0; c < num_connections; c++) {
+            Connection *connection = connections[c];
+            if (connection->state == CONNECTION_CLOSED ||
+                (connection->state == CONNECTION_IDLE && now - connection->last_active >= IDLE_TIMEOUT)) {
+                close_connection(connection);
+                continue;
+            }
+            connections[kept++] = connection;
+            if (connection->state == CONNECTION_IDLE) {
+                if (expiry == 0.0 || connection->last_active < expiry) {
+                    expiry = connection->last_active;
+                }
+                polled_connections[num_polled - first_connection] = connection;
+                polled[num_polled++] = (struct pollfd){ .fd = connection->fd, .events = POLLIN };
+            }
+        }
+        pthread_mutex_unlock(&server.queue_lock);
+        num_connections = kept;
+
+        int timeout = expiry > 0.0 ? (int)((expiry + IDLE_TIMEOUT - now) * 1000) + 1 : -1;
+        if (poll(polled, num_polled, timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to wait for requests");
+            break;
+        }
+        if (polled[0].revents) {
+            char drain[64];
+            while (read(server.wake[0], drain, sizeof(drain)) > 0) {}
+        }
+        if (first_connection == 2 && polled[1].revents) {
+            int fd = accept(listener, NULL, NULL);
+            Connection *connection = fd >= 0 ? open_connection(fd) : NULL;
+            if (connection) {
+                connections[num_connections++] = connection;
+            } else if (fd < 0 && errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+                perror("Failed to accept connection");
+                break;
+            }
+        }
+        for (int p = first_connection; p < num_polled; p++) {
+            if (!polled[p].revents) {
+                continue;
+            }
+            Connection *connection = polled_connections[p - first_connection];
+            int received = receive(connection);
+            pthread_mutex_lock(&server.queue_lock);
+            if (received < 0) {
+                connection->state = CONNECTION_CLOSED;
+            } else if (received > 0) {
+                connection->state = CONNECTION_QUEUED;
+                server.queue[(server.queue_head + server.queue_size) % MAX_CONNECTIONS] = connection;
+                server.queue_size++;
+                pthread_cond_signal(&server.queue_ready);
+            }
+            pthread_mutex_unlock(&server.queue_lock);
+        }
+    }
+    close(listener);
+    unlink(options->socket_path);
+
+    // Cut off the connections being answered and drop the waiting ones
+    pthread_mutex_lock(&server.queue_lock);
+    server.stopping = 1;
+    for (int c = 0; c < num_connections; c++) {
+        shutdown(connections[c]->fd, SHUT_RDWR);
+    }
+    pthread_cond_broadcast(&server.queue_ready);
+    pthread_mutex_unlock(&server.queue_lock);
+    for (int w = 0; w < num_workers; w++) {
+        pthread_join(threads[w], NULL);
+    }
+    for (int c = 0; c < num_connections; c++) {
+        close_connection(connections[c]);
+    }
+    if (options->verbose) {
+        fprintf(stderr, "Served %llu cached and %llu computed vectors\n", server.hits, server.computed);
+    }
+
+    for (int e = 0; e < CACHE_ENTRIES; e++) {
+        if (server.cache[e]) {
+            free_vector(server.cache[e]);
+        }
+    }
+    free(connections);
+    free(polled);
+    free(polled_connections);
+    free(threads);
+    close(server.wake[0]);
+    close(server.wake[1]);
+    pthread_cond_destroy(&server.queue_ready);
+    pthread_mutex_destroy(&server.queue_lock);
+    pthread_mutex_destroy(&server.cache_lock);
+    pthread_mutex_destroy(&server.engine_lock);
+}
@@ -0,0 +1,39 @@
+#ifndef _INC_SERVER_H
+#define _INC_SERVER_H
+
+#include "pagerank.h"
+
+// Resident ranking server (--serve). Clients connect to a Unix stream
+// socket and send one request per line:
+//
+//   score ID [p=P] [seeds=LIST]    rank of one node
+//   top K [p=P] [seeds=LIST]       the K best nodes, best first
+//   ranks [p=P] [seeds=LIST]       all nodes, best first
+//   stats                          graph size and cache counters
+//   quit                           close the connection
+//
+// P is the teleportation percentage (default: -p) and LIST a teleport set
+// as for --seeds. A response is "OK N" followed by N lines "ID<TAB>RANK"
+// (full precision) or "NAME<TAB>VALUE" for stats, or a single line
+// "ERR message". Converged vectors are cached per parameter set, so only
+// the first query with new parameters runs the Markov chain.
+//
+// Requests are dispatched one at a time, so any number of open connections
+// (up to 1024) share the workers. A connection without a complete request
+// for 5 minutes is closed, as is one whose responses are not read for as
+// long; request lines are limited to 64 KiB.
+
+typedef struct {
+    const char *socket_path;
+    int num_workers;            // requests answered at the same time
+    double teleport_prob;       // for requests without p=
+    int verbose;                // report connections and computations on stderr
+} ServerOptions;
+
+// Listen on options->socket_path (replacing a stale socket there) and
+// answer requests with the graph and settings of engine until SIGINT or
+// SIGTERM arrives; open connections are closed then. Exits if the socket
+// cannot be set up.
+void serve(PagerankEngine* engine, const ServerOptions* options);
+
+#endif /* !_INC_SERVER_H */
@@ -0,0 +1,316 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "graph.h"
+#include "error.h"
+
+
+#define BYTE_ORDER_MARK 0x01020304u
+#define SECTION_ALIGN 8
+
+int is_snapshot_file(const char* filename) {
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        return 0;
+    }
+    int match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return match;
+}
+
+static void write_or_die(FILE* file, const void* data, size_t size, const char* filename) {
+    if (size && fwrite(data, 1, size, file) != size) {
+        fail(PAGERANK_ERROR_IO, "Could not write snapshot %s", filename);
+    }
+}
+
+void save_snapshot(Graph* graph, const char* filename) {
+    size_t num_nodes = graph->num_nodes;
+    size_t zero_offset = 0;
+
+    int *out_degrees = malloc((num_nodes ? num_nodes : 1) * sizeof(int));
+    if (!out_degrees) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for snapshot");
+    }
+    Guard degrees_guard;
+    guard_push(&degrees_guard, free, out_degrees);
+    for (int i = 0; i < graph->num_nodes; i++) {
+        out_degrees[i] = out_degree(graph, i);
+    }
+
+    const void *data[NUM_SECTIONS] = {
+        [SECTION_OUT_OFFSETS] = graph->out_offsets,
+        [SECTION_OUT_TARGETS] = graph->out_targets,
+        [SECTION_IN_OFFSETS] = graph->in_offsets,
+        [SECTION_IN_SOURCES] = graph->in_sources,
+        [SECTION_OUT_DEGREES] = out_degrees,
+        // An empty ID table has not allocated its offsets yet
+        [SECTION_ID_OFFSETS] = graph->ids.offsets ? (const void *)graph->ids.offsets : &zero_offset,
+        [SECTION_ID_ARENA] = graph->ids.arena,
+        [SECTION_ID_SLOTS] = graph->ids.slots,
+        [SECTION_PACKED_INDEX] = graph->packed_index,
+        [SECTION_PACKED_SOURCES] = graph->packed_sources,
+    };
+    const int packed = graph->packed_sources != NULL;
+    const size_t sizes[NUM_SECTIONS] = {
+        [SECTION_OUT_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [SECTION_OUT_TARGETS] = graph->num_edges * sizeof(int),
+        [SECTION_IN_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [SECTION_IN_SOURCES] = packed ? 0 : graph->num_edges * sizeof(int),
+        [SECTION_OUT_DEGREES] = num_nodes * sizeof(int),
+        [SECTION_ID_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [SECTION_ID_ARENA] = graph->ids.arena_len,
+        [SECTION_ID_SLOTS] = graph->ids.num_slots * sizeof(int),
+        [SECTION_PACKED_INDEX] = packed ? packed_index_length(num_nodes) * sizeof(size_t) : 0,
+        [SECTION_PACKED_SOURCES] = packed ? graph->packed_index[packed_index_length(num_nodes) - 1] + PACKED_PADDING : 0,
+    };
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.offset_size = sizeof(size_t);
+    header.index_size = sizeof(int);
+    header.num_nodes = num_nodes;
+    header.num_edges = graph->num_edges;
+    header.num_slots = graph->ids.num_slots;
+    memcpy(header.name, graph->name, sizeof(header.name));
+
+    uint64_t position = (sizeof(header) + SECTION_ALIGN - 1) & ~(uint64_t)(SECTION_ALIGN - 1);
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        header.sections[s].offset = position;
+        header.sections[s].size = sizes[s];
+        position = (position + sizes[s] + SECTION_ALIGN - 1) & ~(uint64_t)(SECTION_ALIGN - 1);
+    }
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        fail(PAGERANK_ERROR_IO, "Could not open file %s", filename);
+    }
+    Guard file_guard;
+    guard_push(&file_guard, release_file, file);
+    static const char padding[SECTION_ALIGN];
+    write_or_die(file, &header, sizeof(header), filename);
+    uint64_t written = sizeof(header);
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        write_or_die(file, padding, header.sections[s].offset - written, filename);
+        write_or_die(file, data[s], sizes[s], filename);
+        written = header.sections[s].offset + sizes[s];
+    }
+    write_or_die(file, padding, position - written, filename);
+    guard_pop(&file_guard);
+    if (fclose(file) != 0) {
+        fail(PAGERANK_ERROR_IO, "Could not write snapshot %s", filename);
+    }
+    guard_pop(&degrees_guard);
+    free(out_degrees);
+}
+
+static _Noreturn void bad_snapshot(const char* filename, const char* reason) {
+    fail(PAGERANK_ERROR_FORMAT, "Invalid snapshot '%s': %s", filename, reason);
+}
+
+// offsets[0 .. count] must rise from 0 to end, so every range lies in its section
+static int offsets_valid(const size_t* offsets, size_t count, size_t end) {
+    if (offsets[0] != 0 || offsets[count] != end) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int indices_valid(const int* indices, size_t count, int num_nodes) {
+    for (size_t e = 0; e < count; e++) {
+        if ((unsigned)indices[e] >= (unsigned)num_nodes) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Decode every packed list as the kernels do, checking that the groups stay
+// within the data, the strides start where packed_index says and every
+// source is a node
+static int packed_valid(const Graph* graph) {
+    const size_t length = packed_index_length(graph->num_nodes);
+    const size_t *index = graph->packed_index;
+    if (index[0] != 0) {
+        return 0;
+    }
+    for (size_t c = 0; c + 1 < length; c++) {
+        if (index[c] > index[c + 1]) {
+            return 0;
+        }
+    }
+    const unsigned char *data = graph->packed_sources, *end = data + index[length - 1];
+    const unsigned char *p = data;
+    for (int j = 0; j < graph->num_nodes; j++) {
+        if (j % PACKED_INDEX_STRIDE == 0 && (size_t)(p - data) != index[j / PACKED_INDEX_STRIDE]) {
+            return 0;
+        }
+        size_t begin = graph->in_offsets[j], stop = graph->in_offsets[j + 1];
+        uint32_t source = (uint32_t)j, values[4];
+        for (size_t e = begin; e < stop; e += 4) {
+            int count = stop - e < 4 ? (int)(stop - e) : 4;
+            if (p >= end) {
+                return 0;
+            }
+            size_t bytes = 1;
+            for (int i = 0; i < count; i++) {
+                bytes += ((*p >> (2 * i)) & 3) + 1;
+            }
+            // read_group() may read PACKED_PADDING bytes past the group
+            if (bytes > (size_t)(end - p)) {
+                return 0;
+            }
+            p = read_group(p, count, values);
+            if (e == begin) values[0] = zigzag_decode(values[0]);
+            for (int i = 0; i < count; i++) {
+                source += values[i];
+                if (source >= (uint32_t)graph->num_nodes) {
+                    return 0;
+                }
+            }
+        }
+    }
+    return p == end;
+}
+
+size_t load_snapshot(Graph* graph, const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fail(PAGERANK_ERROR_IO, "Could not open file %s", filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    size_t size = st.st_size;
+    if (size < offsetof(SnapshotHeader, sections[SNAPSHOT_V1_SECTIONS])) {
+        close(fd);
+        bad_snapshot(filename, "truncated header");
+    }
+
+    char *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fail(PAGERANK_ERROR_IO, "File is empty or could not be read: %s", filename);
+    }
+    // The graph takes the mapping over once the file has proven valid
+    Graph mapped;
+    init_graph(&mapped);
+    mapped.mapping = data;
+    mapped.mapping_size = size;
+    Guard mapping_guard;
+    guard_push(&mapping_guard, release_graph, &mapped);
+
+    // A version 1 header is a prefix of the current one; its missing
+    // sections are empty
+    SnapshotHeader copy;
+    const SnapshotHeader *header = (const SnapshotHeader *)data;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        bad_snapshot(filename, "bad magic");
+    }
+    if (header->version == 1) {
+        memset(&copy, 0, sizeof(copy));
+        memcpy(&copy, data, offsetof(SnapshotHeader, sections[SNAPSHOT_V1_SECTIONS]));
+        header = &copy;
+    } else if (header->version != SNAPSHOT_VERSION) {
+        bad_snapshot(filename, "unsupported version");
+    } else if (size < sizeof(SnapshotHeader)) {
+        bad_snapshot(filename, "truncated header");
+    }
+    if (header->byte_order != BYTE_ORDER_MARK || header->offset_size != sizeof(size_t) ||
+        header->index_size != sizeof(int)) {
+        bad_snapshot(filename, "written on an incompatible host");
+    }
+    if (header->num_nodes > INT_MAX || header->num_slots > INT_MAX || header->num_edges > size ||
+        memchr(header->name, '\0', sizeof(header->name)) == NULL) {
+        bad_snapshot(filename, "corrupt header");
+    }
+
+    uint64_t num_nodes = header->num_nodes, num_edges = header->num_edges;
+    const int packed = header->sections[SECTION_PACKED_INDEX].size != 0;
+    const uint64_t expected[NUM_SECTIONS] = {
+        [SECTION_OUT_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [SECTION_OUT_TARGETS] = num_edges * sizeof(int),
+        [SECTION_IN_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [SECTION_IN_SOURCES] = packed ? 0 : num_edges * sizeof(int),
+        [SECTION_OUT_DEGREES] = num_nodes * sizeof(int),
+        [SECTION_ID_OFFSETS] = (num_nodes + 1) * sizeof(size_t),
+        [SECTION_ID_ARENA] = header->sections[SECTION_ID_ARENA].size,
+        [SECTION_ID_SLOTS] = header->num_slots * sizeof(int),
+        [SECTION_PACKED_INDEX] = packed ? packed_index_length(num_nodes) * sizeof(size_t) : 0,
+        [SECTION_PACKED_SOURCES] = header->sections[SECTION_PACKED_SOURCES].size,
+    };
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        const SnapshotSection *section = &header->sections[s];
+        if (section->size != expected[s] ||
+            section->offset % SECTION_ALIGN != 0 || section->offset > size ||
+            section->size > size - section->offset) {
+            bad_snapshot(filename, "section out of bounds");
+        }
+    }
+
+    const size_t *out_offsets = (const size_t *)(data + header->sections[SECTION_OUT_OFFSETS].offset);
+    const size_t *in_offsets = (const size_t *)(data + header->sections[SECTION_IN_OFFSETS].offset);
+    const size_t *id_offsets = (const size_t *)(data + header->sections[SECTION_ID_OFFSETS].offset);
+    const char *arena = data + header->sections[SECTION_ID_ARENA].offset;
+    size_t arena_len = header->sections[SECTION_ID_ARENA].size;
+    const size_t *packed_index = (const size_t *)(data + header->sections[SECTION_PACKED_INDEX].offset);
+    if (packed && packed_index[packed_index_length(num_nodes) - 1] + PACKED_PADDING !=
+                  header->sections[SECTION_PACKED_SOURCES].size) {
+        bad_snapshot(filename, "inconsistent sections");
+    }
+
+    memcpy(mapped.name, header->name, sizeof(mapped.name));
+    mapped.num_nodes = (int)num_nodes;
+    mapped.num_edges = num_edges;
+    mapped.out_offsets = (size_t *)out_offsets;
+    mapped.out_targets = (int *)(data + header->sections[SECTION_OUT_TARGETS].offset);
+    mapped.in_offsets = (size_t *)in_offsets;
+    if (packed) {
+        mapped.packed_index = (size_t *)packed_index;
+        mapped.packed_sources = (unsigned char *)(data + header->sections[SECTION_PACKED_SOURCES].offset);
+    } else {
+        mapped.in_sources = (int *)(data + header->sections[SECTION_IN_SOURCES].offset);
+    }
+    mapped.ids.arena = (char *)arena;
+    mapped.ids.arena_len = arena_len;
+    mapped.ids.offsets = (size_t *)id_offsets;
+    mapped.ids.num_ids = (int)num_nodes;
+    mapped.ids.slots = (int *)(data + header->sections[SECTION_ID_SLOTS].offset);
+    mapped.ids.num_slots = header->num_slots;
+
+    // A corrupt file must not make the sweeps or ID lookups read out of
+    // bounds: check every offset (O(V)) and every node index (O(E))
+    if (!offsets_valid(out_offsets, num_nodes, num_edges) || !offsets_valid(in_offsets, num_nodes, num_edges) ||
+        !idtable_valid(&mapped.ids)) {
+        bad_snapshot(filename, "inconsistent sections");
+    }
+    if (!indices_valid(mapped.out_targets, num_edges, mapped.num_nodes) ||
+        (packed ? !packed_valid(&mapped) : !indices_valid(mapped.in_sources, num_edges, mapped.num_nodes))) {
+        bad_snapshot(filename, "node index out of range");
+    }
+
+    guard_pop(&mapping_guard);
+    *graph = mapped;
+    return size;
+}
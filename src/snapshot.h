@@ -0,0 +1,68 @@
+#ifndef _INC_SNAPSHOT_H
+#define _INC_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "graph.h"
+
+// Binary graph snapshot (.prg)
+//
+// A fixed header followed by 8-byte aligned sections holding the sparse
+// store and the interned ID table exactly as they are laid out in memory,
+// so a snapshot can be mapped and used in place. All integers are in host
+// byte order; the header records the byte order and the integer widths, and
+// a snapshot written on an incompatible host is rejected.
+
+#define SNAPSHOT_MAGIC "PRGRAPH"
+#define SNAPSHOT_VERSION 2
+
+enum {
+    SECTION_OUT_OFFSETS,    // size_t[num_nodes + 1]
+    SECTION_OUT_TARGETS,    // int[num_edges]
+    SECTION_IN_OFFSETS,     // size_t[num_nodes + 1]
+    SECTION_IN_SOURCES,     // int[num_edges], empty if the graph is packed
+    SECTION_OUT_DEGREES,    // int[num_nodes]
+    SECTION_ID_OFFSETS,     // size_t[num_nodes + 1], into the ID arena
+    SECTION_ID_ARENA,       // NUL-terminated IDs back to back
+    SECTION_ID_SLOTS,       // int[num_slots], the ID hash table
+    // Version 2: the packed CSC (see pack_graph()), empty if not packed
+    SECTION_PACKED_INDEX,   // size_t[packed_index_length(num_nodes)]
+    SECTION_PACKED_SOURCES, // group varints, followed by PACKED_PADDING zero bytes
+    NUM_SECTIONS
+};
+
+// Version 1 snapshots end the header after the ID slots section
+#define SNAPSHOT_V1_SECTIONS (SECTION_ID_SLOTS + 1)
+
+typedef struct {
+    uint64_t offset;        // from the start of the file
+    uint64_t size;          // in bytes
+} SnapshotSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;    // 0x01020304 as written by the host
+    uint32_t offset_size;   // sizeof(size_t)
+    uint32_t index_size;    // sizeof(int)
+    uint64_t num_nodes;
+    uint64_t num_edges;
+    uint64_t num_slots;
+    char name[MAX_ID_LENGTH];
+    SnapshotSection sections[NUM_SECTIONS];
+} SnapshotHeader;
+
+// Check whether the file starts with the snapshot magic
+int is_snapshot_file(const char* filename);
+
+// Write a finalized graph to a snapshot file; fails on I/O errors
+void save_snapshot(Graph* graph, const char* filename);
+
+// Map a snapshot file and let the graph use it in place. Besides the header
+// and the section bounds, every offset and node index is checked in one
+// sequential pass, so a corrupt file cannot make the solvers read out of
+// bounds. Fails (see fail()) on malformed files. Returns the size of the
+// file.
+size_t load_snapshot(Graph* graph, const char* filename);
+
+#endif /* !_INC_SNAPSHOT_H */
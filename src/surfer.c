@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "surfer.h"
+#include "graph.h"
+#include "parallel.h"
+#include "utils.h"
+#include "error.h"
+
+
+// Shared state of a Monte Carlo run; walker t writes only its own row
+// counts + t * num_nodes, and the rows are summed afterwards
+typedef struct {
+    const Graph *graph;
+    const SurferOptions *options;
+    uint64_t teleport_threshold;    // teleport if rng_next(&rng) < teleport_threshold
+    uint64_t *counts;
+    unsigned long long *steps;  // per walker
+} Walkers;
+
+// Random stream of walker tid: the seed's stream advanced tid jumps, so a
+// single walker draws exactly the numbers of the serial surfer
+static void walker_rng(const Walkers* walkers, int tid, Rng* rng) {
+    rng_seed(rng, walkers->options->seed);
+    for (int t = 0; t < tid; t++) {
+        rng_jump(rng);
+    }
+}
+
+static void surfer_walker(void* arg, int tid, int num_threads) {
+    Walkers *walkers = arg;
+    const Graph *graph = walkers->graph;
+    long long steps = range_start(walkers->options->steps, tid + 1, num_threads)
+                    - range_start(walkers->options->steps, tid, num_threads);
+
+    // Everything the loop needs is hoisted out of it: each step is two
+    // random numbers and two loads from the CSR, with no allocation
+    const unsigned num_nodes = graph->num_nodes;
+    const size_t *out_offsets = graph->out_offsets;
+    const int *out_targets = graph->out_targets;
+    const uint64_t teleport_threshold = walkers->teleport_threshold;
+    uint64_t *visit_counts = walkers->counts + (size_t)tid * num_nodes;
+
+    Rng rng;
+    walker_rng(walkers, tid, &rng);
+
+    // Start at a random node
+    int current_node_index = rng_bounded(&rng, num_nodes);
+    // Note: The description often implies the *first* visit doesn't count towards rank,
+    // or that N steps means N transitions. We'll count the node landed on *after* each step.
+
+    for (long long i = 0; i < steps; ++i) {
+        size_t first = out_offsets[current_node_index];
+        unsigned degree = out_offsets[current_node_index + 1] - first;
+
+        if (rng_next(&rng) < teleport_threshold || degree == 0) {
+            // Teleport (or jump from dangling node)
+            current_node_index = rng_bounded(&rng, num_nodes);
+        } else {
+            // Follow a random outgoing link of the CSR slice
+            current_node_index = out_targets[first + rng_bounded(&rng, degree)];
+        }
+         // Increment visit count for the node *landed on*
+        visit_counts[current_node_index]++;
+    }
+    walkers->steps[tid] = steps;
+}
+
+static void path_walker(void* arg, int tid, int num_threads) {
+    Walkers *walkers = arg;
+    const Graph *graph = walkers->graph;
+    const unsigned num_nodes = graph->num_nodes;
+    const size_t *out_offsets = graph->out_offsets;
+    const int *out_targets = graph->out_targets;
+    const uint64_t teleport_threshold = walkers->teleport_threshold;
+    const int walks_per_node = walkers->options->walks_per_node;
+    uint64_t *visit_counts = walkers->counts + (size_t)tid * num_nodes;
+    unsigned long long steps = 0;
+
+    Rng rng;
+    walker_rng(walkers, tid, &rng);
+
+    int lo = range_start(num_nodes, tid, num_threads), hi = range_start(num_nodes, tid + 1, num_threads);
+    for (int start = lo; start < hi; ++start) {
+        for (int w = 0; w < walks_per_node; ++w) {
+            // Every node on the path counts, including the start; the walk
+            // ends where the surfer would teleport
+            int current_node_index = start;
+            visit_counts[current_node_index]++;
+            while (rng_next(&rng) >= teleport_threshold) {
+                size_t first = out_offsets[current_node_index];
+                unsigned degree = out_offsets[current_node_index + 1] - first;
+                current_node_index = degree == 0 ? (int)rng_bounded(&rng, num_nodes)
+                                                 : out_targets[first + rng_bounded(&rng, degree)];
+                visit_counts[current_node_index]++;
+                steps++;
+            }
+        }
+    }
+    walkers->steps[tid] = steps;
+}
+
+// A 64-bit draw below teleport_prob * 2^64 teleports with the exact
+// probability (up to 2^-64), also for fractions that are not whole percents
+static uint64_t teleport_threshold(double teleport_prob) {
+    if (teleport_prob >= 1.0) {
+        return UINT64_MAX;
+    }
+    return teleport_prob > 0.0 ? (uint64_t)ldexp(teleport_prob, 64) : 0;
+}
+
+static double* run_walkers(Graph* graph, const SurferOptions* options, SurferStats* stats,
+                           void (*walker)(void* arg, int tid, int num_threads)) {
+    memset(stats, 0, sizeof(*stats));
+    if (graph->num_nodes == 0) {
+        return NULL;
+    }
+
+    const int n = graph->num_nodes;
+    int num_threads = options->num_threads > 0 ? options->num_threads : 1;
+    uint64_t *counts = calloc((size_t)num_threads * n, sizeof(uint64_t));
+    unsigned long long *steps = calloc(num_threads, sizeof(unsigned long long));
+    double *ranks = malloc(n * sizeof(double));
+    Guard guards[3];
+    guard_memory(guards, (void *[]){ counts, steps, ranks }, 3);
+    if (!counts || !steps || !ranks) {
+        fail_errno(PAGERANK_ERROR_MEMORY, "Failed to allocate memory for visit counts");
+    }
+
+    Walkers walkers = {
+        .graph = graph,
+        .options = options,
+        .teleport_threshold = teleport_threshold(options->teleport_prob),
+        .counts = counts,
+        .steps = steps,
+    };
+    double start = wall_time();
+    run_parallel(num_threads, walker, &walkers);
+
+    // Merge the per-walker counts into row 0
+    for (int t = 1; t < num_threads; t++) {
+        const uint64_t *row = counts + (size_t)t * n;
+        for (int i = 0; i < n; ++i) {
+            counts[i] += row[i];
+        }
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < n; ++i) {
+        total += counts[i];
+    }
+    for (int t = 0; t < num_threads; t++) {
+        stats->steps += steps[t];
+    }
+    stats->seconds = wall_time() - start;
+
+    for (int i = 0; i < n; ++i) {
+        ranks[i] = total > 0 ? (double)counts[i] / total : 0.0;
+    }
+
+    guard_pop_memory(guards, 3);
+    free(counts);
+    free(steps);
+    return ranks;
+}
+
+// --- Random Surfer Simulation ---
+double* simulate_random_surfer(Graph* graph, const SurferOptions* options, SurferStats* stats) {
+    return run_walkers(graph, options, stats, surfer_walker);
+}
+
+double* simulate_random_walks(Graph* graph, const SurferOptions* options, SurferStats* stats) {
+    return run_walkers(graph, options, stats, path_walker);
+}
+
+void print_surfer_stats(FILE* file, const SurferStats* stats) {
+    fprintf(file, "Random surfer: %llu steps in %.3f s (%.1f M steps/s)\n", stats->steps,
+            stats->seconds, stats->seconds > 0 ? stats->steps / stats->seconds / 1e6 : 0.0);
+}
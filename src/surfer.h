@@ -0,0 +1,36 @@
+#ifndef _INC_SURFER_H
+#define _INC_SURFER_H
+
+#include <stdint.h>
+#include "graph.h"
+
+typedef struct {
+    double teleport_prob;
+    long long steps;        // total steps of the random surfer (-r)
+    int walks_per_node;     // walks started per node by the complete-path estimator
+    uint64_t seed;
+    int num_threads;
+} SurferOptions;
+
+typedef struct {
+    unsigned long long steps;   // steps taken by all walkers together
+    double seconds;
+} SurferStats;
+
+// Random surfer: options->steps are split across num_threads independent
+// walkers, each with its own random stream (rng_jump()) and visit counts,
+// which are merged at the end. The result is a function of the seed and
+// the number of threads. Returns the ranks (malloc'ed; NULL for an empty
+// graph).
+double* simulate_random_surfer(Graph* graph, const SurferOptions* options, SurferStats* stats);
+
+// Complete-path Monte Carlo estimator: start walks_per_node walks at every
+// node, each ending with probability p per step, and count every node
+// visited. The normalized visit counts estimate PageRank with much less
+// variance per step than one long walk. Returns the ranks like
+// simulate_random_surfer().
+double* simulate_random_walks(Graph* graph, const SurferOptions* options, SurferStats* stats);
+
+void print_surfer_stats(FILE* file, const SurferStats* stats);
+
+#endif /* !_INC_SURFER_H */
@@ -5,13 +5,14 @@
  *     Author: Clemens Hammacher <hammacher@cs.uni-saarland.de>
  */
 
+ #define _POSIX_C_SOURCE 200809L
+ 
  #include "utils.h"
 
- #include <stdlib.h>
  #include <time.h>
  #include <unistd.h>
  
- void rand_init() {
+ uint64_t rand_seed() {
    /* get three integers for seeding the RNG */
    unsigned long a = clock();
    unsigned long b = time(NULL);
@@ -29,20 +30,43 @@
    b=b-c;  b=b-a;  b=b^(a << 10);
    c=c-a;  c=c-b;  c=c^(b >> 15);
  
-   /* use this mix to initialize RNG */
-   srand(c);
+   /* use this mix to seed the RNG */
+   return c;
  }
  
- unsigned randu(unsigned max) {
-   const unsigned int buckets = RAND_MAX / max;
-   const unsigned int limit = buckets * max;
- 
-   unsigned int r;
-   do {
-     r = rand();
-   } while (r >= limit);
+ void rng_seed(Rng *rng, uint64_t seed) {
+   /* splitmix64, so that similar seeds give unrelated states */
+   for (int i = 0; i < 4; i++) {
+     uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+     z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+     z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+     rng->s[i] = z ^ (z >> 31);
+   }
+ }
  
-   return r / buckets;
+ void rng_jump(Rng *rng) {
+   static const uint64_t jump[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+   uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+   for (int i = 0; i < 4; i++) {
+     for (int b = 0; b < 64; b++) {
+       if (jump[i] & (1ULL << b)) {
+         s0 ^= rng->s[0];
+         s1 ^= rng->s[1];
+         s2 ^= rng->s[2];
+         s3 ^= rng->s[3];
+       }
+       rng_next(rng);
+     }
+   }
+   rng->s[0] = s0;
+   rng->s[1] = s1;
+   rng->s[2] = s2;
+   rng->s[3] = s3;
  }
  
- 
\ No newline at end of file
+ double wall_time() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+ }
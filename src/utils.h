@@ -8,10 +8,58 @@
  #ifndef _INC_UTILS_H
  #define _INC_UTILS_H
  
- void rand_init();
+ #include <stdint.h>
  
- // compute a value between 0 and max (exclusively)
- unsigned randu(unsigned max);
+ // xoshiro256++ generator. The state is explicit, so every thread can own
+ // one; seed it with rng_seed() and derive further independent streams
+ // with rng_jump().
+ typedef struct {
+   uint64_t s[4];
+ } Rng;
+ 
+ // default seed mixed from the clock, time and process id
+ uint64_t rand_seed();
+ 
+ // expand a 64 bit seed into a full state (via splitmix64)
+ void rng_seed(Rng *rng, uint64_t seed);
+ 
+ // advance the state by 2^128 steps, i.e. to the next non-overlapping stream
+ void rng_jump(Rng *rng);
+ 
+ static inline uint64_t rng_rotl(uint64_t x, int k) {
+   return (x << k) | (x >> (64 - k));
+ }
+ 
+ static inline uint64_t rng_next(Rng *rng) {
+   uint64_t *s = rng->s;
+   const uint64_t result = rng_rotl(s[0] + s[3], 23) + s[0];
+   const uint64_t t = s[1] << 17;
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = rng_rotl(s[3], 45);
+   return result;
+ }
+ 
+ // compute a value between 0 and max (exclusively), without bias, using
+ // Lemire's multiply-and-shift; the division only runs on rare rejections
+ static inline uint32_t rng_bounded(Rng *rng, uint32_t max) {
+   uint64_t m = (rng_next(rng) >> 32) * max;
+   uint32_t low = (uint32_t)m;
+   if (low < max) {
+     const uint32_t threshold = -max % max;
+     while (low < threshold) {
+       m = (rng_next(rng) >> 32) * max;
+       low = (uint32_t)m;
+     }
+   }
+   return m >> 32;
+ }
+ 
+ // monotonic wall-clock time in seconds
+ double wall_time();
  
  #endif /* !_INC_UTILS_H */
  
@@ -0,0 +1,70 @@
+import ctypes
+import os
+import tempfile
+from common.utils import TestFailure
+
+PAGERANK_OK = 0
+PAGERANK_ERROR_ARGUMENT = 1
+PAGERANK_ERROR_STATE = 2
+PAGERANK_ERROR_IO = 3
+PAGERANK_ERROR_FORMAT = 4
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    path = os.path.join(os.path.dirname(sut), 'libpagerank.so')
+    lib = ctypes.CDLL(path)
+    lib.pagerank_create.restype = ctypes.c_void_p
+    lib.pagerank_free.argtypes = [ctypes.c_void_p]
+    lib.pagerank_error.restype = ctypes.c_char_p
+    lib.pagerank_error.argtypes = [ctypes.c_void_p]
+    lib.pagerank_load.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.pagerank_set_teleport.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double), ctypes.c_int]
+    lib.pagerank_set_iterations.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_double]
+    lib.pagerank_apply_diff.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.pagerank_add_seeds.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.pagerank_run_markov.argtypes = [ctypes.c_void_p]
+    lib.pagerank_num_nodes.argtypes = [ctypes.c_void_p]
+    lib.pagerank_node_index.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.pagerank_get_ranks.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double), ctypes.c_size_t]
+
+    engine = lib.pagerank_create()
+    if not engine:
+        raise TestFailure('pagerank_create() failed')
+
+    def expect(status, expected, what):
+        if status != expected:
+            raise TestFailure('{} returned {} instead of {}: {}'.format(
+                what, status, expected, lib.pagerank_error(engine).decode()))
+        if verbose:
+            print('{}: {} {}'.format(what, status, lib.pagerank_error(engine).decode()))
+
+    # Failures are reported, and the engine stays usable
+    expect(lib.pagerank_run_markov(engine), PAGERANK_ERROR_STATE, 'run without graph')
+    expect(lib.pagerank_load(engine, b'../graphs/missing.dot'), PAGERANK_ERROR_IO, 'load missing file')
+    graph = os.path.join(this_dir, '../graphs/prog2graph.dot').encode()
+    expect(lib.pagerank_load(engine, graph), PAGERANK_OK, 'load')
+    expect(lib.pagerank_add_seeds(engine, b'nosuchnode'), PAGERANK_ERROR_FORMAT, 'unknown seed')
+    # A diff with a missing deletion is rejected before it changes the graph
+    with tempfile.TemporaryDirectory() as tmp:
+        diff = os.path.join(tmp, 'bad.diff')
+        with open(diff, 'w') as f:
+            f.write('+wiki -> guide;\n-forum -> CMS;\n')
+        expect(lib.pagerank_apply_diff(engine, diff.encode()), PAGERANK_ERROR_FORMAT, 'bad diff')
+    if lib.pagerank_num_nodes(engine) != 6 or lib.pagerank_node_index(engine, b'wiki') != -1:
+        raise TestFailure('A rejected diff changed the graph')
+    bad = (ctypes.c_double * 1)(1.5)
+    expect(lib.pagerank_set_teleport(engine, bad, 1), PAGERANK_ERROR_ARGUMENT, 'teleport 1.5')
+    expect(lib.pagerank_set_iterations(engine, 10000, 1e-12), PAGERANK_OK, 'iterations')
+
+    # Repeated runs on the loaded graph give the same ranks as the tool
+    num_nodes = lib.pagerank_num_nodes(engine)
+    ranks = (ctypes.c_double * num_nodes)()
+    forum = lib.pagerank_node_index(engine, b'forum')
+    for run in range(2):
+        expect(lib.pagerank_run_markov(engine), PAGERANK_OK, 'run {}'.format(run))
+        expect(lib.pagerank_get_ranks(engine, ranks, num_nodes), PAGERANK_OK, 'get ranks')
+        if abs(ranks[forum] - 0.267435) > 1e-6:
+            raise TestFailure('Unexpected rank of forum: {}'.format(ranks[forum]))
+    expect(lib.pagerank_get_ranks(engine, ranks, num_nodes - 1), PAGERANK_ERROR_ARGUMENT, 'small buffer')
+    lib.pagerank_free(engine)
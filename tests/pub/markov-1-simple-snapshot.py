@@ -0,0 +1,26 @@
+import os
+import tempfile
+from common.utils import run, expect_retcode, expect_scores
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    with tempfile.TemporaryDirectory() as tmp:
+        snapshot = os.path.join(tmp, 'simple.prg')
+        args = ['--save-binary', snapshot, '-m', '0', '../graphs/simple.dot']
+
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+
+        args = ['-m', '1', snapshot]
+
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+
+    scores = {
+        'A': 0.081250,
+        'B': 0.306250,
+        'C': 0.193750,
+        'E': 0.418750
+    }
+
+    expect_scores(proc, out, scores, 1e-15, verbose, debug)
@@ -0,0 +1,110 @@
+import os
+import re
+import tempfile
+from common.utils import run, expect_retcode, expect_scores, parse_ranks, TestFailure
+
+DIFF = '''# drop one parallel edge, reroute forum, add a new node
+-leaderboard -> dGit;
+-forum -> dCMS;
++forum -> dGit;
++wiki -> guide;
+'''
+
+EDITED = '''digraph Prog2Graph {
+CMS -> dCMS;
+dCMS -> dGit;
+dCMS -> dGit;
+dCMS -> guide;
+dCMS -> forum;
+dCMS -> leaderboard;
+leaderboard -> dCMS;
+leaderboard -> dGit;
+guide -> forum;
+forum -> guide;
+forum -> dGit;
+wiki -> guide;
+}
+'''
+
+
+def markov_sweeps(out):
+    match = re.search(r'kernels\): \d+ iterations \(([\d.]+) edge sweeps\) \(converged\)', out)
+    if not match:
+        raise TestFailure('No converged Markov chain in the log:\n{}'.format(out))
+    return float(match.group(1))
+
+
+def periphery_graph(rerouted):
+    # A slowly mixing cycle fed by leaves; rerouting one leaf changes the
+    # ranks of the cycle only, while a warm start sweeps all leaves as well
+    lines = ['digraph Periphery {']
+    lines += ['core{} -> core{};'.format(i, (i + 1) % 20) for i in range(20)]
+    lines.append('core0 -> core10;')
+    for i in range(200):
+        lines.append('source{0} -> leaf{0};'.format(i))
+        lines.append('leaf{} -> core{};'.format(i, 12 if rerouted and i == 5 else i % 17))
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    with tempfile.TemporaryDirectory() as tmp:
+        ranks = os.path.join(tmp, 'prog2graph.ranks')
+        diff = os.path.join(tmp, 'prog2graph.diff')
+        edited = os.path.join(tmp, 'edited.dot')
+        with open(diff, 'w') as f:
+            f.write(DIFF)
+        with open(edited, 'w') as f:
+            f.write(EDITED)
+
+        args = ['-m', 'auto', '-e', '1e-12', '--save-ranks', ranks,
+                '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+
+        args = ['-m', 'auto', '-e', '1e-12', edited]
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+        scores = parse_ranks(out)
+
+        args = ['-m', 'auto', '-e', '1e-12', '--ranks', ranks,
+                '--delta', diff, '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+        # The diff only reaches the cycle, so the local phase must settle it
+        # with fewer edge sweeps than a warm start on the edited graph
+        graph = os.path.join(tmp, 'periphery.dot')
+        edited = os.path.join(tmp, 'rerouted.dot')
+        with open(graph, 'w') as f:
+            f.write(periphery_graph(False))
+        with open(edited, 'w') as f:
+            f.write(periphery_graph(True))
+        with open(diff, 'w') as f:
+            f.write('-leaf5 -> core5;\n+leaf5 -> core12;\n')
+
+        args = ['-m', 'auto', '-e', '1e-10', '--save-ranks', ranks, graph]
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+
+        args = ['-m', 'auto', '-e', '1e-10', edited]
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+        scores = parse_ranks(out)
+
+        sweeps = {}
+        for name, args in [('delta', ['--delta', diff, graph]), ('warm', [edited])]:
+            path = os.path.join(tmp, name + '.ranks')
+            args = ['-v', '-m', 'auto', '-e', '1e-10', '--ranks', ranks, '--output', path] + args
+            proc, out = run(sut, args, this_dir, 3, verbose, debug)
+            expect_retcode(proc, 0, out, verbose, debug)
+            sweeps[name] = markov_sweeps(out)
+            with open(path) as f:
+                result = parse_ranks(f.read())
+            for node, rank in scores.items():
+                if abs(result[node] - rank) > 1e-6:
+                    raise TestFailure('{} rank of {} is {}, cold {}'.format(name, node, result[node], rank))
+
+    if not sweeps['delta'] < sweeps['warm']:
+        raise TestFailure('delta read {} edge sweeps, warm start {}'.format(sweeps['delta'], sweeps['warm']))
@@ -0,0 +1,33 @@
+import os
+import tempfile
+from common.utils import run, expect_retcode, expect_scores
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    # Streaming the edges from disk must give the in-memory ranks, on the
+    # conversion run and when the edge file is ranked again later
+    scores = {
+        'CMS': 0.042895,
+        'dCMS': 0.226971,
+        'dGit': 0.174854,
+        'forum': 0.267435,
+        'guide': 0.204095,
+        'leaderboard': 0.083750
+    }
+
+    with tempfile.TemporaryDirectory() as tmp:
+        edges = os.path.join(tmp, 'prog2graph.pre')
+        args = ['--save-edges', edges, '-m', 'auto', '-e', '1e-12', '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+        args = ['-m', 'auto', '-e', '1e-12', edges]
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+        # The random surfer needs the edges in memory
+        args = ['-r', '1000', edges]
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 1, out, verbose, debug)
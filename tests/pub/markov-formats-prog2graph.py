@@ -0,0 +1,65 @@
+import os
+import struct
+import tempfile
+from common.utils import run, expect_retcode, TestFailure
+
+# Full-precision ranks of prog2graph with -p 10 and -p 20
+SCORES = {
+    'CMS': (0.042895, 0.057355),
+    'dCMS': (0.226971, 0.227514),
+    'dGit': (0.174854, 0.180163),
+    'forum': (0.267435, 0.248181),
+    'guide': (0.204095, 0.193030),
+    'leaderboard': (0.083750, 0.093757)
+}
+
+
+def check(node, ranks, columns):
+    for col in columns:
+        if abs(ranks[col] - SCORES[node][col]) > 1e-6:
+            raise TestFailure('Mismatch of score for node {}: expecting {}, '
+                              'got {}'.format(node, SCORES[node][col],
+                                              ranks[col]))
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    with tempfile.TemporaryDirectory() as tmp:
+        columnar = os.path.join(tmp, 'ranks.col')
+        args = ['-m', 'auto', '-e', '1e-12', '-p', '10,20', '--format',
+                'columnar', '--output', columnar, '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+        with open(columnar, 'rb') as f:
+            data = f.read()
+
+        raw = os.path.join(tmp, 'ranks.raw')
+        args = ['-m', 'auto', '-e', '1e-12', '--format', 'raw', '--output',
+                raw, '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+        with open(raw, 'rb') as f:
+            raw_data = f.read()
+
+    magic, version, k, n = struct.unpack_from('<8sIIQ', data, 0)
+    if magic != b'PRRANKS\0' or version != 1 or k != 2 or n != len(SCORES):
+        raise TestFailure('Unexpected columnar header: {} {} {} {}'
+                          .format(magic, version, k, n))
+    sections = struct.unpack_from('<6Q', data, 24)
+    offsets = struct.unpack_from('<{}Q'.format(n + 1), data, sections[0])
+    ids = data[sections[2]:sections[2] + sections[3]]
+    ranks = struct.unpack_from('<{}d'.format(n * k), data, sections[4])
+
+    # The raw file is the rank section of a single vector
+    if len(raw_data) != 8 * n:
+        raise TestFailure('Unexpected size of raw output: {}'
+                          .format(len(raw_data)))
+    raw_ranks = struct.unpack('<{}d'.format(n), raw_data)
+
+    for i in range(n):
+        node = ids[offsets[i]:offsets[i + 1] - 1].decode()
+        if node not in SCORES:
+            raise TestFailure('Unexpected node in columnar output: {}'
+                              .format(node))
+        check(node, ranks[i * k:(i + 1) * k], (0, 1))
+        check(node, raw_ranks[i:i + 1], (0,))
@@ -0,0 +1,50 @@
+import os
+import tempfile
+from common.utils import run, expect_retcode, expect_scores, TestFailure
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    # Packing must not change the ranks, also when the packed snapshot is
+    # loaded again, reordered (which unpacks it) or decoded by any solver
+    scores = {
+        'CMS': 0.042895,
+        'dCMS': 0.226971,
+        'dGit': 0.174854,
+        'forum': 0.267435,
+        'guide': 0.204095,
+        'leaderboard': 0.083750
+    }
+
+    with tempfile.TemporaryDirectory() as tmp:
+        snapshot = os.path.join(tmp, 'packed.prg')
+        args = ['--pack', '--save-binary', snapshot, '-m', 'auto', '-e', '1e-12',
+                '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+        for extra in [['-j', '3'], ['--solver', 'gauss-seidel'], ['--solver', 'adaptive', '-j', '2'],
+                      ['--reorder', 'degree']]:
+            args = ['-m', 'auto', '-e', '1e-12'] + extra + [snapshot]
+            proc, out = run(sut, args, this_dir, 3, verbose, debug)
+            expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+        # Several vectors at once and the local phase of --delta (--pack
+        # packs after the diff)
+        ranks = os.path.join(tmp, 'prog2graph.ranks')
+        diff = os.path.join(tmp, 'prog2graph.diff')
+        with open(diff, 'w') as f:
+            f.write('-forum -> dCMS;\n+forum -> dGit;\n')
+        args = ['-m', 'auto', '-e', '1e-12', '--save-ranks', ranks, '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+        for extra in [['-p', '5,10', '-j', '2'], ['--seeds', 'CMS,forum'], ['--ranks', ranks, '--delta', diff]]:
+            outputs = []
+            for pack in [[], ['--pack']]:
+                args = ['-m', 'auto', '-e', '1e-12'] + pack + extra + ['../graphs/prog2graph.dot']
+                proc, out = run(sut, args, this_dir, 3, verbose, debug)
+                expect_retcode(proc, 0, out, verbose, debug)
+                outputs.append(out)
+            if outputs[0] != outputs[1]:
+                raise TestFailure('{} differs with --pack:\n{}\n{}'.format(' '.join(extra), *outputs))
@@ -0,0 +1,23 @@
+import os
+from common.utils import run, expect_scores
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    scores = {
+        'CMS': 0.0,
+        'dCMS': 0.205077,
+        'dGit': 0.095976,
+        'forum': 0.431117,
+        'guide': 0.230916,
+        'leaderboard': 0.036914
+    }
+
+    args = '-m auto -e 1e-12 --seeds forum ../graphs/prog2graph.dot'.split()
+    proc, out = run(sut, args, this_dir, 3, verbose, debug)
+    expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+    args = '--push 1e-10 --seeds forum ../graphs/prog2graph.dot'.split()
+    proc, out = run(sut, args, this_dir, 3, verbose, debug)
+    expect_scores(proc, out, scores, 1e-6, verbose, debug)
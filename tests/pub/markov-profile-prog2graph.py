@@ -0,0 +1,39 @@
+import json
+import os
+import tempfile
+from common.utils import run, expect_scores, TestFailure
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    # The JSON profile must leave the printed ranks untouched
+    scores = {
+        'CMS': 0.042895,
+        'dCMS': 0.226971,
+        'dGit': 0.174854,
+        'forum': 0.267435,
+        'guide': 0.204095,
+        'leaderboard': 0.083750
+    }
+
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'profile.json')
+        args = ['--profile=' + path, '-m', 'auto', '-e', '1e-12',
+                '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_scores(proc, out, scores, 1e-6, verbose, debug)
+        with open(path) as f:
+            profile = json.load(f)
+
+    names = [phase['name'] for phase in profile['phases']]
+    if names != ['parse', 'markov', 'output']:
+        raise TestFailure('Unexpected profile phases: {}'.format(names))
+    for phase in profile['phases']:
+        if phase['wall_s'] < 0 or phase['cpu_s'] < 0:
+            raise TestFailure('Negative time in phase {}'.format(phase))
+    iterations = profile['markov_iterations_s']
+    if not 1 < len(iterations) < 10000 or min(iterations) < 0:
+        raise TestFailure('Unexpected iteration times: {}'.format(iterations))
+    if profile['peak_rss_bytes'] <= 0:
+        raise TestFailure('Missing peak RSS: {}'.format(profile['peak_rss_bytes']))
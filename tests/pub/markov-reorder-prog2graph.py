@@ -0,0 +1,22 @@
+import os
+from common.utils import run, expect_scores
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    # Renumbering the nodes must not change the output
+    scores = {
+        'CMS': 0.042895,
+        'dCMS': 0.226971,
+        'dGit': 0.174854,
+        'forum': 0.267435,
+        'guide': 0.204095,
+        'leaderboard': 0.083750
+    }
+
+    for method in ['degree', 'rcm', 'community']:
+        args = ['--reorder', method, '-m', 'auto', '-e', '1e-12',
+                '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_scores(proc, out, scores, 1e-6, verbose, debug)
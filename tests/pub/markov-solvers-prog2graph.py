@@ -0,0 +1,73 @@
+import os
+import re
+import tempfile
+from common.utils import run, expect_retcode, expect_scores, parse_ranks, TestFailure
+
+
+def markov_stats(out):
+    match = re.search(r'\((\S+) solver, \S+ kernels\): (\d+) iterations \(([\d.]+) edge sweeps\)( \(converged\))?', out)
+    if not match:
+        raise TestFailure('No Markov chain statistics in the log:\n{}'.format(out))
+    return match.group(1), float(match.group(3)), match.group(4) is not None
+
+
+def periphery_graph():
+    # A slowly mixing cycle fed by leaves with a single source each: the
+    # leaves and sources settle after two sweeps, the cycle takes long
+    lines = ['digraph Periphery {']
+    lines += ['core{} -> core{};'.format(i, (i + 1) % 20) for i in range(20)]
+    lines.append('core0 -> core10;')
+    for i in range(200):
+        lines.append('source{0} -> leaf{0};'.format(i))
+        lines.append('leaf{} -> core{};'.format(i, i % 17))
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    scores = {
+        'CMS': 0.042895,
+        'dCMS': 0.226971,
+        'dGit': 0.174854,
+        'forum': 0.267435,
+        'guide': 0.204095,
+        'leaderboard': 0.083750
+    }
+
+    for solver in ['gauss-seidel', 'extrapolate:4', 'adaptive', 'blocked']:
+        args = ['-m', 'auto', '-e', '1e-12', '--solver', solver, '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+    # More threads than partitions
+    args = ['-m', 'auto', '-e', '1e-12', '-j', '4', '--solver', 'blocked', '../graphs/prog2graph.dot']
+    proc, out = run(sut, args, this_dir, 3, verbose, debug)
+    expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+    # Adaptive stops gathering the in-edges of converged nodes, so it must
+    # read fewer edges than jacobi where many nodes converge early, and
+    # still meet the same tolerance
+    with tempfile.TemporaryDirectory() as tmp:
+        graph = os.path.join(tmp, 'periphery.dot')
+        with open(graph, 'w') as f:
+            f.write(periphery_graph())
+        sweeps = {}
+        ranks = {}
+        for solver in ['jacobi', 'adaptive']:
+            path = os.path.join(tmp, solver + '.ranks')
+            args = ['-v', '-m', 'auto', '-e', '1e-10', '--solver', solver, '--output', path, graph]
+            proc, out = run(sut, args, this_dir, 3, verbose, debug)
+            expect_retcode(proc, 0, out, verbose, debug)
+            name, sweeps[solver], converged = markov_stats(out)
+            if name != solver or not converged:
+                raise TestFailure('{} did not converge:\n{}'.format(solver, out))
+            with open(path) as f:
+                ranks[solver] = parse_ranks(f.read())
+
+    if not sweeps['adaptive'] < sweeps['jacobi']:
+        raise TestFailure('adaptive read {} edge sweeps, jacobi {}'.format(sweeps['adaptive'], sweeps['jacobi']))
+    for node, rank in ranks['jacobi'].items():
+        if abs(ranks['adaptive'][node] - rank) > 1e-6:
+            raise TestFailure('adaptive rank of {} is {}, jacobi {}'.format(node, ranks['adaptive'][node], rank))
@@ -0,0 +1,35 @@
+from common.utils import run, expect_retcode, parse_ranks, TestFailure
+import os
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    percents = ['10', '35', '0']
+
+    args = ['-m', 'auto', '-e', '1e-12', '-p', ','.join(percents),
+            '../graphs/prog2graph.dot']
+    proc, out = run(sut, args, this_dir, 3, verbose, debug)
+    expect_retcode(proc, 0, out, verbose, debug)
+    rows = {}
+    for l in out.splitlines():
+        wds = l.split()
+        if len(wds) != len(percents) + 1:
+            raise TestFailure('Unexpected line of illegal format in output: {}'
+                              .format(l))
+        rows[wds[0]] = [float(w) for w in wds[1:]]
+
+    # Every column must match a separate run with that -p
+    for col, percent in enumerate(percents):
+        args = ['-m', 'auto', '-e', '1e-12', '-p', percent,
+                '../graphs/prog2graph.dot']
+        proc, out = run(sut, args, this_dir, 3, verbose, debug)
+        expect_retcode(proc, 0, out, verbose, debug)
+        scores = parse_ranks(out)
+        if sorted(scores) != sorted(rows):
+            raise TestFailure('Node sets differ for -p {}'.format(percent))
+        for node, score in scores.items():
+            if abs(rows[node][col] - score) > 1e-6:
+                raise TestFailure('Mismatch of score for node {} with -p {}: '
+                                  'expecting {}, got {}'
+                                  .format(node, percent, score,
+                                          rows[node][col]))
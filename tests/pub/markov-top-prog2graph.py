@@ -0,0 +1,22 @@
+import os
+from common.utils import run, expect_scores, TestFailure
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    scores = {
+        'forum': 0.267435,
+        'dCMS': 0.226971,
+        'guide': 0.204095
+    }
+
+    args = '-m auto --top 3 ../graphs/prog2graph.dot'.split()
+    proc, out = run(sut, args, this_dir, 3, verbose, debug)
+    expect_scores(proc, out, scores, 1e-6, verbose, debug)
+
+    # Best first
+    order = [l.split()[0] for l in out.splitlines()]
+    if order != ['forum', 'dCMS', 'guide']:
+        raise TestFailure('Unexpected order of the top nodes: {}'
+                          .format(', '.join(order)))
@@ -0,0 +1,14 @@
+import os
+from common.utils import run, expect_scoresum1, TestFailure
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    args = '-r 100000 --seed 42 ../graphs/prog2graph.dot'.split()
+
+    proc, out = run(sut, args, this_dir, 3, verbose, debug)
+    expect_scoresum1(proc, out, 1e-6, verbose, debug)
+
+    proc2, out2 = run(sut, args, this_dir, 3, verbose, debug)
+    if out2 != out:
+        raise TestFailure('Same seed gave different results:\n{}\n{}'.format(out, out2))
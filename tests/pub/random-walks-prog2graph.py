@@ -0,0 +1,20 @@
+import os
+from common.utils import run, expect_scores
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    args = '--walks 20000 -j 2 --seed 7 ../graphs/prog2graph.dot'.split()
+
+    proc, out = run(sut, args, this_dir, 10, verbose, debug)
+
+    scores = {
+        'CMS': 0.042895,
+        'dCMS': 0.226971,
+        'dGit': 0.174854,
+        'forum': 0.267435,
+        'guide': 0.204095,
+        'leaderboard': 0.083750
+    }
+
+    expect_scores(proc, out, scores, 5e-3, verbose, debug)
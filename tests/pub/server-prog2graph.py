@@ -0,0 +1,71 @@
+import os
+import signal
+import socket
+import subprocess
+import tempfile
+import time
+from common.utils import TestFailure
+
+
+def query(connection, request):
+    connection.sendall((request + '\n').encode())
+    reader = connection.makefile('r')
+    status = reader.readline().split()
+    if status[0] != 'OK':
+        return None
+    return [reader.readline().rstrip('\n').split('\t') for _ in range(int(status[1]))]
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'pagerank.sock')
+        server = subprocess.Popen([sut, '--serve', path, '--workers', '2', '-e', '1e-12',
+                                   '../graphs/prog2graph.dot'], cwd=this_dir,
+                                  stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                  universal_newlines=True)
+        try:
+            for _ in range(100):
+                if os.path.exists(path) or server.poll() is not None:
+                    break
+                time.sleep(0.05)
+            first = socket.socket(socket.AF_UNIX)
+            first.connect(path)
+            second = socket.socket(socket.AF_UNIX)
+            second.connect(path)
+            # More open connections than workers: idle ones hold no worker
+            third = socket.socket(socket.AF_UNIX)
+            third.connect(path)
+            third.settimeout(5)
+
+            forum = query(first, 'score forum')
+            if forum is None or abs(float(forum[0][1]) - 0.267435) > 1e-6:
+                raise TestFailure('Unexpected score of forum: {}'.format(forum))
+            # Same parameters from another connection: served from the cache
+            top = query(second, 'top 2 p=10')
+            if [row[0] for row in top or []] != ['forum', 'dCMS']:
+                raise TestFailure('Unexpected top nodes: {}'.format(top))
+            ranks = query(second, 'ranks seeds=CMS p=20')
+            if ranks is None or len(ranks) != 6 or abs(sum(float(r[1]) for r in ranks) - 1) > 1e-9:
+                raise TestFailure('Unexpected personalized ranks: {}'.format(ranks))
+            if query(first, 'score nosuchnode') is not None or query(first, 'top 0') is not None:
+                raise TestFailure('Invalid requests were answered')
+            stats = dict(query(third, 'stats'))
+            if stats['computed'] != '2' or stats['hits'] != '1':
+                raise TestFailure('Unexpected cache counters: {}'.format(stats))
+            # An overlong request is refused once its limit is buffered
+            third.sendall(b'x' * 65536)
+            if not third.makefile('r').readline().startswith('ERR'):
+                raise TestFailure('An overlong request was not refused')
+            first.close()
+            second.close()
+            third.close()
+        finally:
+            server.send_signal(signal.SIGTERM)
+            out, _ = server.communicate(timeout=5)
+        if verbose:
+            print(out)
+        if server.returncode != 0 or os.path.exists(path):
+            raise TestFailure('Server ended with {} and left {}: {}'.format(
+                server.returncode, path, out))
@@ -0,0 +1,11 @@
+import os
+from common.utils import run, expect_stats
+
+
+def run_test(sut, verbose, debug):
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    args = '-j 4 -s ../graphs/prog2graph.dot'.split()
+
+    proc, out = run(sut, args, this_dir, 3, verbose, debug)
+
+    expect_stats(proc, out, 'Prog2Graph', 6, 12, 0, 4, 0, 5, verbose, debug)